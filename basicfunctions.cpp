@@ -27,6 +27,7 @@ using namespace boost::interprocess;
 #include "rules.h"
 #include "settings.h"
 #include "basicfunctions.h"
+#include "progress.h"
 #include "forms/frmprogress.h"
 #include "forms/frmpassword.h"
 
@@ -112,6 +113,10 @@ wxArrayString StringToArrayString(const wxString &string, const wxString &sepera
 void OutputProgress(const wxString &message, OutputType type){
     std::string out = message.ToStdString();
 
+    if(type == Message || type == Error){
+        Progress::AddFiles();
+    }
+
     try{
         message_queue mq(open_only, "progress");
         while(!mq.try_send(out.data(), out.size(), type))
@@ -124,6 +129,29 @@ void OutputProgress(const wxString &message, OutputType type){
     }
 }
 
+void OutputEvent(EventOperation operation, const wxString &path, int error, unsigned long long bytes, unsigned long duration){
+    ProgressEvent event;
+    event.operation = operation;
+    event.path = path;
+    event.error = error;
+    event.bytes = bytes;
+    event.duration = duration;
+    std::string out = event.Encode();
+
+    Progress::AddFiles();
+
+    try{
+        message_queue mq(open_only, "progress");
+        while(!mq.try_send(out.data(), out.size(), event.Failed() ? Error : Message))
+        {
+            wxYield();
+        }
+    }
+    catch(std::exception &ex){
+        wxLogError("%s", ex.what());
+    }
+}
+
 wxArrayString GetJobs(Jobs::Type type){
     bool ok;
     wxString value, inputtype;
@@ -220,7 +248,7 @@ wxArrayString GetScripts(){
 bool UpdateJobs(){
 	long version;
 	//Update this when updating Job format version
-	const long cur_version = 302;
+	const long cur_version = 306;
 
 	wxFileConfig *config = wxGetApp().m_Jobs_Config;
 	if(!wxFileExists(wxGetApp().GetSettingsPath() + wxT("Jobs.ini"))){
@@ -381,6 +409,65 @@ bool UpdateJobs(){
 		}
 		version = 302;
 	}
+	if(version == 302){
+		wxString value;
+		long dummy;
+		bool exists = config->GetFirstGroup(value, dummy);
+		while(exists){
+			if(config->Read(value + wxT("/Type")) == wxT("Sync")){
+				if(!config->Exists(value + wxT("/Durability"))){
+					config->Write(value + wxT("/Durability"), wxT("none"));
+				}
+			}
+			exists = config->GetNextGroup(value, dummy);
+		}
+		version = 303;
+	}
+	if(version == 303){
+		wxString value;
+		long dummy;
+		bool exists = config->GetFirstGroup(value, dummy);
+		while(exists){
+			if(config->Read(value + wxT("/Type")) == wxT("Sync")){
+				if(!config->Exists(value + wxT("/Verify"))){
+					config->Write(value + wxT("/Verify"), false);
+				}
+			}
+			exists = config->GetNextGroup(value, dummy);
+		}
+		version = 304;
+	}
+	if(version == 304){
+		wxString value;
+		long dummy;
+		bool exists = config->GetFirstGroup(value, dummy);
+		while(exists){
+			if(config->Read(value + wxT("/Type")) == wxT("Sync")){
+				if(!config->Exists(value + wxT("/Background"))){
+					config->Write(value + wxT("/Background"), false);
+					config->Write(value + wxT("/BandwidthLimit"), 0);
+					config->Write(value + wxT("/IopsLimit"), 0);
+				}
+			}
+			exists = config->GetNextGroup(value, dummy);
+		}
+		version = 305;
+	}
+	if(version == 305){
+		wxString value;
+		long dummy;
+		bool exists = config->GetFirstGroup(value, dummy);
+		while(exists){
+			if(config->Read(value + wxT("/Type")) == wxT("Sync")){
+				if(!config->Exists(value + wxT("/Versions"))){
+					config->Write(value + wxT("/Versions"), false);
+					config->Write(value + wxT("/KeepVersions"), 0);
+				}
+			}
+			exists = config->GetNextGroup(value, dummy);
+		}
+		version = 306;
+	}
 	config->Write(wxT("General/Version"), cur_version);
 	config->Flush();
 	return true;
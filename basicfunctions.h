@@ -11,6 +11,8 @@ class wxComboBox;
 class wxString;
 class wxArrayString;
 
+#include "progressevent.h"
+
 void SetupLanguageMap();
 
 //Turns an array string into a string with the strings seperated by seperator, used when writing to ini files
@@ -39,6 +41,9 @@ namespace Jobs{
 };
 
 void OutputProgress(const wxString &message, OutputType type = Message);
+//Per file output, failed events are shown as errors
+void OutputEvent(EventOperation operation, const wxString &path, int error = 0, 
+                 unsigned long long bytes = 0, unsigned long duration = 0);
 
 //Get a list of jobs of a specific type, or if an emptystring is passed then get
 //all job names that are in use
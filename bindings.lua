@@ -1,4 +1,10 @@
 sync = toucan.Sync
+syncmany = toucan.SyncMany
+saveplan = toucan.SavePlan
+runplan = toucan.RunPlan
+pack = toucan.Pack
+-- unpack is already a Lua function
+applypack = toucan.ApplyPack
 backup = toucan.Backup
 secure = toucan.Secure
 delete = toucan.Delete
@@ -7,6 +13,8 @@ move = toucan.Move
 rename = toucan.Rename
 execute = toucan.Execute
 expand = toucan.ExpandVariable
+explain = toucan.Explain
+profilerules = toucan.ProfileRules
 print = toucan.OutputProgress
 getscript = toucan.GetScriptPath
 inputpassword = toucan.InputPassword
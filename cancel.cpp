@@ -0,0 +1,68 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "cancel.h"
+#include <vector>
+#include <wx/time.h>
+
+CancelToken::CancelToken() : m_Cancelled(false), m_Condition(m_Mutex), m_NextId(1){
+	;
+}
+
+void CancelToken::Cancel(){
+	std::vector<Callback> callbacks;
+	{
+		wxMutexLocker lock(m_Mutex);
+		if(m_Cancelled.exchange(true)){
+			return;
+		}
+		m_Condition.Broadcast();
+		for(std::map<unsigned long, Callback>::const_iterator iter = m_Callbacks.begin(); iter != m_Callbacks.end(); ++iter){
+			callbacks.push_back(iter->second);
+		}
+	}
+	//Outside the lock so a callback can unregister itself
+	for(std::vector<Callback>::const_iterator iter = callbacks.begin(); iter != callbacks.end(); ++iter){
+		(*iter)();
+	}
+}
+
+void CancelToken::Reset(){
+	wxMutexLocker lock(m_Mutex);
+	m_Cancelled = false;
+}
+
+unsigned long CancelToken::Register(const Callback &callback){
+	unsigned long id;
+	{
+		wxMutexLocker lock(m_Mutex);
+		id = m_NextId++;
+		if(!m_Cancelled){
+			m_Callbacks[id] = callback;
+			return id;
+		}
+	}
+	callback();
+	return id;
+}
+
+void CancelToken::Unregister(unsigned long id){
+	wxMutexLocker lock(m_Mutex);
+	m_Callbacks.erase(id);
+}
+
+bool CancelToken::Sleep(unsigned long milliseconds){
+	wxLongLong end = wxGetLocalTimeMillis() + milliseconds;
+	wxMutexLocker lock(m_Mutex);
+	for(;;){
+		wxLongLong left = end - wxGetLocalTimeMillis();
+		if(m_Cancelled || left <= 0){
+			break;
+		}
+		m_Condition.WaitTimeout(left.GetLo());
+	}
+	return m_Cancelled;
+}
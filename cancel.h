@@ -0,0 +1,62 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_CANCEL
+#define H_CANCEL
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <wx/thread.h>
+
+//Says whether the running job has been stopped. It is cheap enough to check 
+//for every block that is read or written, and anything that may block for a
+//while can ask to be told straight away, or sleep in a way that wakes up
+class CancelToken
+{
+public:
+	typedef std::function<void()> Callback;
+
+	CancelToken();
+
+	//Runs the callbacks on the calling thread, only the first time
+	void Cancel();
+	void Reset();
+	bool IsCancelled() const {return m_Cancelled.load(std::memory_order_relaxed);}
+
+	//If we are already cancelled the callback is run straight away
+	unsigned long Register(const Callback &callback);
+	void Unregister(unsigned long id);
+
+	//Sleeps for up to the given time, true if we woke because of a cancel
+	bool Sleep(unsigned long milliseconds);
+
+private:
+	std::atomic<bool> m_Cancelled;
+	wxMutex m_Mutex;
+	wxCondition m_Condition;
+	std::map<unsigned long, Callback> m_Callbacks;
+	unsigned long m_NextId;
+};
+
+//Registers a callback for as long as it is in scope
+class CancelCallback
+{
+public:
+	CancelCallback(CancelToken &token, const CancelToken::Callback &callback) 
+	    : m_Token(token), m_Id(token.Register(callback))
+	{}
+
+	~CancelCallback(){
+		m_Token.Unregister(m_Id);
+	}
+
+private:
+	CancelToken &m_Token;
+	unsigned long m_Id;
+};
+
+#endif
@@ -16,6 +16,22 @@
 #include <wx/combobox.h>
 #include <wx/radiobox.h>
 #include <wx/checkbox.h>
+#include <wx/spinctrl.h>
+
+SyncFunction SyncData::FunctionFromString(const wxString &function){
+	//Scripts may give the English name even when Toucan is translated
+	if(function == _("Copy") || function == "Copy")
+		return SyncCopy;
+	else if(function == _("Mirror") || function == "Mirror")
+		return SyncMirror;
+	else if(function == _("Move") || function == "Move")
+		return SyncMove;
+	else if(function == _("Equalise") || function == "Equalise")
+		return SyncEqualise;
+	else if(function == _("Clean") || function == "Clean")
+		return SyncClean;
+	return SyncUnknown;
+}
 
 void SyncData::TransferFromFile(){
 	if(!wxGetApp().m_Jobs_Config->Exists(GetName())){
@@ -35,6 +51,13 @@ void SyncData::TransferFromFile(){
 	SetRecycle(Read<bool>("Recycle"));
 	SetPreviewChanges(Read<bool>("PreviewChanges"));
 	SetNoSkipped(Read<bool>("NoSkipped"));
+	SetVerify(Read<bool>("Verify"));
+	SetDurability(Durability::FromString(Read<wxString>("Durability")));
+	SetBackground(Read<bool>("Background"));
+	SetBandwidthLimit(Read<long>("BandwidthLimit"));
+	SetIopsLimit(Read<long>("IopsLimit"));
+	SetVersions(Read<bool>("Versions"));
+	SetKeepVersions(Read<long>("KeepVersions"));
 
     RuleSet *rules = new RuleSet(Read<wxString>("Rules"));
     rules->TransferFromFile();
@@ -58,6 +81,13 @@ void SyncData::TransferToFile(){
 	Write<bool>("Recycle", GetRecycle());
 	Write<bool>("PreviewChanges", GetPreviewChanges());
 	Write<bool>("NoSkipped", GetNoSkipped());
+	Write<bool>("Verify", GetVerify());
+	Write<wxString>("Durability", Durability::ToString(GetDurability()));
+	Write<bool>("Background", GetBackground());
+	Write<long>("BandwidthLimit", GetBandwidthLimit());
+	Write<long>("IopsLimit", GetIopsLimit());
+	Write<bool>("Versions", GetVersions());
+	Write<long>("KeepVersions", GetKeepVersions());
 	Write<wxString>("Rules", GetRules() ? GetRules()->GetName() : "");
 	Write<wxString>("Type", "Sync");
 
@@ -94,6 +124,13 @@ bool SyncData::TransferToForm(frmMain *window){
 	window->m_Sync_Recycle->SetValue(GetRecycle());
 	window->m_SyncPreviewChanges->SetValue(GetPreviewChanges());
 	window->m_SyncNoSkipped->SetValue(GetNoSkipped());
+	window->m_SyncVerify->SetValue(GetVerify());
+	window->m_Sync_Durability->SetSelection(GetDurability());
+	window->m_SyncBackground->SetValue(GetBackground());
+	window->m_SyncBandwidth->SetValue(GetBandwidthLimit());
+	window->m_SyncIops->SetValue(GetIopsLimit());
+	window->m_SyncVersions->SetValue(GetVersions());
+	window->m_SyncKeepVersions->SetValue(GetKeepVersions());
 	window->m_Sync_Rules->SetStringSelection(GetRules()->GetName());
 	return true;
 }
@@ -115,6 +152,13 @@ bool SyncData::TransferFromForm(frmMain *window){
 	SetRecycle(window->m_Sync_Recycle->GetValue());
 	SetPreviewChanges(window->m_SyncPreviewChanges->GetValue());
 	SetNoSkipped(window->m_SyncNoSkipped->GetValue());
+	SetVerify(window->m_SyncVerify->GetValue());
+	SetDurability(static_cast<Durability::Level>(window->m_Sync_Durability->GetSelection()));
+	SetBackground(window->m_SyncBackground->GetValue());
+	SetBandwidthLimit(window->m_SyncBandwidth->GetValue());
+	SetIopsLimit(window->m_SyncIops->GetValue());
+	SetVersions(window->m_SyncVersions->GetValue());
+	SetKeepVersions(window->m_SyncKeepVersions->GetValue());
 
     RuleSet *rules = new RuleSet(window->m_Sync_Rules->GetStringSelection());
     rules->TransferFromFile();
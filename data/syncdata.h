@@ -10,8 +10,28 @@
 class frmMain;
 
 #include "jobdata.h"
+#include "../fileops.h"
 #include <wx/string.h>
 
+//The sync function resolved from its translated name so the sync itself
+//never has to compare strings
+enum SyncFunction{
+	SyncUnknown,
+	SyncCopy,
+	SyncMirror,
+	SyncMove,
+	SyncEqualise,
+	SyncClean
+};
+
+//The checks as bits, used to pick the comparison for a job
+enum SyncCheck{
+	SyncCheckSize = 1,
+	SyncCheckTime = 2,
+	SyncCheckShort = 4,
+	SyncCheckFull = 8
+};
+
 struct SyncChecks{
 	bool Size;
 	bool Time;
@@ -29,19 +49,38 @@ struct SyncOptions{
 	bool Recycle;
 	bool PreviewChanges;
 	bool NoSkipped;
+	bool Verify;
+	Durability::Level Durability;
+	//Run at low priority and step aside when the machine is busy
+	bool Background;
+	//In KB and operations a second, zero for no limit
+	long BandwidthLimit;
+	long IopsLimit;
+	//Move what is overwritten or removed in the destination into a dated
+	//folder rather than losing it, and how many days to keep it, zero for ever
+	bool Versions;
+	long KeepVersions;
+	//The command that starts an agent next to the destination and where the
+	//destination is as far as the agent is concerned, only set by scripts
+	wxString Agent;
+	wxString AgentRoot;
 
 	SyncOptions() : TimeStamps(true), Attributes(true), IgnoreRO(false), 
-					Recycle(false), PreviewChanges(false), NoSkipped(false)
+					Recycle(false), PreviewChanges(false), NoSkipped(false), Verify(false),
+					Durability(Durability::None), Background(false), BandwidthLimit(0), IopsLimit(0),
+					Versions(false), KeepVersions(0)
 	{}
 };
 
 class SyncData : public JobData{
 
 public:
-	SyncData(const wxString &name) : JobData(name){
+	SyncData(const wxString &name) : JobData(name), m_FunctionType(SyncUnknown){
 		;
 	}
 
+	static SyncFunction FunctionFromString(const wxString &function);
+
 	void TransferToFile();
 	void TransferFromFile();
 	bool TransferToForm(frmMain *window);
@@ -49,7 +88,7 @@ public:
 
 	void SetSource(const wxFileName& source) {this->source = source;}
 	void SetDest(const wxFileName& dest) {this->dest = dest;}
-	void SetFunction(const wxString& Function) {this->m_Function = Function;}
+	void SetFunction(const wxString& Function) {this->m_Function = Function; this->m_FunctionType = FunctionFromString(Function);}
 	void SetCheckSize(const bool& CheckSize) {this->m_Checks.Size = CheckSize;}
 	void SetCheckTime(const bool& CheckTime) {this->m_Checks.Time = CheckTime;}
 	void SetCheckShort(const bool& CheckShort) {this->m_Checks.Short = CheckShort;}
@@ -60,25 +99,47 @@ public:
 	void SetRecycle(const bool& Recycle) {this->m_Options.Recycle = Recycle;}
 	void SetPreviewChanges(const bool& Changes) {this->m_Options.PreviewChanges = Changes;}
 	void SetNoSkipped(const bool& NoSkipped) {this->m_Options.NoSkipped = NoSkipped;}
+	void SetVerify(const bool& Verify) {this->m_Options.Verify = Verify;}
+	void SetDurability(const Durability::Level& Level) {this->m_Options.Durability = Level;}
+	void SetBackground(const bool& Background) {this->m_Options.Background = Background;}
+	void SetBandwidthLimit(const long& BandwidthLimit) {this->m_Options.BandwidthLimit = BandwidthLimit;}
+	void SetIopsLimit(const long& IopsLimit) {this->m_Options.IopsLimit = IopsLimit;}
+	void SetVersions(const bool& Versions) {this->m_Options.Versions = Versions;}
+	void SetKeepVersions(const long& KeepVersions) {this->m_Options.KeepVersions = KeepVersions;}
+	void SetAgent(const wxString& Agent) {this->m_Options.Agent = Agent;}
+	void SetAgentRoot(const wxString& AgentRoot) {this->m_Options.AgentRoot = AgentRoot;}
 
 	const wxFileName& GetSource() const {return source;}
 	const wxFileName& GetDest() const {return dest;}
 	const wxString& GetFunction() const {return m_Function;}
+	const SyncFunction& GetFunctionType() const {return m_FunctionType;}
 	const bool& GetCheckSize() const {return m_Checks.Size;}
 	const bool& GetCheckTime() const {return m_Checks.Time;}
 	const bool& GetCheckShort() const {return m_Checks.Short;}
 	const bool& GetCheckFull() const {return m_Checks.Full;}
+	int GetChecks() const {return (m_Checks.Size ? SyncCheckSize : 0) | (m_Checks.Time ? SyncCheckTime : 0) 
+	                            | (m_Checks.Short ? SyncCheckShort : 0) | (m_Checks.Full ? SyncCheckFull : 0);}
 	const bool& GetIgnoreRO() const {return m_Options.IgnoreRO;}
 	const bool& GetTimeStamps() const {return m_Options.TimeStamps;}
 	const bool& GetAttributes() const {return m_Options.Attributes;}
 	const bool& GetRecycle() const {return m_Options.Recycle;}
 	const bool& GetPreviewChanges() const {return m_Options.PreviewChanges;}
 	const bool& GetNoSkipped() const {return m_Options.NoSkipped;}
+	const bool& GetVerify() const {return m_Options.Verify;}
+	const Durability::Level& GetDurability() const {return m_Options.Durability;}
+	const bool& GetBackground() const {return m_Options.Background;}
+	const long& GetBandwidthLimit() const {return m_Options.BandwidthLimit;}
+	const long& GetIopsLimit() const {return m_Options.IopsLimit;}
+	const bool& GetVersions() const {return m_Options.Versions;}
+	const long& GetKeepVersions() const {return m_Options.KeepVersions;}
+	const wxString& GetAgent() const {return m_Options.Agent;}
+	const wxString& GetAgentRoot() const {return m_Options.AgentRoot;}
 
 private:
 	wxFileName source;
 	wxFileName dest;
 	wxString m_Function;
+	SyncFunction m_FunctionType;
 	wxString m_PreText;
 	SyncChecks m_Checks;
 	SyncOptions m_Options;
@@ -0,0 +1,169 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "devicelock.h"
+#include "cancel.h"
+#include "path.h"
+#include <algorithm>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/textfile.h>
+#include <wx/thread.h>
+#include <wx/utils.h>
+#include <boost/interprocess/sync/file_lock.hpp>
+
+#ifdef __LINUX__
+	#include <stdlib.h>
+	#include <limits.h>
+	#include <sys/stat.h>
+	#include <sys/sysmacros.h>
+#endif
+
+namespace{
+	//The disks held by jobs in this copy of Toucan, file locks only keep 
+	//other processes out
+	wxMutex heldmutex;
+	wxCondition heldcondition(heldmutex);
+	std::set<wxString> held;
+
+	//How often to look for the job being stopped while we wait
+	const long waitms = 250;
+
+#ifdef __LINUX__
+	wxString ReadFirstLine(const wxString &path){
+		wxTextFile file;
+		if(!wxFileExists(path) || !file.Open(path) || file.GetLineCount() == 0){
+			return wxEmptyString;
+		}
+		return file.GetFirstLine().Trim();
+	}
+#endif
+}
+
+DeviceLock::Device DeviceLock::Identify(const wxString &path){
+	Device device;
+	device.rotational = false;
+	//Destinations may not exist yet so use whatever they will be created in
+	wxFileName name = wxFileName::DirName(Path::Normalise(path));
+	while(!wxDirExists(name.GetFullPath()) && name.GetDirCount() > 0){
+		name.RemoveLastDir();
+	}
+#ifdef __LINUX__
+	struct stat st;
+	if(stat(name.GetFullPath().fn_str(), &st) != 0){
+		return device;
+	}
+	unsigned int majornum = major(st.st_dev), minornum = minor(st.st_dev);
+	device.id = wxString::Format("%u-%u", majornum, minornum);
+	//Network shares and the like have no block device and never spin
+	char resolved[PATH_MAX];
+	wxString sysfs = wxString::Format("/sys/dev/block/%u:%u", majornum, minornum);
+	if(!realpath(sysfs.fn_str(), resolved)){
+		return device;
+	}
+	wxFileName disk = wxFileName::DirName(wxString(resolved, *wxConvFileName));
+	//Partitions share the disk they are on
+	if(wxFileExists(disk.GetPathWithSep() + "partition")){
+		disk.RemoveLastDir();
+	}
+	device.id = disk.GetDirs().Last();
+	device.rotational = ReadFirstLine(disk.GetPathWithSep() + "queue/rotational") == "1";
+#else
+	//We can't tell what sort of disk we are on so jobs carry on as before
+	wxStructStat st;
+	if(wxStat(name.GetFullPath(), &st) == 0){
+		device.id = wxString::Format("%lu", static_cast<unsigned long>(st.st_dev));
+	}
+#endif
+	return device;
+}
+
+std::set<wxString> DeviceLock::GetSpinning(const wxArrayString &paths){
+	std::set<wxString> ids;
+	for(unsigned int i = 0; i < paths.Count(); i++){
+		Device device = Identify(paths.Item(i));
+		if(device.rotational && !device.id.IsEmpty()){
+			ids.insert(device.id);
+		}
+	}
+	return ids;
+}
+
+DeviceLock::DeviceLock(const std::set<wxString> &ids, const wxString &lockdir, CancelToken &cancel, const Waiting &waiting)
+          : m_LockDir(lockdir), m_Cancel(cancel), m_Waiting(waiting)
+{
+	//Always in the same order so two jobs can't each hold what the other wants
+	for(std::set<wxString>::const_iterator iter = ids.begin(); iter != ids.end(); ++iter){
+		if(!Acquire(*iter)){
+			break;
+		}
+	}
+}
+
+DeviceLock::DeviceLock(const wxArrayString &paths, const wxString &lockdir, CancelToken &cancel, const Waiting &waiting)
+          : DeviceLock(GetSpinning(paths), lockdir, cancel, waiting)
+{}
+
+DeviceLock::~DeviceLock(){
+	for(std::vector<std::shared_ptr<boost::interprocess::file_lock> >::iterator iter = m_FileLocks.begin(); iter != m_FileLocks.end(); ++iter){
+		(*iter)->unlock();
+	}
+	wxMutexLocker lock(heldmutex);
+	for(std::vector<wxString>::const_iterator iter = m_Held.begin(); iter != m_Held.end(); ++iter){
+		held.erase(*iter);
+	}
+	heldcondition.Broadcast();
+}
+
+bool DeviceLock::Acquire(const wxString &id){
+	bool waiting = false;
+	{
+		wxMutexLocker lock(heldmutex);
+		while(held.find(id) != held.end()){
+			if(m_Cancel.IsCancelled()){
+				return false;
+			}
+			if(!waiting){
+				if(m_Waiting){
+					m_Waiting(id);
+				}
+				waiting = true;
+			}
+			heldcondition.WaitTimeout(waitms);
+		}
+		held.insert(id);
+		m_Held.push_back(id);
+	}
+
+	if(!wxDirExists(m_LockDir)){
+		wxMkdir(m_LockDir);
+	}
+	wxString lockpath = m_LockDir + wxFILE_SEP_PATH + id + ".lock";
+	if(!wxFileExists(lockpath)){
+		wxFile create(lockpath, wxFile::write);
+	}
+	try{
+		std::shared_ptr<boost::interprocess::file_lock> filelock(new boost::interprocess::file_lock(lockpath.mb_str()));
+		while(!filelock->try_lock()){
+			if(m_Cancel.IsCancelled()){
+				return false;
+			}
+			if(!waiting){
+				if(m_Waiting){
+					m_Waiting(id);
+				}
+				waiting = true;
+			}
+			m_Cancel.Sleep(waitms);
+		}
+		m_FileLocks.push_back(filelock);
+	}
+	catch(boost::interprocess::interprocess_exception&){
+		//Without the file we still keep jobs in this process apart
+	}
+	return true;
+}
@@ -0,0 +1,63 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_DEVICELOCK
+#define H_DEVICELOCK
+
+#include <vector>
+#include <set>
+#include <memory>
+#include <functional>
+#include <wx/string.h>
+#include <wx/arrstr.h>
+
+class CancelToken;
+
+namespace boost{
+	namespace interprocess{
+		class file_lock;
+	}
+}
+
+//Stops jobs that share a spinning disk from running at the same time, as the
+//disk spends its time seeking between them and both end up slower. This 
+//covers jobs in this copy of Toucan and any other. Disks with no moving parts
+//and network shares are left alone as they cope with several jobs at once
+class DeviceLock
+{
+public:
+	struct Device{
+		//Empty if we couldn't tell
+		wxString id;
+		bool rotational;
+	};
+
+	//Told about each disk we have to wait for
+	typedef std::function<void(const wxString &id)> Waiting;
+
+	//Waits until the given disks are free, with the lock files that keep 
+	//other processes out kept in lockdir. Stops waiting once cancelled
+	DeviceLock(const std::set<wxString> &ids, const wxString &lockdir, CancelToken &cancel, const Waiting &waiting = Waiting());
+	//The same for every spinning disk behind the paths
+	DeviceLock(const wxArrayString &paths, const wxString &lockdir, CancelToken &cancel, const Waiting &waiting = Waiting());
+	~DeviceLock();
+
+	//The whole disk a path is on, only Linux can tell us if it spins
+	static Device Identify(const wxString &path);
+	//The spinning disks behind the paths
+	static std::set<wxString> GetSpinning(const wxArrayString &paths);
+
+private:
+	bool Acquire(const wxString &id);
+
+	wxString m_LockDir;
+	CancelToken &m_Cancel;
+	Waiting m_Waiting;
+	std::vector<wxString> m_Held;
+	std::vector<std::shared_ptr<boost::interprocess::file_lock> > m_FileLocks;
+};
+
+#endif
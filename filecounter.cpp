@@ -7,11 +7,15 @@
 #include "filecounter.h"
 #include "path.h"
 #include "toucan.h"
+#include "progress.h"
 #include <wx/dir.h>
+#include <wx/filename.h>
 #include <wx/log.h>
 
-FileCounter::FileCounter(){
+FileCounter::FileCounter() : wxThread(wxTHREAD_JOINABLE){
 	m_Count = 0;
+	m_Bytes = 0;
+	m_Multiplier = 1;
 }
 
 void FileCounter::AddPath(const wxString &path){
@@ -35,18 +39,38 @@ bool FileCounter::Count(){
 			CountFolder(m_Paths.Item(i));		
 		}
 		else{
-			m_Count++;
+			AddFile(m_Paths.Item(i));
 		}
 
 	}
+	//If the job finished first its own progress is already final
+	if(!TestDestroy()){
+		Report();
+	}
 	return true;
 }
 
+void* FileCounter::Entry(){
+	Count();
+	return NULL;
+}
+
+void FileCounter::AddFile(const wxString &path){
+	m_Count++;
+	wxULongLong size = wxFileName::GetSize(path);
+	if(size != wxInvalidSize){
+		m_Bytes += size.GetValue();
+	}
+}
+
+void FileCounter::Report(){
+	Progress::SetTotal(m_Count * m_Multiplier, m_Bytes);
+}
+
 bool FileCounter::CountFolder(wxString path){
-	if(wxGetApp().GetAbort()){
+	if(wxGetApp().GetAbort() || TestDestroy()){
 		return true;
 	}
-	wxGetApp().Yield();
 	if (path[path.length()-1] != wxFILE_SEP_PATH) {
 		path += wxFILE_SEP_PATH;       
 	}
@@ -61,10 +85,11 @@ bool FileCounter::CountFolder(wxString path){
 				CountFolder(path + strFilename);
 			}
 			else{
-				m_Count++;
+				AddFile(path + strFilename);
 			}
 		}
 		while(dir.GetNext(&strFilename));
 	} 
+	Report();
 	return true;
 }
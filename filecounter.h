@@ -8,8 +8,12 @@
 #define H_FILECOUNTER
 
 #include <wx/arrstr.h>
+#include <wx/thread.h>
 
-class FileCounter{
+//Estimates the number of files and bytes a job will touch. It runs alongside 
+//the job rather than before it, updating the progress totals as it goes so 
+//the gauge fills in as the count catches up
+class FileCounter : public wxThread{
 
 public:
 	FileCounter();
@@ -18,11 +22,22 @@ public:
 	void AddPaths(const wxArrayString &paths);
 	long GetCount() const;
 	bool Count();
+
+	//Each counted file is reported this many times, i.e. twice for backups
+	//that are also tested, bytes are not multiplied
+	void SetMultiplier(int multiplier) {m_Multiplier = multiplier;}
+
+	virtual void* Entry();
 	
 private:
 	bool CountFolder(wxString path);
+	void AddFile(const wxString &path);
+	void Report();
+
 	wxArrayString m_Paths;
 	long m_Count;
+	unsigned long long m_Bytes;
+	int m_Multiplier;
 };	
 
 #endif
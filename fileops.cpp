@@ -5,13 +5,345 @@
 /////////////////////////////////////////////////////////////////////////////////
 
 #include "fileops.h"
+#include "progress.h"
+#include "path.h"
+#include "hash.h"
+#include "throttle.h"
+#include "progressevent.h"
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/log.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
 
-int File::Copy(const wxFileName &source, const wxFileName &dest){
-    wxString longsource = GetLongPath(source), longdest = GetLongPath(dest);
+#ifndef __WXMSW__
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <errno.h>
+	#include <string.h>
+#endif
+
+namespace{
+	//How much we let build up in group mode before flushing
+	const unsigned long groupfiles = 1000;
+	const unsigned long long groupbytes = 256 * 1024 * 1024;
+	//How many folders we keep open at once
+	const size_t maxopenfolders = 64;
+	//How often a resumable copy is flushed and checkpointed
+	const long long checkpointbytes = 64 * 1024 * 1024;
+	const size_t copybuffer = 1024 * 1024;
+
+	bool IsCancelled(const CancelToken *cancel){
+		return cancel && cancel->IsCancelled();
+	}
+
+	//So an error left over from something earlier isn't blamed on us
+	void ClearError(){
+	#ifdef __WXMSW__
+		SetLastError(0);
+	#else
+		errno = 0;
+	#endif
+	}
+
+	//Why a copy to a destination failed, -1 if we were stopped
+	int CopyError(const CancelToken *cancel){
+		return IsCancelled(cancel) ? -1 : ProgressEvent::LastError();
+	}
+
+#ifndef __WXMSW__
+	//Flushes the contents of a file but not more of its metadata than needed
+	int FlushData(int fd){
+	#ifdef __LINUX__
+		return fdatasync(fd);
+	#else
+		return fsync(fd);
+	#endif
+	}
+
+	void GetTimes(const struct stat &st, struct timespec *times){
+	#ifdef __DARWIN__
+		times[0] = st.st_atimespec;
+		times[1] = st.st_mtimespec;
+	#else
+		times[0] = st.st_atim;
+		times[1] = st.st_mtim;
+	#endif
+	}
+
+	//Gives an open copy what it should have of its source before it is 
+	//closed and renamed into place
+	bool SetMetadata(int fd, const struct stat &st, int metadata){
+		//Before the mode as changing the owner can clear the setuid bits
+		if((metadata & File::KeepOwner) && fchown(fd, st.st_uid, st.st_gid) != 0 && errno != EPERM){
+			return false;
+		}
+		//Like wxCopyFile we keep the permissions of the source, ignoring the umask
+		if(fchmod(fd, st.st_mode & 07777) != 0){
+			return false;
+		}
+		if(metadata & File::KeepTimes){
+			struct timespec times[2];
+			GetTimes(st, times);
+			if(futimens(fd, times) != 0){
+				return false;
+			}
+		}
+		return true;
+	}
+#endif
+}
+
+wxString Durability::ToString(Level level){
+	switch(level){
+		case File:
+			return "file";
+		case Group:
+			return "group";
+		default:
+			return "none";
+	}
+}
+
+Durability::Level Durability::FromString(const wxString &level){
+	if(level.CmpNoCase("file") == 0){
+		return File;
+	}
+	else if(level.CmpNoCase("group") == 0){
+		return Group;
+	}
+	return None;
+}
+
+int File::Copy(const wxFileName &source, const wxFileName &dest, bool flush, unsigned long long *hash, int metadata,
+               const CancelToken *cancel){
+	std::vector<wxFileName> dests(1, dest);
+	std::vector<int> errors;
+	return Copy(source, dests, errors, flush, hash, metadata, cancel);
+}
+
+int File::Copy(const wxFileName &source, const std::vector<wxFileName> &dests, std::vector<int> &errors, 
+               bool flush, unsigned long long *hash, int metadata, const CancelToken *cancel){
+    wxString longsource = GetLongPath(source);
+	ClearError();
+	errors.assign(dests.size(), 0);
+	bool copied = false;
+#ifdef __WXMSW__
+	for(size_t i = 0; i < dests.size(); i++){
+		if(IsCancelled(cancel)){
+			errors[i] = -1;
+			continue;
+		}
+		//The callback reports running totals so it needs to remember the last
+		//one, only the first copy counts towards the progress
+		CopyProgress progress;
+		progress.transferred.QuadPart = 0;
+		progress.counts = i == 0;
+		progress.cancel = cancel;
+		if(CopyFileEx(longsource.fn_str(), GetLongPath(dests[i]).fn_str(), &CopyProgressRoutine, &progress, NULL, 0)
+		&& (!flush || Flush(dests[i].GetFullPath()))){
+			copied = true;
+		}
+		else{
+			errors[i] = CopyError(cancel);
+		}
+		ClearError();
+	}
+	//CopyFileEx doesn't let us see the data so the source is read again, 
+	//hopefully from the cache
+	if(copied && hash && !ContentHash::File(longsource, *hash, false, cancel)){
+		int error = CopyError(cancel);
+		for(size_t i = 0; i < dests.size(); i++){
+			if(errors[i] == 0){
+				errors[i] = error;
+			}
+		}
+		return false;
+	}
+	//CopyFileEx keeps the times itself, the rest is left to the caller
+	wxUnusedVar(metadata);
+	return copied;
+#else
+	//We copy ourselves rather than use wxCopyFile so that large files report
+	//their progress as they go rather than all at once at the end, and so 
+	//that each block is read once however many places it is going
+	wxFile in(longsource, wxFile::read);
+	struct stat st;
+	if(!in.IsOpened() || fstat(in.fd(), &st) != 0){
+		errors.assign(dests.size(), ProgressEvent::LastError());
+		return false;
+	}
+	std::vector<wxString> longdests;
+	std::unique_ptr<wxFile[]> outs(new wxFile[dests.size()]);
+	for(size_t i = 0; i < dests.size(); i++){
+		longdests.push_back(GetLongPath(dests[i]));
+		if(outs[i].Create(longdests[i], true, st.st_mode & 0777)){
+			copied = true;
+		}
+		else{
+			errors[i] = ProgressEvent::LastError();
+			ClearError();
+		}
+	}
+	//A destination that fails is dropped, the rest carry on
+	ContentHash content;
+	std::vector<char> buffer(copybuffer);
+	while(copied){
+		ssize_t count = in.Read(&buffer[0], buffer.size());
+		if(count == wxInvalidOffset || IsCancelled(cancel)){
+			//Every destination still going fails for the same reason
+			int error = CopyError(cancel);
+			for(size_t i = 0; i < dests.size(); i++){
+				if(errors[i] == 0){
+					errors[i] = error;
+				}
+			}
+			copied = false;
+			break;
+		}
+		if(count == 0){
+			break;
+		}
+		copied = false;
+		for(size_t i = 0; i < dests.size(); i++){
+			if(errors[i] == 0 && outs[i].Write(&buffer[0], count) != (size_t)count){
+				errors[i] = ProgressEvent::LastError();
+				ClearError();
+			}
+			copied = copied || errors[i] == 0;
+		}
+		if(hash){
+			content.Update(&buffer[0], count);
+		}
+		Progress::AddBytes(count);
+		//One read and a write to each destination still going
+		unsigned long writes = static_cast<unsigned long>(std::count(errors.begin(), errors.end(), 0));
+		Throttle::Account(count * (1 + writes), 1 + writes);
+	}
+	bool any = false;
+	for(size_t i = 0; i < dests.size(); i++){
+		if(errors[i] == 0 && !(SetMetadata(outs[i].fd(), st, metadata) && (!flush || FlushData(outs[i].fd()) == 0) && outs[i].Close())){
+			errors[i] = ProgressEvent::LastError();
+			ClearError();
+		}
+		if(errors[i] != 0 && outs[i].IsOpened()){
+			outs[i].Close();
+			wxRemoveFile(longdests[i]);
+		}
+		any = any || errors[i] == 0;
+	}
+	if(any && hash){
+		*hash = content.GetValue();
+	}
+	return any;
+#endif
+}
+
+int File::Resume(const wxFileName &source, const wxFileName &dest, long long offset, CopyCheckpoint *checkpoint, 
+                 bool flush, unsigned long long *hash, int metadata, const CancelToken *cancel){
 #ifdef __WXMSW__
-	return CopyFileEx(longsource.fn_str(), longdest.fn_str(), &CopyProgressRoutine, NULL, NULL, 0);
+	//CopyFileEx does the whole file in one go so there is nothing to carry on from
+	wxUnusedVar(offset);
+	wxUnusedVar(checkpoint);
+	return Copy(source, dest, flush, hash, metadata, cancel);
 #else
-	return wxCopyFile(longsource, longdest, true);
+    wxString longsource = GetLongPath(source), longdest = GetLongPath(dest);
+	ClearError();
+	wxFile in(longsource, wxFile::read);
+	struct stat st;
+	if(!in.IsOpened() || fstat(in.fd(), &st) != 0){
+		return false;
+	}
+	wxFile out;
+	ContentHash content;
+	std::vector<char> buffer(copybuffer), check(copybuffer);
+	if(offset > 0 && offset <= st.st_size && wxFileExists(longdest) && out.Open(longdest, wxFile::read_write)){
+		//Only trust what we wrote last time if its last block still matches
+		long long start = offset > (long long)copybuffer ? offset - copybuffer : 0;
+		size_t length = offset - start;
+		if(out.Length() < offset || in.Seek(start) != start || out.Seek(start) != start 
+		|| in.Read(&buffer[0], length) != (ssize_t)length || out.Read(&check[0], length) != (ssize_t)length
+		|| memcmp(&buffer[0], &check[0], length) != 0 || ftruncate(out.fd(), offset) != 0){
+			offset = 0;
+		}
+	}
+	else{
+		offset = 0;
+	}
+	if(offset == 0){
+		out.Close();
+		in.Seek(0);
+		if(!out.Create(longdest, true, st.st_mode & 0777)){
+			return false;
+		}
+	}
+	else{
+		//The hash has to cover what was copied last time too
+		if(hash){
+			in.Seek(0);
+			for(long long done = 0; done < offset; ){
+				ssize_t count = in.Read(&buffer[0], wxMin((long long)buffer.size(), offset - done));
+				if(count <= 0){
+					return false;
+				}
+				content.Update(&buffer[0], count);
+				done += count;
+			}
+		}
+		in.Seek(offset);
+		out.Seek(offset);
+		//What we already have counts as done
+		Progress::SkipBytes(offset);
+	}
+
+	long long position = offset, checkpointed = offset;
+	for(;;){
+		ssize_t count = in.Read(&buffer[0], buffer.size());
+		if(count == wxInvalidOffset){
+			out.Close();
+			wxRemoveFile(longdest);
+			return false;
+		}
+		if(IsCancelled(cancel)){
+			//Keep what we have for next time
+			if(position > checkpointed && FlushData(out.fd()) == 0 && checkpoint){
+				checkpoint->Checkpoint(position);
+			}
+			return false;
+		}
+		if(count == 0){
+			break;
+		}
+		if(out.Write(&buffer[0], count) != (size_t)count){
+			out.Close();
+			wxRemoveFile(longdest);
+			return false;
+		}
+		if(hash){
+			content.Update(&buffer[0], count);
+		}
+		position += count;
+		Progress::AddBytes(count);
+		Throttle::Account(count * 2, 2);
+		if(position - checkpointed >= checkpointbytes && FlushData(out.fd()) == 0){
+			checkpointed = position;
+			if(checkpoint){
+				checkpoint->Checkpoint(position);
+			}
+		}
+	}
+	if(!SetMetadata(out.fd(), st, metadata) || (flush && FlushData(out.fd()) != 0)){
+		return false;
+	}
+	if(!out.Close()){
+		return false;
+	}
+	if(hash){
+		*hash = content.GetValue();
+	}
+	return true;
 #endif
 }
 
@@ -19,12 +351,26 @@ int File::Rename(const wxFileName &source, const wxFileName &dest, bool overwrit
     wxString longsource = GetLongPath(source), longdest = GetLongPath(dest);
 #ifdef __WXMSW__
 	DWORD flags = overwrite ? MOVEFILE_REPLACE_EXISTING : 0;
-	return MoveFileWithProgress(longsource.fn_str(), longdest.fn_str(), &CopyProgressRoutine, NULL, flags);
+	//A rename within a volume reports nothing and across volumes it is a copy
+	//we want to see the progress of
+	CopyProgress progress;
+	progress.transferred.QuadPart = 0;
+	progress.counts = true;
+	progress.cancel = NULL;
+	return MoveFileWithProgress(longsource.fn_str(), longdest.fn_str(), &CopyProgressRoutine, &progress, flags);
 #else
 	return wxRenameFile(longsource, longdest, overwrite);
 #endif
 }
 
+int File::Link(const wxFileName &source, const wxFileName &dest){
+#ifdef __WXMSW__
+	return CreateHardLink(GetLongPath(dest).fn_str(), GetLongPath(source).fn_str(), NULL);
+#else
+	return link(source.GetFullPath().fn_str(), dest.GetFullPath().fn_str()) == 0;
+#endif
+}
+
 int File::Delete(const wxFileName &path, bool recycle, bool ignorero){
     wxString longpath = GetLongPath(path);
 #ifdef __WXMSW__
@@ -53,6 +399,305 @@ int File::Delete(const wxFileName &path, bool recycle, bool ignorero){
 #endif
 }
 
+bool File::Flush(const wxString &path){
+#ifdef __WXMSW__
+	//Folder entries are written through by NTFS so there is nothing to do
+	if(wxDirExists(path)){
+		return true;
+	}
+	HANDLE handle = CreateFile(GetLongPath(path).fn_str(), GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE, 
+	                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(handle == INVALID_HANDLE_VALUE){
+		return false;
+	}
+	bool ret = FlushFileBuffers(handle) != 0;
+	CloseHandle(handle);
+	return ret;
+#else
+	//Opening read only is enough to fsync and also works for folders
+	int fd = open(path.fn_str(), O_RDONLY);
+	if(fd < 0){
+		return false;
+	}
+	bool ret = fsync(fd) == 0;
+	close(fd);
+	return ret;
+#endif
+}
+
+WriteBarrier::WriteBarrier(Durability::Level level) : m_Level(level){
+	m_Files = 0;
+	m_Bytes = 0;
+}
+
+WriteBarrier::~WriteBarrier(){
+	Commit();
+}
+
+bool WriteBarrier::Written(const wxFileName &path){
+	if(m_Level == Durability::File){
+		//The data was flushed before the rename, now make the rename itself stick
+		return File::Flush(path.GetPath());
+	}
+	else if(m_Level == Durability::Group){
+		m_Files++;
+#ifdef __LINUX__
+		wxStructStat st;
+		if(wxStat(path.GetFullPath(), &st) == 0){
+			m_Bytes += st.st_size;
+			if(m_Devices.find(st.st_dev) == m_Devices.end()){
+				m_Devices[st.st_dev] = path.GetPath();
+			}
+		}
+#else
+		wxULongLong size = path.GetSize();
+		if(size != wxInvalidSize){
+			m_Bytes += size.GetValue();
+		}
+		m_Pending.insert(path.GetFullPath());
+		m_Pending.insert(path.GetPath());
+#endif
+		if(m_Files >= groupfiles || m_Bytes >= groupbytes){
+			return Commit();
+		}
+	}
+	return true;
+}
+
+bool WriteBarrier::Commit(){
+	if(m_Level != Durability::Group || m_Files == 0){
+		return true;
+	}
+	bool ok = true;
+#ifdef __LINUX__
+	//syncfs flushes all of the data and metadata on the device in one go, 
+	//which is far cheaper than flushing each file on its own
+	for(std::map<unsigned long long, wxString>::iterator iter = m_Devices.begin(); iter != m_Devices.end(); ++iter){
+		int fd = open(iter->second.fn_str(), O_RDONLY);
+		if(fd < 0){
+			ok = false;
+			continue;
+		}
+		ok = syncfs(fd) == 0 && ok;
+		close(fd);
+	}
+	m_Devices.clear();
+#else
+	for(std::set<wxString>::iterator iter = m_Pending.begin(); iter != m_Pending.end(); ++iter){
+		ok = File::Flush(*iter) && ok;
+	}
+	m_Pending.clear();
+#endif
+	m_Files = 0;
+	m_Bytes = 0;
+	return ok;
+}
+
+FolderCache::FolderCache(){
+#ifndef __WXMSW__
+	m_Uses = 0;
+#endif
+}
+
+FolderCache::~FolderCache(){
+#ifndef __WXMSW__
+	CloseAll();
+#endif
+}
+
+void FolderCache::Split(const wxFileName &path, wxString &parent, wxString &name){
+	if(path.IsDir()){
+		wxFileName folder(path.GetPath());
+		parent = folder.GetPath();
+		name = folder.GetFullName();
+	}
+	else{
+		parent = path.GetPath();
+		name = path.GetFullName();
+	}
+}
+
+bool FolderCache::Create(const wxFileName &folder){
+	wxString path = folder.GetPath();
+	if(path.empty() || m_Known.find(path) != m_Known.end()){
+		return true;
+	}
+#ifndef __WXMSW__
+	//Make sure the parent is there and then create this folder inside it
+	wxString parent, name;
+	Split(folder, parent, name);
+	if(!parent.empty() && !name.empty() && parent != path && Create(wxFileName::DirName(parent))){
+		int fd = Open(parent);
+		if(fd >= 0 && (mkdirat(fd, name.fn_str(), 0777) == 0 || errno == EEXIST)){
+			m_Known.insert(path);
+			return true;
+		}
+	}
+#endif
+	Path::CreateDirectoryPath(folder);
+	if(wxDirExists(path)){
+		m_Known.insert(path);
+		return true;
+	}
+	return false;
+}
+
+void FolderCache::Forget(const wxFileName &folder){
+	wxString path = folder.GetPath();
+	wxString prefix = path + wxFILE_SEP_PATH;
+	m_Known.erase(path);
+	std::set<wxString>::iterator iter = m_Known.lower_bound(prefix);
+	while(iter != m_Known.end() && iter->StartsWith(prefix)){
+		m_Known.erase(iter++);
+	}
+#ifndef __WXMSW__
+	std::map<wxString, OpenFolder>::iterator open = m_Open.find(path);
+	if(open != m_Open.end()){
+		close(open->second.fd);
+		m_Open.erase(open);
+	}
+	open = m_Open.lower_bound(prefix);
+	while(open != m_Open.end() && open->first.StartsWith(prefix)){
+		close(open->second.fd);
+		m_Open.erase(open++);
+	}
+#endif
+}
+
+bool FolderCache::Rename(const wxFileName &source, const wxFileName &dest){
+#ifndef __WXMSW__
+	wxString sourceparent, sourcename, destparent, destname;
+	Split(source, sourceparent, sourcename);
+	Split(dest, destparent, destname);
+	int sourcefd = Open(sourceparent);
+	int destfd = Open(destparent, sourceparent);
+	if(sourcefd >= 0 && destfd >= 0 
+	&& renameat(sourcefd, sourcename.fn_str(), destfd, destname.fn_str()) == 0){
+		return true;
+	}
+#endif
+	return File::Rename(source, dest, true) != 0;
+}
+
+bool FolderCache::Remove(const wxFileName &path, bool recycle, bool ignorero){
+#ifndef __WXMSW__
+	wxString parent, name;
+	Split(path, parent, name);
+	int fd = Open(parent);
+	if(fd >= 0 && unlinkat(fd, name.fn_str(), 0) == 0){
+		return true;
+	}
+#endif
+	return File::Delete(path, recycle, ignorero) != 0;
+}
+
+bool FolderCache::RemoveFolder(const wxFileName &folder){
+	//Close it before it goes
+	Forget(folder);
+	bool ret = false;
+#ifndef __WXMSW__
+	wxString parent, name;
+	Split(folder, parent, name);
+	int fd = Open(parent);
+	ret = fd >= 0 && unlinkat(fd, name.fn_str(), AT_REMOVEDIR) == 0;
+#endif
+	if(!ret){
+		wxLogNull log;
+		ret = wxRmdir(folder.GetFullPath());
+	}
+	return ret;
+}
+
+bool FolderCache::SetTimes(const wxFileName &path, const wxDateTime &access, const wxDateTime &mod, const wxDateTime &created){
+#ifndef __WXMSW__
+	wxString parent, name;
+	Split(path, parent, name);
+	int fd = Open(parent);
+	if(fd >= 0 && access.IsValid() && mod.IsValid()){
+		wxLongLong accessms = access.GetValue(), modms = mod.GetValue();
+		struct timespec times[2];
+		times[0].tv_sec = (accessms / 1000).ToLong();
+		times[0].tv_nsec = (accessms % 1000).ToLong() * 1000000;
+		times[1].tv_sec = (modms / 1000).ToLong();
+		times[1].tv_nsec = (modms % 1000).ToLong() * 1000000;
+		if(utimensat(fd, name.fn_str(), times, 0) == 0){
+			return true;
+		}
+	}
+#endif
+	return path.SetTimes(&access, &mod, &created);
+}
+
+bool FolderCache::CopyTimes(const wxFileName &source, const wxFileName &dest){
+#ifndef __WXMSW__
+	wxString sourceparent, sourcename, destparent, destname;
+	Split(source, sourceparent, sourcename);
+	Split(dest, destparent, destname);
+	int sourcefd = Open(sourceparent);
+	int destfd = Open(destparent, sourceparent);
+	struct stat st;
+	if(sourcefd >= 0 && destfd >= 0 && fstatat(sourcefd, sourcename.fn_str(), &st, 0) == 0){
+		struct timespec times[2];
+		GetTimes(st, times);
+		if(utimensat(destfd, destname.fn_str(), times, 0) == 0){
+			return true;
+		}
+	}
+#endif
+	wxDateTime access, mod, created;
+	if(!source.GetTimes(&access, &mod, &created)){
+		return false;
+	}
+	return SetTimes(dest, access, mod, created);
+}
+
+#ifndef __WXMSW__
+int FolderCache::Open(const wxString &folder, const wxString &keep){
+	std::map<wxString, OpenFolder>::iterator iter = m_Open.find(folder);
+	if(iter != m_Open.end()){
+		iter->second.used = ++m_Uses;
+		return iter->second.fd;
+	}
+	if(m_Open.size() >= maxopenfolders){
+		std::map<wxString, OpenFolder>::iterator oldest = m_Open.end();
+		for(iter = m_Open.begin(); iter != m_Open.end(); ++iter){
+			if(iter->first != keep && (oldest == m_Open.end() || iter->second.used < oldest->second.used)){
+				oldest = iter;
+			}
+		}
+		if(oldest != m_Open.end()){
+			close(oldest->second.fd);
+			m_Open.erase(oldest);
+		}
+	}
+	//Open relative to the parent if we already have it
+	wxString parent, name;
+	Split(wxFileName::DirName(folder), parent, name);
+	std::map<wxString, OpenFolder>::iterator parentiter = m_Open.find(parent);
+	int fd;
+	if(parentiter != m_Open.end() && !name.empty()){
+		fd = openat(parentiter->second.fd, name.fn_str(), O_RDONLY | O_DIRECTORY);
+	}
+	else{
+		fd = open(folder.fn_str(), O_RDONLY | O_DIRECTORY);
+	}
+	if(fd >= 0){
+		OpenFolder entry;
+		entry.fd = fd;
+		entry.used = ++m_Uses;
+		m_Open[folder] = entry;
+	}
+	return fd;
+}
+
+void FolderCache::CloseAll(){
+	for(std::map<wxString, OpenFolder>::iterator iter = m_Open.begin(); iter != m_Open.end(); ++iter){
+		close(iter->second.fd);
+	}
+	m_Open.clear();
+}
+#endif
+
 wxString File::GetLongPath(const wxFileName &path){
 #ifdef __WXMSW__
     if(path.GetFullPath().Left(2) == "\\\\")
@@ -65,12 +710,17 @@ wxString File::GetLongPath(const wxFileName &path){
 }
 
 #ifdef __WXMSW__
-DWORD CALLBACK CopyProgressRoutine(LARGE_INTEGER WXUNUSED(TotalFileSize), LARGE_INTEGER WXUNUSED(TotalBytesTransferred), 
+DWORD CALLBACK CopyProgressRoutine(LARGE_INTEGER WXUNUSED(TotalFileSize), LARGE_INTEGER TotalBytesTransferred, 
 									LARGE_INTEGER WXUNUSED(StreamSize), LARGE_INTEGER WXUNUSED(StreamBytesTransferred), 
 									DWORD WXUNUSED(dwStreamNumber), DWORD WXUNUSED(dwCallbackReason),
 									HANDLE WXUNUSED(hSourceFile), HANDLE WXUNUSED(hDestinationFile), 
-									LPVOID WXUNUSED(lpData)){
-	if(wxGetApp().GetAbort()){
+									LPVOID lpData){
+	CopyProgress *progress = static_cast<CopyProgress*>(lpData);
+	if(progress->counts && TotalBytesTransferred.QuadPart > progress->transferred.QuadPart){
+		Progress::AddBytes(TotalBytesTransferred.QuadPart - progress->transferred.QuadPart);
+		progress->transferred.QuadPart = TotalBytesTransferred.QuadPart;
+	}
+	if(IsCancelled(progress->cancel)){
 		return PROGRESS_CANCEL;
 	}
 	else{
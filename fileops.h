@@ -4,20 +4,159 @@
 // License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
 /////////////////////////////////////////////////////////////////////////////////
 
+#ifndef H_FILEOPS
+#define H_FILEOPS
+
 #include "toucan.h"
 #include <wx/string.h>
 #include <wx/filename.h>
+#include <map>
+#include <set>
+#include <vector>
+
+//How hard a job tries to make sure what it writes survives a crash or the 
+//device being pulled out
+namespace Durability{
+    enum Level{
+        None,  //Leave it to the operating system
+        File,  //Flush every file before it is renamed into place
+        Group  //Flush in batches and once more at the end of the job
+    };
+
+    //Used for the jobs file and scripts
+    wxString ToString(Level level);
+    Level FromString(const wxString &level);
+}
+
+//Told as a resumable copy goes how much of it is safely on disk
+class CopyCheckpoint{
+
+public:
+	virtual ~CopyCheckpoint() {}
+	virtual void Checkpoint(long long offset) = 0;
+};
 
 namespace File{
-	int Copy(const wxFileName &source, const wxFileName &dest);
+	//What a copy takes from the source besides its contents and mode. Away 
+	//from Windows it is set on the still open copy, so nothing has to look 
+	//either file up by name again
+	enum Metadata{
+		KeepTimes = 1,
+		//Only fully works when we are root, otherwise it is what we can
+		KeepOwner = 2
+	};
+
+	//If flush is set the data is on disk before we return, if hash is given 
+	//it is set to the ContentHash of what was read. The copy gives up if the 
+	//token is cancelled
+	int Copy(const wxFileName &source, const wxFileName &dest, bool flush = false, unsigned long long *hash = NULL,
+	         int metadata = 0, const CancelToken *cancel = NULL);
+	//The same but to several places at once, reading the source only once. 
+	//errors is set for each destination, 0 if it was written, otherwise why 
+	//not or -1 if we were stopped. It fails if none were written
+	int Copy(const wxFileName &source, const std::vector<wxFileName> &dests, std::vector<int> &errors, 
+	         bool flush = false, unsigned long long *hash = NULL, int metadata = 0, const CancelToken *cancel = NULL);
+	//Carries on a copy from offset if what is already in dest still matches,
+	//otherwise starts again. If we are stopped what is written is kept
+	int Resume(const wxFileName &source, const wxFileName &dest, long long offset, CopyCheckpoint *checkpoint, 
+	           bool flush = false, unsigned long long *hash = NULL, int metadata = 0, const CancelToken *cancel = NULL);
 	int Rename(const wxFileName &source, const wxFileName &dest, bool overwrite);
+	//Makes dest another name for source, fails where hard links aren't 
+	//supported
+	int Link(const wxFileName &source, const wxFileName &dest);
 	int Delete(const wxFileName &path, bool recycle, bool ignorero);
+	//Flushes a file or the entries of a directory to disk
+	bool Flush(const wxString &path);
     //In wxMSW we get the full path and then preprend \\?\ to avoid filename limits
     wxString GetLongPath(const wxFileName &path);
 }
 
+//Tracks what a job has written and flushes it according to the durability
+//level, so we don't have to pay for a synchronous flush on every small file
+class WriteBarrier{
+
+public:
+	WriteBarrier(Durability::Level level);
+	~WriteBarrier();
+
+	//Call once a file has been written and renamed into place, false if a 
+	//flush it led to failed
+	bool Written(const wxFileName &path);
+	//Flushes anything still outstanding, false if any of it failed
+	bool Commit();
+	//True if nothing written since the last commit is waiting to be flushed
+	bool IsFlushed() const {return m_Level != Durability::Group || m_Files == 0;}
+
+	const Durability::Level& GetLevel() const {return m_Level;}
+
+private:
+	Durability::Level m_Level;
+	unsigned long m_Files;
+	unsigned long long m_Bytes;
+	//What still needs flushing in group mode, on linux we only keep one folder
+	//per device as we flush the whole filesystem at once
+	std::set<wxString> m_Pending;
+#ifdef __LINUX__
+	std::map<unsigned long long, wxString> m_Devices;
+#endif
+};
+
+//Remembers which folders are known to exist and, away from Windows, keeps 
+//them open so the files in them can be worked on by name with the *at calls 
+//rather than resolving the whole path every time
+class FolderCache{
+
+public:
+	FolderCache();
+	~FolderCache();
+
+	//Makes sure the folder and all of its parents exist
+	bool Create(const wxFileName &folder);
+	//Call once a folder has gone so nothing in it is thought to exist
+	void Forget(const wxFileName &folder);
+
+	bool Rename(const wxFileName &source, const wxFileName &dest);
+	bool Remove(const wxFileName &path, bool recycle, bool ignorero);
+	bool RemoveFolder(const wxFileName &folder);
+	bool SetTimes(const wxFileName &path, const wxDateTime &access, const wxDateTime &mod, const wxDateTime &created);
+	//Gives dest the times of source, looking both up from their open folders
+	bool CopyTimes(const wxFileName &source, const wxFileName &dest);
+
+private:
+	//Splits a file or folder into the folder it is in and its name
+	static void Split(const wxFileName &path, wxString &parent, wxString &name);
+
+	std::set<wxString> m_Known;
+#ifndef __WXMSW__
+	struct OpenFolder{
+		int fd;
+		//When it was last asked for, the least recently used is closed first
+		unsigned long long used;
+	};
+
+	//An open descriptor for a folder, owned by the cache, or -1. Making room
+	//for it never closes the one for keep, so two can be used together
+	int Open(const wxString &folder, const wxString &keep = wxEmptyString);
+	void CloseAll();
+
+	std::map<wxString, OpenFolder> m_Open;
+	unsigned long long m_Uses;
+#endif
+};
+
 #ifdef __WXMSW__
+    //Running totals for CopyFileEx, only the first of several copies counts 
+    //towards the progress
+    struct CopyProgress{
+        LARGE_INTEGER transferred;
+        bool counts;
+        const CancelToken *cancel;
+    };
+
+    //lpData points to a CopyProgress
     DWORD CALLBACK CopyProgressRoutine(LARGE_INTEGER TotalFileSize, LARGE_INTEGER TotalBytesTransferred, LARGE_INTEGER StreamSize,
                                        LARGE_INTEGER StreamBytesTransferred, DWORD dwStreamNumber, DWORD dwCallbackReason,
                                        HANDLE hSourceFile, HANDLE hDestinationFile, LPVOID lpData);
 #endif
+
+#endif
@@ -14,6 +14,7 @@
 #include <wx/gbsizer.h>
 #include <wx/stc/stc.h>
 #include <wx/grid.h>
+#include <wx/spinctrl.h>
 #include <wx/wx.h>
 
 #include "frmmain.h"
@@ -29,6 +30,7 @@
 #include "../data/securedata.h"
 #include "../data/backupdata.h"
 #include "../data/syncdata.h"
+#include "../sync/syncplan.h"
 #include "../controls/syncctrl.h"
 #include "../controls/previewctrl.h"
 #include "../controls/localdirctrl.h"
@@ -104,6 +106,8 @@ BEGIN_EVENT_TABLE(frmMain, wxFrame)
 	EVT_BUTTON(ID_RULES_REMOVE, frmMain::OnRulesRemoveClick)
 	EVT_BUTTON(ID_RULES_ADDITEM, frmMain::OnRulesAddItemClick)
 	EVT_BUTTON(ID_RULES_REMOVEITEM, frmMain::OnRulesRemoveItemClick)
+	EVT_BUTTON(ID_RULES_EXPLAIN, frmMain::OnRulesExplainClick)
+	EVT_TEXT_ENTER(ID_RULES_EXPLAIN_TXT, frmMain::OnRulesExplainClick)
 	
 	//Variables
 	EVT_BUTTON(ID_VARIABLES_SAVE, frmMain::OnVariablesSaveClick)
@@ -195,6 +199,13 @@ void frmMain::Init(){
 	m_Sync_Recycle = NULL;
 	m_SyncPreviewChanges = NULL;
 	m_SyncNoSkipped = NULL;
+	m_SyncVerify = NULL;
+	m_Sync_Durability = NULL;
+	m_SyncBackground = NULL;
+	m_SyncBandwidth = NULL;
+	m_SyncIops = NULL;
+	m_SyncVersions = NULL;
+	m_SyncKeepVersions = NULL;
 	BackupTopSizer = NULL;
 	m_Backup_Job_Select = NULL;
 	m_Backup_Rules = NULL;
@@ -216,6 +227,7 @@ void frmMain::Init(){
 	m_Secure_Function = NULL;
 	m_Rules_Name = NULL;
 	m_RulesGrid = NULL;
+	m_Rules_Explain_Txt = NULL;
 	m_Script_Styled = NULL;
 
 	menuRules = NULL;
@@ -348,6 +360,50 @@ void frmMain::CreateControls(){
 	m_SyncNoSkipped->SetValue(false);
 	SyncOtherSizer->Add(m_SyncNoSkipped, 0, wxALIGN_LEFT|wxALL, border);
 
+	m_SyncVerify = new wxCheckBox(SyncPanel, ID_SYNC_VERIFY, _("Verify Copied Files"));
+	m_SyncVerify->SetValue(false);
+	SyncOtherSizer->Add(m_SyncVerify, 0, wxALIGN_LEFT|wxALL, border);
+
+	wxStaticText* SyncDurabilityStatic = new wxStaticText(SyncPanel, wxID_ANY, _("Flush to Disk"));
+	SyncOtherSizer->Add(SyncDurabilityStatic, 0, wxALIGN_LEFT|wxLEFT|wxRIGHT|wxTOP, border);
+
+	//These must stay in the same order as Durability::Level
+	wxArrayString m_Sync_DurabilityStrings;
+	m_Sync_DurabilityStrings.Add(_("Never"));
+	m_Sync_DurabilityStrings.Add(_("After Every File"));
+	m_Sync_DurabilityStrings.Add(_("In Batches"));
+	m_Sync_Durability = new wxComboBox(SyncPanel, ID_SYNC_DURABILITY, _T(""), wxDefaultPosition, wxDefaultSize, m_Sync_DurabilityStrings, wxCB_DROPDOWN|wxCB_READONLY);
+	m_Sync_Durability->SetSelection(0);
+	SyncOtherSizer->Add(m_Sync_Durability, 0, wxALIGN_LEFT|wxALL|wxEXPAND, border);
+
+	m_SyncBackground = new wxCheckBox(SyncPanel, ID_SYNC_BACKGROUND, _("Run in the Background"));
+	m_SyncBackground->SetValue(false);
+	SyncOtherSizer->Add(m_SyncBackground, 0, wxALIGN_LEFT|wxALL, border);
+
+	//Zero means no limit for both
+	wxStaticText* SyncBandwidthStatic = new wxStaticText(SyncPanel, wxID_ANY, _("Bandwidth Limit (KB/s)"));
+	SyncOtherSizer->Add(SyncBandwidthStatic, 0, wxALIGN_LEFT|wxLEFT|wxRIGHT|wxTOP, border);
+
+	m_SyncBandwidth = new wxSpinCtrl(SyncPanel, ID_SYNC_BANDWIDTH, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 10000000, 0);
+	SyncOtherSizer->Add(m_SyncBandwidth, 0, wxALIGN_LEFT|wxALL|wxEXPAND, border);
+
+	wxStaticText* SyncIopsStatic = new wxStaticText(SyncPanel, wxID_ANY, _("Operations Limit (per second)"));
+	SyncOtherSizer->Add(SyncIopsStatic, 0, wxALIGN_LEFT|wxLEFT|wxRIGHT|wxTOP, border);
+
+	m_SyncIops = new wxSpinCtrl(SyncPanel, ID_SYNC_IOPS, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 1000000, 0);
+	SyncOtherSizer->Add(m_SyncIops, 0, wxALIGN_LEFT|wxALL|wxEXPAND, border);
+
+	m_SyncVersions = new wxCheckBox(SyncPanel, ID_SYNC_VERSIONS, _("Keep Old Versions"));
+	m_SyncVersions->SetValue(false);
+	SyncOtherSizer->Add(m_SyncVersions, 0, wxALIGN_LEFT|wxALL, border);
+
+	//Zero keeps them for ever
+	wxStaticText* SyncKeepVersionsStatic = new wxStaticText(SyncPanel, wxID_ANY, _("Days to Keep Versions"));
+	SyncOtherSizer->Add(SyncKeepVersionsStatic, 0, wxALIGN_LEFT|wxLEFT|wxRIGHT|wxTOP, border);
+
+	m_SyncKeepVersions = new wxSpinCtrl(SyncPanel, ID_SYNC_KEEP_VERSIONS, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 100000, 0);
+	SyncOtherSizer->Add(m_SyncKeepVersions, 0, wxALIGN_LEFT|wxALL|wxEXPAND, border);
+
 	wxBoxSizer* SyncButtonsSizer = new wxBoxSizer(wxVERTICAL);
 	SyncTopSizer->Add(SyncButtonsSizer, 1, wxGROW|wxALL|wxALIGN_CENTER_VERTICAL, border);	
 
@@ -681,6 +737,17 @@ void frmMain::CreateControls(){
 	wxBitmapButton* RulesRemoveItem = new wxBitmapButton(RulesPanel, ID_RULES_REMOVEITEM, GetBitmapResource(wxT("remove.png")));
 	RulesRightSizer->Add(RulesRemoveItem, 0, wxALIGN_CENTER_HORIZONTAL|wxALL, border);
 
+	//Rules - Explain
+	wxStaticBox* RulesExplain = new wxStaticBox(RulesPanel, wxID_ANY, _("Explain"));
+	wxStaticBoxSizer* RulesExplainSizer = new wxStaticBoxSizer(RulesExplain, wxHORIZONTAL);
+	RulesSizer->Add(RulesExplainSizer, 0, wxGROW|wxLEFT|wxRIGHT|wxBOTTOM, 2 * border);
+
+	m_Rules_Explain_Txt = new wxTextCtrl(RulesPanel, ID_RULES_EXPLAIN_TXT, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_PROCESS_ENTER);
+	RulesExplainSizer->Add(m_Rules_Explain_Txt, 1, wxALIGN_CENTER_VERTICAL|wxALL, border);
+
+	wxButton* RulesExplainButton = new wxButton(RulesPanel, ID_RULES_EXPLAIN, _("Explain"));
+	RulesExplainSizer->Add(RulesExplainButton, 0, wxALIGN_CENTER_VERTICAL|wxALL, border);
+
 	//Variables
 	wxPanel* VariablesPanel = new wxPanel(m_Notebook, ID_PANEL_VARIABLES, wxDefaultPosition, wxDefaultSize, wxNO_BORDER|wxTAB_TRAVERSAL);
 	wxBoxSizer* VariablesSizer = new wxBoxSizer(wxVERTICAL);
@@ -1143,6 +1210,16 @@ void frmMain::OnRulesRemoveItemClick(wxCommandEvent& WXUNUSED(event)){
     m_RulesGrid->DeleteSelected();
 }
 
+//ID_RULES_EXPLAIN
+void frmMain::OnRulesExplainClick(wxCommandEvent& WXUNUSED(event)){
+	if(m_Rules_Explain_Txt->GetValue() == wxEmptyString){
+		return;
+	}
+	//Explain using the rules as they are in the grid, even if they are unsaved
+	RuleSet rules = m_RulesGrid->SaveData();
+	wxMessageBox(rules.Explain(Path::Normalise(m_Rules_Explain_Txt->GetValue())), _("Explain"), wxICON_INFORMATION|wxOK);
+}
+
 //ID_RULES_SAVE
 void frmMain::OnRulesSaveClick(wxCommandEvent& WXUNUSED(event)){
     //If there is no existing name prompt for one
@@ -1394,7 +1471,14 @@ void frmMain::OnSyncRunClick(wxCommandEvent& WXUNUSED(event)){
 			<< "attributes=" << ToString(m_Sync_Attributes->IsChecked()) << ","
 			<< "recycle=" << ToString(m_Sync_Recycle->IsChecked()) << ","
 			<< "ignorero=" << ToString(m_Sync_Ignore_Readonly->IsChecked()) << ","
-			<< "noskipped=" << ToString(m_SyncNoSkipped->IsChecked()) << "}, ";
+			<< "noskipped=" << ToString(m_SyncNoSkipped->IsChecked()) << ","
+			<< "verify=" << ToString(m_SyncVerify->IsChecked()) << ","
+			<< "durability=\"" << Durability::ToString(static_cast<Durability::Level>(m_Sync_Durability->GetSelection())) << "\","
+			<< "background=" << ToString(m_SyncBackground->IsChecked()) << ","
+			<< "bandwidthlimit=" << m_SyncBandwidth->GetValue() << ","
+			<< "iopslimit=" << m_SyncIops->GetValue() << ","
+			<< "versions=" << ToString(m_SyncVersions->IsChecked()) << ","
+			<< "keepversions=" << m_SyncKeepVersions->GetValue() << "}, ";
 	//rules
 	command << "[[" << m_Sync_Rules->GetStringSelection() << "]])";
 	wxGetApp().m_LuaManager->Run(command);
@@ -1469,6 +1553,8 @@ void frmMain::OnSecureRunClick(wxCommandEvent& WXUNUSED(event)){
 void frmMain::OnSyncPreviewClick(wxCommandEvent& WXUNUSED(event)){
 	wxBusyCursor cursor;
 	m_Notebook->Disable();
+	//Start afresh, the run after this preview reuses what it works out
+	SyncDecisions::Clear();
 
 	m_Sync_Dest_Tree->SetPreview(true);
 	m_Sync_Dest_Tree->SetPreviewChanges(m_SyncPreviewChanges->IsChecked());
@@ -1592,6 +1678,8 @@ void frmMain::OnVariablesSaveClick(wxCommandEvent& WXUNUSED(event)){
 		m_Variables_List->GetItem(itemcol2);
 		config.Write(m_Variables_Name->GetValue() + wxT("/") + itemcol1.m_text, itemcol2.m_text);
 	}
+	config.Flush();
+	Path::InvalidateVariables();
 }
 
 //ID_VARIABLES_ADD
@@ -1632,6 +1720,7 @@ void frmMain::OnVariablesRemoveClick(wxCommandEvent& WXUNUSED(event)){
         wxFileConfig config("", "", Locations::GetSettingsPath() + "variables.ini");
         config.DeleteGroup(m_Variables_Name->GetValue());
         config.Flush();
+        Path::InvalidateVariables();
         m_Variables_Name->Delete(m_Variables_Name->GetSelection());
         m_Variables_Name->SetValue(wxEmptyString);
     }
@@ -2054,6 +2143,13 @@ void frmMain::ClearToDefault(){
 		m_Sync_Recycle->SetValue(false);
 		m_SyncPreviewChanges->SetValue(false);
 		m_SyncNoSkipped->SetValue(false);
+		m_SyncVerify->SetValue(false);
+		m_Sync_Durability->SetSelection(0);
+		m_SyncBackground->SetValue(false);
+		m_SyncBandwidth->SetValue(0);
+		m_SyncIops->SetValue(0);
+		m_SyncVersions->SetValue(false);
+		m_SyncKeepVersions->SetValue(0);
 		m_SyncCheckFull->SetValue(false);
 		m_SyncCheckShort->SetValue(false);
 		m_SyncCheckSize->SetValue(false);
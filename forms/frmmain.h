@@ -24,6 +24,7 @@ class wxSlider;
 class wxStyledTextCtrl;
 class wxGrid;
 class wxChoice;
+class wxSpinCtrl;
 
 class DirCtrl;
 class LocalDirCtrl;
@@ -74,6 +75,13 @@ enum{
 	ID_SYNC_RECYCLE,
 	ID_SYNC_PREVIEW_CHANGES,
 	ID_SYNC_NO_SKIPPED,
+	ID_SYNC_VERIFY,
+	ID_SYNC_DURABILITY,
+	ID_SYNC_BACKGROUND,
+	ID_SYNC_BANDWIDTH,
+	ID_SYNC_IOPS,
+	ID_SYNC_VERSIONS,
+	ID_SYNC_KEEP_VERSIONS,
 	//Backup
 	ID_PANEL_BACKUP,
 	ID_BACKUP_RUN,
@@ -129,6 +137,8 @@ enum{
     ID_RULES_GRID,
 	ID_RULES_ADDITEM,
 	ID_RULES_REMOVEITEM,
+	ID_RULES_EXPLAIN_TXT,
+	ID_RULES_EXPLAIN,
 	//Variables
 	ID_PANEL_VARIABLES,
 	ID_VARIABLES_NAME,
@@ -251,6 +261,7 @@ public:
 	void OnRulesRemoveClick(wxCommandEvent& event);
 	void OnRulesAddItemClick(wxCommandEvent& event);
 	void OnRulesRemoveItemClick(wxCommandEvent& event);
+	void OnRulesExplainClick(wxCommandEvent& event);
 	
 	//Variables
 	void OnVariablesSaveClick(wxCommandEvent& event);
@@ -341,6 +352,13 @@ public:
 	wxCheckBox* m_Sync_Recycle;
 	wxCheckBox* m_SyncPreviewChanges;
 	wxCheckBox* m_SyncNoSkipped;
+	wxCheckBox* m_SyncVerify;
+	wxComboBox* m_Sync_Durability;
+	wxCheckBox* m_SyncBackground;
+	wxSpinCtrl* m_SyncBandwidth;
+	wxSpinCtrl* m_SyncIops;
+	wxCheckBox* m_SyncVersions;
+	wxSpinCtrl* m_SyncKeepVersions;
 	
 	//Backup
 	wxBoxSizer* BackupTopSizer;
@@ -370,6 +388,7 @@ public:
 	wxStaticBoxSizer* RulesNameSizer;
 	wxComboBox* m_Rules_Name;
     RulesGrid* m_RulesGrid;
+	wxTextCtrl* m_Rules_Explain_Txt;
 	
 	//Variables
 	wxBoxSizer* VariablesTopSizer;
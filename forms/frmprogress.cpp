@@ -11,6 +11,7 @@
 #include "../toucan.h"
 #include "../settings.h"
 #include "../basicfunctions.h"
+#include "../progress.h"
 #include "../controls/progresslistctrl.h"
 
 #include <boost/interprocess/ipc/message_queue.hpp>
@@ -20,8 +21,10 @@ using namespace boost::interprocess;
 #include <wx/stdpaths.h>
 #include <wx/listctrl.h>
 #include <wx/textfile.h>
+#include <wx/file.h>
 #include <wx/datetime.h>
 #include <wx/tglbtn.h>
+#include <wx/timer.h>
 #include <wx/wx.h>
 
 #if defined(__WXMSW__) && !defined(__MINGW32__)
@@ -36,6 +39,7 @@ BEGIN_EVENT_TABLE(frmProgress, wxDialog)
 	EVT_BUTTON(wxID_CLOSE, frmProgress::OnCloseClick)
     EVT_SIZE(frmProgress::OnSize)
     EVT_IDLE(frmProgress::OnIdle)
+    EVT_TIMER(ID_PROGRESS_TIMER, frmProgress::OnTimer)
 END_EVENT_TABLE()
 
 //Constructor
@@ -69,6 +73,8 @@ void frmProgress::Init(){
 	m_Cancel = NULL;
 	m_Save = NULL;
 	m_Gauge = NULL;
+	m_Status = NULL;
+	m_Timer = NULL;
 }
 
 //Create controls
@@ -86,9 +92,14 @@ void frmProgress::CreateControls(){
     wxBoxSizer* ProgressSizer = new wxBoxSizer(wxVERTICAL);
     MiddleSizer->Add(ProgressSizer, 1, wxGROW);
 
-	m_Gauge = new wxGauge(Panel, ID_PROGRESS_GAUGE, 100, wxDefaultPosition, wxDefaultSize, wxGA_SMOOTH|wxGA_HORIZONTAL);
+	m_Gauge = new wxGauge(Panel, ID_PROGRESS_GAUGE, 1000, wxDefaultPosition, wxDefaultSize, wxGA_SMOOTH|wxGA_HORIZONTAL);
 	ProgressSizer->Add(m_Gauge, 0, wxALIGN_CENTER_HORIZONTAL|wxALL|wxEXPAND, 5);
 
+	m_Status = new wxStaticText(Panel, wxID_ANY, wxEmptyString);
+	ProgressSizer->Add(m_Status, 0, wxLEFT|wxRIGHT|wxEXPAND, 5);
+
+	m_Timer = new wxTimer(this, ID_PROGRESS_TIMER);
+
 	m_List = new ProgressListCtrl(Panel);
 	ProgressSizer->Add(m_List, 1, wxGROW|wxALL, 5);
 
@@ -156,6 +167,9 @@ void frmProgress::OnCloseClick(wxCommandEvent& WXUNUSED(event)){
 	}
 #endif
 	wxGetApp().m_LuaManager->NullWindow();
+    m_Timer->Stop();
+    delete m_Timer;
+    m_Timer = NULL;
     Destroy();
 }
 
@@ -193,15 +207,28 @@ void frmProgress::OnSaveClick(wxCommandEvent& WXUNUSED(event)){
 	}
 }
 
-void frmProgress::IncrementGauge(){
-	m_Gauge->SetValue(m_Gauge->GetValue() + 1);
+void frmProgress::UpdateGauge(){
+	Progress::Status status = Progress::Sample();
+	m_Status->SetLabel(Progress::Describe(status));
+
+	double fraction = status.GetFraction();
+	//Until the count has found something we can only show that we are busy
+	if(fraction < 0){
+		m_Gauge->Pulse();
+		return;
+	}
+	m_Gauge->SetValue((int)(fraction * m_Gauge->GetRange()));
 #if defined(__WXMSW__) && !defined(__MINGW32__)
 	if(m_Gauge->IsShown() && m_Taskbar){
-		m_Taskbar->SetProgressValue(static_cast<HWND>(wxGetApp().MainWindow->GetHandle()), m_Gauge->GetValue() + 1, m_Gauge->GetRange());
+		m_Taskbar->SetProgressValue(static_cast<HWND>(wxGetApp().MainWindow->GetHandle()), m_Gauge->GetValue(), m_Gauge->GetRange());
 	}
 #endif
 }
 
+void frmProgress::OnTimer(wxTimerEvent& WXUNUSED(event)){
+	UpdateGauge();
+}
+
 void frmProgress::FinishGauge(){
 	m_Gauge->SetValue(m_Gauge->GetRange());
 #if defined(__WXMSW__) && !defined(__MINGW32__)
@@ -233,7 +260,17 @@ void frmProgress::OnIdle(wxIdleEvent &event){
                 bool error;
         	    long index = m_List->GetItemCount();
 
-                column1 = wxString(message.c_str(), wxConvUTF8, size);
+                //Events are only turned into text now that we show them
+                ProgressEvent event;
+                if(ProgressEvent::Decode(message.c_str(), size, event)){
+                    column1 = event.Format();
+                    if(wxGetApp().m_EventFile){
+                        wxGetApp().m_EventFile->Write(event.ToJson() + "\n", wxConvUTF8);
+                    }
+                }
+                else{
+                    column1 = wxString(message.c_str(), wxConvUTF8, size);
+                }
                 error = (priority == Error);
 
 			    //TODO: Do we really want to see timestamps only at the beginning and end?
@@ -244,10 +281,6 @@ void frmProgress::OnIdle(wxIdleEvent &event){
                 m_List->AddItem(error, column0, column1);
                 m_List->SetItemCount(index + 1);
 
-                if(priority == Message || priority == Error){
-                    IncrementGauge();
-                }
-
                 if(m_Autoscroll->GetValue()){
 			        m_List->EnsureVisible(index);
 			        Update();
@@ -315,6 +348,9 @@ void frmProgress::StartProgress(){
     m_Cancel->Enable(true);
 
     SetCursor(wxCURSOR_ARROWWAIT);
+
+    //The rates are smoothed so once a second is plenty
+    m_Timer->Start(1000);
 }
 
 void frmProgress::FinishProgress(){
@@ -329,6 +365,8 @@ void frmProgress::FinishProgress(){
     m_Cancel->SetLabel(_("Close"));
 
     //Let the user know we have finished
+    m_Timer->Stop();
+    UpdateGauge();
     FinishGauge();
     RequestUserAttention();
 
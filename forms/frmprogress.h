@@ -16,6 +16,9 @@
 class ProgressListCtrl;
 class wxButton;
 class wxGauge;
+class wxStaticText;
+class wxTimer;
+class wxTimerEvent;
 class wxBitmapButton;
 class wxBitmapToggleButton;
 
@@ -24,7 +27,8 @@ enum{
 	ID_PANEL_PROGRESS,
 	ID_PROGRESS_LIST,
 	ID_PROGRESS_GAUGE,
-    ID_PROGRESS_AUTOSCROLL
+    ID_PROGRESS_AUTOSCROLL,
+	ID_PROGRESS_TIMER
 };
 
 class frmProgress: public wxDialog
@@ -47,6 +51,7 @@ public:
 #endif
 
     void OnIdle(wxIdleEvent& event);
+    void OnTimer(wxTimerEvent& event);
     void OnSize(wxSizeEvent& event);
 	void OnOkClick(wxCommandEvent& event);
 	void OnCancelClick(wxCommandEvent& event);
@@ -58,7 +63,8 @@ public:
     void StartProgress();
     void FinishProgress();
 
-	void IncrementGauge();
+	//Updates the gauge, rates and time remaining from the running job
+	void UpdateGauge();
 	void FinishGauge();
 
 	ProgressListCtrl* m_List;
@@ -66,6 +72,8 @@ public:
 	wxBitmapButton* m_Save;
     wxBitmapToggleButton* m_Autoscroll;
 	wxGauge* m_Gauge;
+	wxStaticText* m_Status;
+	wxTimer* m_Timer;
 };
 
 #endif
@@ -0,0 +1,179 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "hash.h"
+#include "cancel.h"
+#include <wx/file.h>
+#include <string.h>
+#include <vector>
+
+#ifndef __WXMSW__
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace{
+	const unsigned long long Prime1 = 11400714785074694791ULL;
+	const unsigned long long Prime2 = 14029467366897019727ULL;
+	const unsigned long long Prime3 = 1609587929392839161ULL;
+	const unsigned long long Prime4 = 9650029242287828579ULL;
+	const unsigned long long Prime5 = 2870177450012600261ULL;
+
+	inline unsigned long long Rotate(unsigned long long value, int bits){
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	//The hash is defined on little endian values whatever we are running on
+	inline unsigned long long Read64(const unsigned char *data){
+		unsigned long long value = 0;
+		for(int i = 7; i >= 0; i--){
+			value = (value << 8) | data[i];
+		}
+		return value;
+	}
+
+	inline unsigned long long Read32(const unsigned char *data){
+		return (unsigned long long)data[0] | ((unsigned long long)data[1] << 8) 
+		     | ((unsigned long long)data[2] << 16) | ((unsigned long long)data[3] << 24);
+	}
+
+	inline unsigned long long Round(unsigned long long accumulator, unsigned long long input){
+		accumulator += input * Prime2;
+		accumulator = Rotate(accumulator, 31);
+		return accumulator * Prime1;
+	}
+
+	inline unsigned long long Merge(unsigned long long accumulator, unsigned long long value){
+		accumulator ^= Round(0, value);
+		return accumulator * Prime1 + Prime4;
+	}
+}
+
+ContentHash::ContentHash(unsigned long long seed) : m_Seed(seed){
+	Reset();
+}
+
+void ContentHash::Reset(){
+	m_Total = 0;
+	m_Buffered = 0;
+	m_State[0] = m_Seed + Prime1 + Prime2;
+	m_State[1] = m_Seed + Prime2;
+	m_State[2] = m_Seed;
+	m_State[3] = m_Seed - Prime1;
+}
+
+void ContentHash::Update(const void *data, size_t length){
+	const unsigned char *pos = static_cast<const unsigned char*>(data);
+	const unsigned char *end = pos + length;
+	m_Total += length;
+
+	//Top up anything left over from last time first
+	if(m_Buffered > 0){
+		size_t needed = wxMin(sizeof(m_Buffer) - m_Buffered, length);
+		memcpy(m_Buffer + m_Buffered, pos, needed);
+		m_Buffered += needed;
+		pos += needed;
+		if(m_Buffered < sizeof(m_Buffer)){
+			return;
+		}
+		for(int i = 0; i < 4; i++){
+			m_State[i] = Round(m_State[i], Read64(m_Buffer + i * 8));
+		}
+		m_Buffered = 0;
+	}
+	while(end - pos >= 32){
+		for(int i = 0; i < 4; i++){
+			m_State[i] = Round(m_State[i], Read64(pos + i * 8));
+		}
+		pos += 32;
+	}
+	if(pos < end){
+		memcpy(m_Buffer, pos, end - pos);
+		m_Buffered = end - pos;
+	}
+}
+
+unsigned long long ContentHash::GetValue() const{
+	unsigned long long hash;
+	if(m_Total >= 32){
+		hash = Rotate(m_State[0], 1) + Rotate(m_State[1], 7) + Rotate(m_State[2], 12) + Rotate(m_State[3], 18);
+		for(int i = 0; i < 4; i++){
+			hash = Merge(hash, m_State[i]);
+		}
+	}
+	else{
+		hash = m_Seed + Prime5;
+	}
+	hash += m_Total;
+
+	const unsigned char *pos = m_Buffer;
+	const unsigned char *end = m_Buffer + m_Buffered;
+	for(; pos + 8 <= end; pos += 8){
+		hash ^= Round(0, Read64(pos));
+		hash = Rotate(hash, 27) * Prime1 + Prime4;
+	}
+	if(pos + 4 <= end){
+		hash ^= Read32(pos) * Prime1;
+		hash = Rotate(hash, 23) * Prime2 + Prime3;
+		pos += 4;
+	}
+	for(; pos < end; pos++){
+		hash ^= *pos * Prime5;
+		hash = Rotate(hash, 11) * Prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+wxString ContentHash::ToString(unsigned long long hash){
+	return wxString::Format("%016llx", hash);
+}
+
+bool ContentHash::File(const wxString &path, unsigned long long &hash, bool uncached, const CancelToken *cancel){
+	wxFile file(path, wxFile::read);
+	if(!file.IsOpened()){
+		return false;
+	}
+#ifdef __LINUX__
+	//Anything still dirty has to be written before it can be dropped
+	if(uncached){
+		fdatasync(file.fd());
+		posix_fadvise(file.fd(), 0, 0, POSIX_FADV_DONTNEED);
+	}
+#elif defined(__WXMAC__)
+	if(uncached){
+		fsync(file.fd());
+		fcntl(file.fd(), F_NOCACHE, 1);
+	}
+#else
+	wxUnusedVar(uncached);
+#endif
+	ContentHash content;
+	std::vector<char> buffer(1024 * 1024);
+	for(;;){
+		ssize_t count = file.Read(&buffer[0], buffer.size());
+		if(count == wxInvalidOffset || (cancel && cancel->IsCancelled())){
+			return false;
+		}
+		if(count == 0){
+			break;
+		}
+		content.Update(&buffer[0], count);
+	}
+#ifdef __LINUX__
+	//Don't leave a file we only wanted to check taking up the cache
+	if(uncached){
+		posix_fadvise(file.fd(), 0, 0, POSIX_FADV_DONTNEED);
+	}
+#endif
+	hash = content.GetValue();
+	return true;
+}
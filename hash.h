@@ -0,0 +1,43 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_HASH
+#define H_HASH
+
+#include <wx/string.h>
+#include <stddef.h>
+
+class CancelToken;
+
+//A fast 64 bit hash of a file's contents that can be worked out a piece at a
+//time as the file is read. It uses the xxHash64 algorithm and is meant for 
+//spotting damaged copies, not for security
+class ContentHash{
+
+public:
+	ContentHash(unsigned long long seed = 0);
+
+	void Reset();
+	void Update(const void *data, size_t length);
+	//The hash of everything so far, more can still be added afterwards
+	unsigned long long GetValue() const;
+
+	static wxString ToString(unsigned long long hash);
+	//Hashes a whole file. If uncached is set we try to read it from the disk
+	//rather than what the operating system has kept in memory. Fails part 
+	//way through if the token is cancelled
+	static bool File(const wxString &path, unsigned long long &hash, bool uncached = false, 
+	                 const CancelToken *cancel = NULL);
+
+private:
+	unsigned long long m_Seed;
+	unsigned long long m_Total;
+	unsigned long long m_State[4];
+	unsigned char m_Buffer[32];
+	size_t m_Buffered;
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include <wx/utils.h>
 #include <wx/filename.h>
 #include <wx/log.h>
+#include <wx/thread.h>
 
 #include "path.h"
 #include "basicfunctions.h"
@@ -18,6 +19,8 @@
 #include <Windows.h>
 #include <wx/msw/winundef.h>
 
+#include <vector>
+
 namespace Locations{
     namespace{
         wxString settingspath;
@@ -32,6 +35,321 @@ namespace Locations{
     }
 }
 
+namespace{
+    //The time dependent variables, these are the only ones that need to be
+    //evaluated each time a path is normalised
+    enum TokenType{
+        Literal,
+        Date,
+        Time,
+        Year,
+        Month,
+        MonthName,
+        MonthShortName,
+        Day,
+        DayName,
+        DayShortName,
+        Hour,
+        Minute,
+        DayOfWeek,
+        WeekOfYear
+    };
+
+    struct Token{
+        TokenType type;
+        wxString text;
+
+        Token(TokenType type, const wxString &text = wxEmptyString) : type(type), text(text)
+        {}
+    };
+
+    typedef std::vector<Token> CompiledPath;
+
+    //Time dependent variables are replaced by these markers while expanding so
+    //the result can be cached, a marker never contains an @
+    const wxChar markerstart = 0x01;
+    const wxChar markerend = 0x02;
+
+    //Cached copies of everything that does not change during a run
+    wxCriticalSection cachesection;
+    std::map<wxString, TokenType> timetokens;
+    std::map<wxString, wxString> builtins;
+    std::map<wxString, wxString> variables;
+    std::map<wxString, CompiledPath> compiled;
+    wxString variablespath;
+    wxLongLong variablestime = -1;
+    wxULongLong variablessize = 0;
+    wxLongLong lastcheck = 0;
+    bool loaded = false;
+
+    void SetupTokens(){
+        if(!timetokens.empty())
+            return;
+
+        timetokens["date"] = Date;
+        timetokens["time"] = Time;
+        timetokens["YYYY"] = Year;
+        timetokens["year"] = Year;
+        timetokens["MM"] = Month;
+        timetokens["month"] = Month;
+        timetokens["monthname"] = MonthName;
+        timetokens["monthshortname"] = MonthShortName;
+        timetokens["DD"] = Day;
+        timetokens["day"] = Day;
+        timetokens["dayname"] = DayName;
+        timetokens["dayshortname"] = DayShortName;
+        timetokens["hh"] = Hour;
+        timetokens["hour"] = Hour;
+        timetokens["mm"] = Minute;
+        timetokens["minute"] = Minute;
+        timetokens["dayofweek"] = DayOfWeek;
+        timetokens["weekofyear"] = WeekOfYear;
+    }
+
+    void LoadBuiltins(){
+        builtins.clear();
+        builtins["drive"] = wxPathOnly(wxStandardPaths::Get().GetExecutablePath()).Left(2);
+        builtins["docs"] = wxStandardPaths::Get().GetDocumentsDir();
+        builtins["username"] = wxGetUserId();
+#ifdef __WXMSW__
+        wxString name = wxEmptyString;
+        WCHAR volumeLabel[256]; 
+        GetVolumeInformation(wxPathOnly(wxStandardPaths::Get().GetExecutablePath()).Left(3), volumeLabel, sizeof(volumeLabel), NULL, 0, NULL, NULL, 0);
+        name.Printf(wxT("%s"),volumeLabel); 
+        builtins["volume"] = name;
+#else
+        builtins["volume"] = wxEmptyString;
+#endif
+        {
+            wxLogNull null;
+            wxFileConfig autorun("", "", wxPathOnly(wxStandardPaths::Get().GetExecutablePath()).Left(3) + wxFILE_SEP_PATH + wxT("autorun.inf"));
+            builtins["label"] = autorun.Read(wxT("Autorun/Label"));
+        }
+
+#ifdef __WXMSW__
+        Path::DriveLabels.clear();
+		TCHAR drives[256];  
+		if(GetLogicalDriveStrings(256, drives)){  
+			LPTSTR drive = drives;
+			int offset = _tcslen(drive) + 1;  
+			while(*drive){  
+				wxString volumename = wxEmptyString;
+				TCHAR label[256]; 
+				if(GetVolumeInformation(drive, label, sizeof(label), NULL, 0, NULL, NULL, 0)){
+					volumename.Printf(wxT("%s"),label); 
+					if(volumename != wxEmptyString){
+						Path::DriveLabels[volumename] = wxString(drive).Left(2);
+					}
+				}
+				drive += offset;  
+			}
+		}
+#endif
+    }
+
+    //Reads variables.ini, keeping only the expansion that applies to this computer
+    void LoadVariables(){
+        variables.clear();
+        if(!wxFileExists(variablespath))
+            return;
+
+        wxFileConfig config("", "", variablespath);
+        wxString name, value;
+        long dummy;
+        bool cont = config.GetFirstGroup(name, dummy);
+        while(cont){
+            if(config.Read(name + wxT("/") + wxGetFullHostName(), &value)
+            || config.Read(name + wxT("/") + _("Other"), &value)){
+                variables[name] = value;
+            }
+            cont = config.GetNextGroup(name, dummy);
+        }
+    }
+
+    //Reloads the variables if the file has changed, we only look at the file
+    //once a second so normalising many paths does not hit the disk
+    void CheckVariables(){
+        wxString path = Locations::GetSettingsPath() + "variables.ini";
+        wxLongLong now = wxGetLocalTimeMillis();
+        if(loaded && path == variablespath && now - lastcheck < 1000)
+            return;
+        lastcheck = now;
+
+        wxLongLong modified = -1;
+        wxULongLong size = 0;
+        if(wxFileExists(path)){
+            wxFileName name(path);
+            modified = name.GetModificationTime().GetValue();
+            size = name.GetSize();
+        }
+
+        if(!loaded || path != variablespath || modified != variablestime || size != variablessize){
+            if(!loaded){
+                SetupTokens();
+                LoadBuiltins();
+            }
+            variablespath = path;
+            variablestime = modified;
+            variablessize = size;
+            LoadVariables();
+            compiled.clear();
+            loaded = true;
+        }
+    }
+
+    bool LookupStatic(const wxString &token, wxString &value){
+        auto builtin = builtins.find(token);
+        if(builtin != builtins.end()){
+            value = builtin->second;
+            return true;
+        }
+        auto label = Path::DriveLabels.find(token);
+        if(label != Path::DriveLabels.end() && label->second != wxEmptyString){
+            value = label->second;
+            return true;
+        }
+        if(wxGetEnv(token, &value)){
+            return true;
+        }
+        auto variable = variables.find(token);
+        if(variable != variables.end()){
+            value = variable->second;
+            return true;
+        }
+        return false;
+    }
+
+    //A single pass of expansion, time dependent variables are replaced by markers
+    wxString ExpandOnce(const wxString &path){
+        wxString normalised = wxEmptyString;
+        wxStringTokenizer tkz(path, wxT("@"), wxTOKEN_RET_EMPTY_ALL);
+        bool previousmatched = true;
+        while(tkz.HasMoreTokens()){
+            wxString token = tkz.GetNextToken();
+            wxString value;
+            auto time = timetokens.find(token);
+            if(time != timetokens.end()){
+                normalised << markerstart << static_cast<int>(time->second) << markerend;
+                previousmatched = true;
+            }
+            else if(LookupStatic(token, value)){
+                normalised += value;
+                previousmatched = true;
+            }
+            else{
+                if(previousmatched){
+                    normalised += token;
+                }
+                else{
+                    normalised = normalised + wxT("@") + token;
+                }
+                //This time we did not match
+                previousmatched = false;
+            }
+        }
+        if(normalised.Length() == 2 && normalised.Right(1) == wxT(":")){
+            normalised += wxFILE_SEP_PATH;
+        }
+        return normalised;
+    }
+
+    CompiledPath Compile(const wxString &path){
+        //Variables can contain other variables so expand until nothing changes,
+        //the limit stops variables that refer to each other looping forever
+        wxString current = path;
+        for(int depth = 0; depth < 32 && current.find("@") != wxNOT_FOUND; depth++){
+            wxString expanded = ExpandOnce(current);
+            if(expanded == current)
+                break;
+            current = expanded;
+        }
+
+        CompiledPath tokens;
+        wxString literal;
+        for(size_t i = 0; i < current.length(); i++){
+            if(current[i] == markerstart){
+                size_t end = current.find(markerend, i);
+                long type;
+                current.Mid(i + 1, end - i - 1).ToLong(&type);
+                if(!literal.empty()){
+                    tokens.push_back(Token(Literal, literal));
+                    literal.clear();
+                }
+                tokens.push_back(Token(static_cast<TokenType>(type)));
+                i = end;
+            }
+            else{
+                literal += current[i];
+            }
+        }
+        if(!literal.empty()){
+            tokens.push_back(Token(Literal, literal));
+        }
+        return tokens;
+    }
+
+    wxString Evaluate(const CompiledPath &tokens){
+        wxDateTime now = wxDateTime::Now();
+        wxString normalised;
+        for(auto iter = tokens.begin(); iter != tokens.end(); ++iter){
+            switch((*iter).type){
+                case Literal:
+                    normalised += (*iter).text;
+                    break;
+                case Date:
+                    normalised += now.FormatISODate();
+                    break;
+                case Time:
+                    normalised += now.Format("%H") + "-" +  now.Format("%M");
+                    break;
+                case Year:
+                    normalised += now.Format("%Y");
+                    break;
+                case Month:
+                    normalised += now.Format("%m");
+                    break;
+                case MonthName:
+                    normalised += wxDateTime::GetMonthName(now.GetMonth());
+                    break;
+                case MonthShortName:
+                    normalised += wxDateTime::GetMonthName(now.GetMonth(), wxDateTime::Name_Abbr);
+                    break;
+                case Day:
+                    normalised += now.Format("%d");
+                    break;
+                case DayName:
+                    normalised += wxDateTime::GetWeekDayName(now.GetWeekDay());
+                    break;
+                case DayShortName:
+                    normalised += wxDateTime::GetWeekDayName(now.GetWeekDay(), wxDateTime::Name_Abbr);
+                    break;
+                case Hour:
+                    normalised += now.Format("%H");
+                    break;
+                case Minute:
+                    normalised += now.Format("%M");
+                    break;
+                case DayOfWeek:{
+                    int num = now.GetWeekDay();
+                    if(num == 0)
+                        num = 7;
+                    normalised += wxString::Format("%d", num);
+                    break;
+                }
+                case WeekOfYear:
+                    normalised += wxString::Format("%d", now.GetWeekOfYear());
+                    break;
+            }
+        }
+        return normalised;
+    }
+}
+
+void Path::InvalidateVariables(){
+    wxCriticalSectionLocker locker(cachesection);
+    loaded = false;
+    compiled.clear();
+}
 
 void Path::CreateDirectoryPath(const wxFileName &path){
     if(!path.IsDir() || path.DirExists())
@@ -63,171 +381,18 @@ wxFileName Path::Normalise(const wxFileName &filename){
 }
 
 wxString Path::Normalise(const wxString &path){
-#ifdef __WXMSW__
-	//We only need to set this up once, and do it the first time
-	if(DriveLabels.empty()){
-		TCHAR drives[256];  
-		if(GetLogicalDriveStrings(256, drives)){  
-			LPTSTR drive = drives;
-			int offset = _tcslen(drive) + 1;  
-			while(*drive){  
-				wxString volumename = wxEmptyString;
-				TCHAR label[256]; 
-				if(GetVolumeInformation(drive, label, sizeof(label), NULL, 0, NULL, NULL, 0)){
-					volumename.Printf(wxT("%s"),label); 
-					if(volumename != wxEmptyString){
-						DriveLabels[volumename] = wxString(drive).Left(2);
-					}
-				}
-				drive += offset;  
-			}
-		}
-	}
-#endif
 	if(path.find("@") == wxNOT_FOUND){
 		return path;
 	}
-	wxString token;
-	wxString normalised = wxEmptyString;
-	wxDateTime now = wxDateTime::Now();  
-	wxStringTokenizer tkz(path, wxT("@"), wxTOKEN_RET_EMPTY_ALL);
-	bool previousmatched = true;
-    wxFileConfig config("", "", Locations::GetSettingsPath() + "variables.ini");
-	while(tkz.HasMoreTokens()){
-        token = tkz.GetNextToken();
-		wxString strValue, read;
-		if(token == "date"){
-			token = now.FormatISODate();
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "time"){
-			token = now.Format("%H") + "-" +  now.Format("%M");
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "YYYY" || token == "year"){
-			token = now.Format("%Y");
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "MM" || token == "month"){
-			token = now.Format("%m");
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "monthname"){
-            token = wxDateTime::GetMonthName(wxDateTime::Now().GetMonth());
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "monthshortname"){
-            token = wxDateTime::GetMonthName(wxDateTime::Now().GetMonth(), wxDateTime::Name_Abbr);
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "DD" || token == "day"){
-			token = now.Format("%d");
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "dayname"){
-            token = wxDateTime::GetWeekDayName(wxDateTime::Now().GetWeekDay());
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "dayshortname"){
-            token = wxDateTime::GetWeekDayName(wxDateTime::Now().GetWeekDay(), wxDateTime::Name_Abbr);
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "hh" || token == "hour"){
-			token = now.Format(wxT("%H"));
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "mm" || token == "minute"){
-			token = now.Format("%M");
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "dayofweek"){
-            int num = wxDateTime::Now().GetWeekDay();
-            if(num == 0)
-                num = 7;
-            token = wxString::Format("%d", num);
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == "weekofyear"){
-            int num = wxDateTime::Now().GetWeekOfYear();
-            token = wxString::Format("%d", num);
-			normalised += token;
-			previousmatched = true;
-		}
-		else if(token == wxT("drive")){
-			normalised += wxPathOnly(wxStandardPaths::Get().GetExecutablePath()).Left(2);
-			previousmatched = true;
-		}
-		else if(token == wxT("docs")){
-			normalised += wxStandardPaths::Get().GetDocumentsDir();
-			previousmatched = true;
-		}
-        else if(token == "username"){
-            normalised += wxGetUserId();
-            previousmatched = true;
-        }
-		else if(token == wxT("volume")){
-			#ifdef __WXMSW__
-				wxString name = wxEmptyString;
-				WCHAR volumeLabel[256]; 
-				GetVolumeInformation(wxPathOnly(wxStandardPaths::Get().GetExecutablePath()).Left(3), volumeLabel, sizeof(volumeLabel), NULL, 0, NULL, NULL, 0);
-				name.Printf(wxT("%s"),volumeLabel); 
-				normalised += name;
-			#endif
-			previousmatched = true;
-		}
-		else if(token == wxT("label")){
-		 	wxFileConfig autorun("", "", wxPathOnly(wxStandardPaths::Get().GetExecutablePath()).Left(3) + wxFILE_SEP_PATH + wxT("autorun.inf"));
-			wxString label = autorun.Read(wxT("Autorun/Label"));
-			normalised += label;
-			previousmatched = true;
-		}
-		else if(DriveLabels[token] != wxEmptyString){
-			normalised += DriveLabels[token];
-			previousmatched = true;
-		}
-		else if(wxGetEnv(token , &strValue)){
-			normalised += strValue;
-			previousmatched = true;
-		}
-		else if(config.HasGroup(token) && config.Read(token + wxT("/") + wxGetFullHostName(), &read)){
-			normalised += read;
-			previousmatched = true;
-		}
-		else if(config.HasGroup(token) && config.Read(token + wxT("/") + _("Other"), &read)){
-			normalised += read;
-			previousmatched = true;
-		}
-		else{
-			if(previousmatched){
-				normalised += token;
-			}
-			else{
-				normalised = normalised + wxT("@") + token;
-			}
-			//This time we did not match
-			previousmatched = false;
-		}
-	}
-	if(normalised.Length() == 2 && normalised.Right(1) == wxT(":")){
-		normalised += wxFILE_SEP_PATH;
-	}
-	wxFileName flReturn(normalised);
-	if(flReturn.IsOk()){
-		//If we havent made any changes in this run then return, else scan again
-		//as new variables may have been added
-		return normalised == path ? path : Normalise(normalised);
-	}
-	return wxEmptyString;
+
+    wxCriticalSectionLocker locker(cachesection);
+    CheckVariables();
+    auto iter = compiled.find(path);
+    if(iter == compiled.end()){
+        //Don't let paths that just happen to contain an @ grow the cache forever
+        if(compiled.size() > 1000)
+            compiled.clear();
+        iter = compiled.insert(std::make_pair(path, Compile(path))).first;
+    }
+    return Evaluate(iter->second);
 }
@@ -16,6 +16,9 @@ namespace Path{
     wxFileName Normalise(const wxFileName &filename);
     wxString Normalise(const wxString &path);
     void CreateDirectoryPath(const wxFileName &path);
+    //Forces variables.ini to be reread the next time a path is normalised,
+    //otherwise it is only reread when it changes on disk
+    void InvalidateVariables();
 
     //<drive label, drive letter> Used by variables to resolve drive labels
 	static std::map<wxString, wxString> DriveLabels;
@@ -0,0 +1,178 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <wx/intl.h>
+#include <wx/filename.h>
+#include <wx/thread.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include "progress.h"
+
+ThroughputEstimator::ThroughputEstimator(double timeconstant) : m_TimeConstant(timeconstant){
+	Reset();
+}
+
+void ThroughputEstimator::Reset(){
+	m_HasSample = false;
+	m_HasRate = false;
+	m_LastTime = 0;
+	m_LastFiles = m_LastBytes = m_LastProcessed = 0;
+	m_FileRate = m_ByteRate = m_ProcessedRate = 0;
+}
+
+double ThroughputEstimator::Smooth(double previous, double current, double elapsed) const{
+	double alpha = 1 - std::exp(-elapsed / m_TimeConstant);
+	return previous + alpha * (current - previous);
+}
+
+void ThroughputEstimator::Update(double time, unsigned long long files, unsigned long long bytes, unsigned long long processed){
+	if(!m_HasSample){
+		m_HasSample = true;
+		m_LastTime = time;
+		m_LastFiles = files;
+		m_LastBytes = bytes;
+		m_LastProcessed = processed;
+		return;
+	}
+	double elapsed = time - m_LastTime;
+	if(elapsed <= 0){
+		return;
+	}
+	double filerate = (files - m_LastFiles) / elapsed;
+	double byterate = (bytes - m_LastBytes) / elapsed;
+	double processedrate = (processed - m_LastProcessed) / elapsed;
+	//The first rate is taken as is, otherwise we would start from zero
+	if(!m_HasRate){
+		m_HasRate = true;
+		m_FileRate = filerate;
+		m_ByteRate = byterate;
+		m_ProcessedRate = processedrate;
+	}
+	else{
+		m_FileRate = Smooth(m_FileRate, filerate, elapsed);
+		m_ByteRate = Smooth(m_ByteRate, byterate, elapsed);
+		m_ProcessedRate = Smooth(m_ProcessedRate, processedrate, elapsed);
+	}
+	m_LastTime = time;
+	m_LastFiles = files;
+	m_LastBytes = bytes;
+	m_LastProcessed = processed;
+}
+
+long ThroughputEstimator::GetEta(unsigned long long files, unsigned long long totalfiles, 
+                                 unsigned long long processed, unsigned long long totalbytes) const{
+	if(!m_HasRate){
+		return -1;
+	}
+	if(totalbytes > 0 && processed > 0 && m_ProcessedRate > 0){
+		return processed >= totalbytes ? 0 : (long)((totalbytes - processed) / m_ProcessedRate);
+	}
+	if(totalfiles > 0 && m_FileRate > 0){
+		return files >= totalfiles ? 0 : (long)((totalfiles - files) / m_FileRate);
+	}
+	return -1;
+}
+
+namespace{
+	std::atomic<bool> running(false);
+	std::atomic<unsigned long long> files(0), totalfiles(0);
+	std::atomic<unsigned long long> bytes(0), processed(0), totalbytes(0);
+
+	//Only sampled from the main thread, but guard it anyway
+	wxCriticalSection estimatorsection;
+	ThroughputEstimator estimator;
+
+	wxString FormatBytes(unsigned long long count){
+		return wxFileName::GetHumanReadableSize(wxULongLong(count), "0 B");
+	}
+
+	double Now(){
+		static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+double Progress::Status::GetFraction() const{
+	if(totalbytes > 0 && processed > 0){
+		return wxMin(1.0, (double)processed / totalbytes);
+	}
+	if(totalfiles > 0){
+		return wxMin(1.0, (double)files / totalfiles);
+	}
+	return -1;
+}
+
+void Progress::Begin(){
+	files = totalfiles = 0;
+	bytes = processed = totalbytes = 0;
+	{
+		wxCriticalSectionLocker lock(estimatorsection);
+		estimator.Reset();
+	}
+	running = true;
+}
+
+void Progress::End(){
+	running = false;
+}
+
+bool Progress::IsRunning(){
+	return running;
+}
+
+void Progress::SetTotal(unsigned long long filecount, unsigned long long bytecount){
+	totalfiles = filecount;
+	totalbytes = bytecount;
+}
+
+void Progress::AddFiles(unsigned long long count){
+	files += count;
+}
+
+void Progress::AddBytes(unsigned long long count){
+	bytes += count;
+	processed += count;
+}
+
+void Progress::SkipBytes(unsigned long long count){
+	processed += count;
+}
+
+Progress::Status Progress::Sample(){
+	Status status;
+	status.files = files;
+	status.totalfiles = totalfiles;
+	status.bytes = bytes;
+	status.processed = processed;
+	status.totalbytes = totalbytes;
+
+	wxCriticalSectionLocker lock(estimatorsection);
+	estimator.Update(Now(), status.files, status.bytes, status.processed);
+	status.filespersec = estimator.GetFilesPerSecond();
+	status.bytespersec = estimator.GetBytesPerSecond();
+	status.eta = estimator.GetEta(status.files, status.totalfiles, status.processed, status.totalbytes);
+	return status;
+}
+
+wxString Progress::FormatDuration(long seconds){
+	if(seconds < 0){
+		return "--:--:--";
+	}
+	return wxString::Format("%02ld:%02ld:%02ld", seconds / 3600, (seconds / 60) % 60, seconds % 60);
+}
+
+wxString Progress::Describe(const Status &status){
+	wxString description = wxString::Format(_("%llu of %llu files"), status.files, wxMax(status.files, status.totalfiles));
+	if(status.totalbytes > 0 || status.bytes > 0){
+		description += ", " + wxString::Format(_("%s of %s"), FormatBytes(status.processed), 
+		                                       FormatBytes(wxMax(status.processed, status.totalbytes)));
+	}
+	description += " - " + FormatBytes((unsigned long long)status.bytespersec) + "/s";
+	description += ", " + wxString::Format(_("%.1f files/s"), status.filespersec);
+	description += ", " + wxString::Format(_("%s remaining"), FormatDuration(status.eta));
+	return description;
+}
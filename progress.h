@@ -0,0 +1,76 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_PROGRESS
+#define H_PROGRESS
+
+#include <wx/string.h>
+
+//Turns the running totals of a job into smoothed rates and a time remaining.
+//The smoothing is weighted by the time between samples so it behaves the same
+//however often it is sampled
+class ThroughputEstimator{
+
+public:
+	ThroughputEstimator(double timeconstant = 5.0);
+
+	void Reset();
+	//Feed in the totals of files done, bytes written and bytes processed 
+	//(written or skipped) at a time in seconds
+	void Update(double time, unsigned long long files, unsigned long long bytes, unsigned long long processed);
+
+	double GetFilesPerSecond() const {return m_FileRate;}
+	double GetBytesPerSecond() const {return m_ByteRate;}
+	double GetProcessedPerSecond() const {return m_ProcessedRate;}
+
+	//The estimated seconds remaining or -1 if we can't tell yet, bytes are 
+	//preferred when we have them as one large file can outweigh thousands of 
+	//small ones
+	long GetEta(unsigned long long files, unsigned long long totalfiles, 
+	            unsigned long long processed, unsigned long long totalbytes) const;
+
+private:
+	double Smooth(double previous, double current, double elapsed) const;
+
+	double m_TimeConstant;
+	bool m_HasSample;
+	bool m_HasRate;
+	double m_LastTime;
+	unsigned long long m_LastFiles, m_LastBytes, m_LastProcessed;
+	double m_FileRate, m_ByteRate, m_ProcessedRate;
+};
+
+//The progress of the running job, updated from the job threads and sampled
+//by the progress window or the headless timer
+namespace Progress{
+	struct Status{
+		unsigned long long files, totalfiles;
+		unsigned long long bytes, processed, totalbytes;
+		double filespersec, bytespersec;
+		long eta;
+
+		//Between 0 and 1, or -1 if the total is not yet known
+		double GetFraction() const;
+	};
+
+	void Begin();
+	void End();
+	bool IsRunning();
+
+	//The totals grow as the file counter runs alongside the job
+	void SetTotal(unsigned long long files, unsigned long long bytes);
+	void AddFiles(unsigned long long count = 1);
+	//Bytes actually written, this may be called part way through a large file
+	void AddBytes(unsigned long long bytes);
+	//Bytes we have dealt with without writing, such as skipped files
+	void SkipBytes(unsigned long long bytes);
+
+	Status Sample();
+	wxString Describe(const Status &status);
+	wxString FormatDuration(long seconds);
+}
+
+#endif
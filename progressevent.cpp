@@ -0,0 +1,137 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <wx/intl.h>
+#include <wx/log.h>
+#include "progressevent.h"
+
+namespace{
+	//Text never starts with a nul so this marks an event
+	const char marker = 0;
+	//The marker, operation, error, bytes and duration
+	const size_t headersize = 1 + 1 + 4 + 8 + 4;
+
+	void Put(std::string &out, unsigned long long value, int length){
+		for(int i = 0; i < length; i++){
+			out.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+		}
+	}
+
+	unsigned long long Get(const char *data, int length){
+		unsigned long long value = 0;
+		for(int i = 0; i < length; i++){
+			value |= static_cast<unsigned long long>(static_cast<unsigned char>(data[i])) << (i * 8);
+		}
+		return value;
+	}
+
+	const char* OperationName(EventOperation operation){
+		switch(operation){
+			case EventCopy: return "copy";
+			case EventSkip: return "skip";
+			case EventRemoveFile: return "removefile";
+			case EventRemoveFolder: return "removefolder";
+			case EventVerify: return "verify";
+			case EventKeepVersion: return "keepversion";
+			case EventPack: return "pack";
+			case EventPackRemove: return "packremove";
+			case EventUnpack: return "unpack";
+		}
+		return "unknown";
+	}
+
+	wxString Escape(const wxString &value){
+		wxString escaped;
+		escaped.reserve(value.length());
+		for(wxString::const_iterator iter = value.begin(); iter != value.end(); ++iter){
+			wxUniChar c = *iter;
+			if(c == '"' || c == '\\'){
+				escaped += '\\';
+				escaped += c;
+			}
+			else if(c.GetValue() < 0x20){
+				escaped += wxString::Format("\\u%04x", static_cast<unsigned int>(c.GetValue()));
+			}
+			else{
+				escaped += c;
+			}
+		}
+		return escaped;
+	}
+}
+
+int ProgressEvent::LastError(){
+	int error = wxSysErrorCode();
+	return error != 0 ? error : -1;
+}
+
+std::string ProgressEvent::Encode() const{
+	const wxCharBuffer utf8 = path.utf8_str();
+	std::string out;
+	out.reserve(headersize + utf8.length());
+	out.push_back(marker);
+	out.push_back(static_cast<char>(operation));
+	Put(out, static_cast<unsigned int>(error), 4);
+	Put(out, bytes, 8);
+	Put(out, duration, 4);
+	out.append(utf8.data(), utf8.length());
+	return out;
+}
+
+bool ProgressEvent::Decode(const char *data, size_t size, ProgressEvent &event){
+	if(size < headersize || data[0] != marker){
+		return false;
+	}
+	event.operation = static_cast<EventOperation>(static_cast<unsigned char>(data[1]));
+	event.error = static_cast<int>(static_cast<unsigned int>(Get(data + 2, 4)));
+	event.bytes = Get(data + 6, 8);
+	event.duration = static_cast<unsigned long>(Get(data + 14, 4));
+	event.path = wxString::FromUTF8(data + headersize, size - headersize);
+	return true;
+}
+
+wxString ProgressEvent::Format() const{
+	wxString line;
+	switch(operation){
+		case EventCopy:
+			line = Failed() ? _("Failed to copy ") : _("Copied ");
+			break;
+		case EventSkip:
+			line = _("Skipped ");
+			break;
+		case EventRemoveFile:
+			line = Failed() ? _("Failed to remove file ") : _("Removed file ");
+			break;
+		case EventRemoveFolder:
+			line = Failed() ? _("Failed to remove directory ") : _("Removed directory ");
+			break;
+		case EventVerify:
+			line = Failed() ? _("Failed to verify ") : _("Verified ");
+			break;
+		case EventKeepVersion:
+			line = Failed() ? _("Failed to keep the old version of ") : _("Kept the old version of ");
+			break;
+		case EventPack:
+			line = Failed() ? _("Failed to pack ") : _("Packed ");
+			break;
+		case EventPackRemove:
+			line = _("Packed removal of ");
+			break;
+		case EventUnpack:
+			line = Failed() ? _("Failed to unpack ") : _("Unpacked ");
+			break;
+	}
+	line += path;
+	if(error > 0){
+		line += " (" + wxString(wxSysErrorMsg(error)) + ")";
+	}
+	return line;
+}
+
+wxString ProgressEvent::ToJson() const{
+	return wxString::Format("{\"operation\":\"%s\",\"path\":\"%s\",\"error\":%d,\"bytes\":%llu,\"duration\":%lu}",
+	                        OperationName(operation), Escape(path), error, bytes, duration);
+}
@@ -0,0 +1,58 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_PROGRESSEVENT
+#define H_PROGRESSEVENT
+
+#include <string>
+#include <wx/string.h>
+
+//What happened to a single file or folder
+enum EventOperation{
+	EventCopy,
+	EventSkip,
+	EventRemoveFile,
+	EventRemoveFolder,
+	EventVerify,
+	EventKeepVersion,
+	EventPack,
+	EventPackRemove,
+	EventUnpack
+};
+
+//A per file event from a job. Jobs send these rather than finished messages
+//so that nothing is translated or formatted until something shows it, and
+//so they can be read by other programs
+struct ProgressEvent{
+	EventOperation operation;
+	//Zero if it worked, otherwise the system error or -1 if there isn't one
+	int error;
+	unsigned long long bytes;
+	//In milliseconds
+	unsigned long duration;
+	wxString path;
+
+	ProgressEvent() : operation(EventCopy), error(0), bytes(0), duration(0)
+	{}
+
+	bool Failed() const {return error != 0;}
+
+	//The error to give a failed event, picked up straight after the call
+	//that failed
+	static int LastError();
+
+	//Events go through the same queue as messages, they start with a byte
+	//a message never does
+	std::string Encode() const;
+	static bool Decode(const char *data, size_t size, ProgressEvent &event);
+
+	//The translated line shown in the progress window and log
+	wxString Format() const;
+	//A single line JSON object
+	wxString ToJson() const;
+};
+
+#endif
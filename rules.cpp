@@ -9,6 +9,7 @@
 #include <wx/fileconf.h>
 #include <wx/variant.h>
 #include <wx/log.h>
+#include <chrono>
 #include "rules.h"
 #include "path.h"
 
@@ -148,6 +149,9 @@ RuleResult RuleSet::Matches(wxFileName path){
 	if(rules.empty())
 		return NoMatch;
 
+    if(profiling)
+        return ProfiledMatches(path);
+
     for(auto iter = rules.begin() ; iter != rules.end(); iter++){
         RuleResult result = (*iter).Matches(path);
         if(result != NoMatch)
@@ -157,6 +161,75 @@ RuleResult RuleSet::Matches(wxFileName path){
 	return NoMatch;
 }
 
+RuleResult RuleSet::ProfiledMatches(const wxFileName &path){
+    for(unsigned int i = 0; i < rules.size(); i++){
+        auto start = std::chrono::steady_clock::now();
+        RuleResult result = rules[i].Matches(path);
+        stats[i].time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if(result != NoMatch){
+            stats[i].hits++;
+            return result;
+        }
+        stats[i].misses++;
+    }
+
+    unmatched++;
+    return NoMatch;
+}
+
+int RuleSet::FindDecidingRule(wxFileName path, RuleResult &result){
+    for(unsigned int i = 0; i < rules.size(); i++){
+        result = rules[i].Matches(path);
+        if(result != NoMatch)
+            return i;
+    }
+
+    result = NoMatch;
+    return -1;
+}
+
+wxString RuleSet::Explain(const wxString &path){
+    //Rules treat folders differently so make sure we pass the right type
+    wxFileName name = wxDirExists(path) ? wxFileName::DirName(path) : wxFileName::FileName(path);
+    RuleResult result;
+    int index = FindDecidingRule(name, result);
+    if(index == -1)
+        return _("No rule matches") + " " + path;
+
+    wxString decision;
+    if(result == Included)
+        decision = _("Included");
+    else if(result == Excluded)
+        decision = _("Excluded");
+    else
+        decision = _("Absolutely excluded");
+
+    const Rule &rule = rules.at(index);
+    return wxString::Format("%s %s, %s %d: %s (%s) %s", path, decision.Lower(), _("decided by rule"), index + 1,
+                            wxGetTranslation(functionmap.right.at(rule.function)),
+                            wxGetTranslation(typemap.right.at(rule.type)), rule.rule);
+}
+
+void RuleSet::SetProfiling(bool profiling){
+    this->profiling = profiling;
+    //Each new profiling run starts from zero
+    stats.assign(rules.size(), RuleStats());
+    unmatched = 0;
+}
+
+wxArrayString RuleSet::GetProfile() const{
+    wxArrayString lines;
+    lines.Add(_("Rule profile for") + " " + name);
+    for(unsigned int i = 0; i < rules.size(); i++){
+        lines.Add(wxString::Format("%d. %s (%s) %s - %s %lu, %s %lu, %.3f ms", i + 1,
+                  wxGetTranslation(functionmap.right.at(rules[i].function)),
+                  wxGetTranslation(typemap.right.at(rules[i].type)), rules[i].rule,
+                  _("hits"), stats[i].hits, _("misses"), stats[i].misses, stats[i].time));
+    }
+    lines.Add(wxString::Format("%s %lu", _("Paths matching no rule:"), unmatched));
+    return lines;
+}
+
 bool RuleSet::IsValid(){
     if(rules.empty())
         return true;
@@ -186,6 +259,7 @@ bool RuleSet::TransferFromFile(){
             rules.push_back(rule);
         }
     }
+    stats.resize(rules.size());
 
     return true;
 }
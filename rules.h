@@ -86,23 +86,52 @@ private:
     bool Validate();
 };
 
+//Counters collected for each rule while a RuleSet is profiling
+struct RuleStats{
+    unsigned long hits;
+    unsigned long misses;
+    //Total time spent evaluating the rule in milliseconds
+    double time;
+
+    RuleStats() : hits(0), misses(0), time(0)
+    {}
+};
+
 class RuleSet{
 public:
-    RuleSet(const wxString &name) { this->name = name; }
+    RuleSet(const wxString &name) { this->name = name; this->profiling = false; this->unmatched = 0; }
 
     RuleResult Matches(wxFileName path);
     bool IsValid();
 
+    //Returns the index of the rule that decides the result for the path, or -1
+    //if no rule matches, the result itself is returned in result
+    int FindDecidingRule(wxFileName path, RuleResult &result);
+    //A human readable description of which rule decides the path
+    wxString Explain(const wxString &path);
+
+    //When profiling every call to Matches records hits, misses and timings
+    void SetProfiling(bool profiling);
+    bool IsProfiling() const { return profiling; }
+    const std::vector<RuleStats>& GetStats() const { return stats; }
+    //The collected statistics formatted as a table, one line per rule
+    wxArrayString GetProfile() const;
+
 	bool TransferToFile();
 	bool TransferFromFile();
 
-	void Add(Rule rule) { rules.push_back(rule); }
+	void Add(Rule rule) { rules.push_back(rule); stats.resize(rules.size()); }
 
 	const wxString& GetName() const {return name;}
     const std::vector<Rule>& GetRules() const {return rules;}
 private:
+    RuleResult ProfiledMatches(const wxFileName &path);
+
     std::vector<Rule> rules;
 	wxString name;
+    bool profiling;
+    std::vector<RuleStats> stats;
+    unsigned long unmatched;
 };	
 
 #endif
@@ -9,6 +9,7 @@
 #include "../rules.h"
 #include "../path.h"
 #include "../basicfunctions.h"
+#include "../progress.h"
 #include "../data/securedata.h"
 #include "../forms/frmmain.h"
 
@@ -80,7 +81,8 @@ bool SecureJob::CryptFile(const wxString &path, SecureData *data){
 
     //Make sure that it is a 'real' file
     wxFileName filename(path);
-    if(filename.IsOk() && filename.GetSize() == 0)
+    wxULongLong size = filename.GetSize();
+    if(filename.IsOk() && size == 0)
         return false;
 
 	//Ensure that we are not encrypting an already encrypted file or decrypting a non encrypted file
@@ -115,6 +117,9 @@ bool SecureJob::CryptFile(const wxString &path, SecureData *data){
 		wxMilliSleep(100);
 	}
 	long lgReturn = wxGetApp().m_ProcessStatusMap[id];
+	if(size != wxInvalidSize){
+		Progress::AddBytes(size.GetValue());
+	}
 
 	//Put the old attributed back
 #ifdef __WXMSW__
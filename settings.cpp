@@ -22,6 +22,10 @@ Settings::Settings(wxString path){
 	m_SmallBorders = false;
 	m_DisableStream = false;
 	m_DisableLog = false;
+	//Folders with more entries than this are sorted on disk during a sync
+	m_SpillThreshold = 250000;
+	//Files looked at at once when a folder is read
+	m_StatThreads = 8;
 	config = new wxFileConfig( wxT(""), wxT(""), path);
 }
 
@@ -48,6 +52,8 @@ bool Settings::TransferToFile(){
 	config->Write(wxT("General/EnableTooltips"), m_EnableTooltips);
 	config->Write(wxT("General/SmallBorders"), m_SmallBorders);
 	config->Write(wxT("Sync/DisableStream"), m_DisableStream);
+	config->Write(wxT("Sync/SpillThreshold"), m_SpillThreshold);
+	config->Write(wxT("Sync/StatThreads"), m_StatThreads);
 	config->Write(wxT("CommandLine/DisableLog"), m_DisableLog);
     config->Flush();
 	return true;
@@ -85,6 +91,8 @@ bool Settings::TransferFromFile(){
 	config->Read(wxT("General/EnableTooltips"), &m_EnableTooltips);
 	config->Read(wxT("General/SmallBorders"), &m_SmallBorders);
 	config->Read(wxT("Sync/DisableStream"), &m_DisableStream);
+	config->Read(wxT("Sync/SpillThreshold"), &m_SpillThreshold);
+	config->Read(wxT("Sync/StatThreads"), &m_StatThreads);
 	config->Read(wxT("CommandLine/DisableLog"), &m_DisableLog);
 	return true;
 }
@@ -37,6 +37,8 @@ public:
 	void SetSmallBorders(const bool& SmallBorders) {this->m_SmallBorders = SmallBorders;}
 	const bool& GetDisableLog() const {return m_DisableLog;}
 	const bool& GetDisableStream() const {return m_DisableStream;}
+	const long& GetSpillThreshold() const {return m_SpillThreshold;}
+	const long& GetStatThreads() const {return m_StatThreads;}
 	const wxString& GetFont() const {return m_Font;}
 	const double& GetHeight() const {return m_Height;}
 	const wxString& GetLanguageCode() const {return m_LanguageCode;}
@@ -74,6 +76,8 @@ private:
 	bool m_RememberSecure;
 	bool m_DisableStream;
 	bool m_DisableLog;
+	long m_SpillThreshold;
+	long m_StatThreads;
 	bool m_EnableTooltips;
 	bool m_SmallBorders;
 	wxFileConfig* config;
@@ -0,0 +1,63 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "concurrency.h"
+#include <algorithm>
+#include <wx/log.h>
+
+namespace{
+	//How much better or worse a batch has to be before we act on it
+	const double improvement = 1.05;
+	const double worsening = 0.85;
+	//Operations this much slower than the best we have seen are queueing
+	const double congestion = 2.0;
+	//The base latency creeps up so a device that has slowed for good isn't 
+	//compared against how it used to be forever
+	const double basedrift = 1.02;
+}
+
+ConcurrencyController::ConcurrencyController(const wxString &name, size_t minimum, size_t maximum, size_t initial)
+                     : m_Name(name), m_Minimum(std::max<size_t>(minimum, 1)), m_Maximum(std::max(maximum, m_Minimum)),
+                       m_Throughput(0), m_BaseLatency(0), m_HasSample(false){
+	m_Limit = std::min(std::max(initial, m_Minimum), m_Maximum);
+}
+
+size_t ConcurrencyController::Update(size_t operations, double elapsed, double latency){
+	if(operations == 0 || elapsed <= 0){
+		return m_Limit;
+	}
+	double throughput = operations / elapsed;
+	if(!m_HasSample){
+		m_HasSample = true;
+		m_Throughput = throughput;
+		m_BaseLatency = latency;
+		Change(m_Limit + 1, "first batch");
+		return m_Limit;
+	}
+	m_BaseLatency = std::min(latency, m_BaseLatency * basedrift);
+	double previous = m_Throughput;
+	m_Throughput = throughput;
+
+	if(m_BaseLatency > 0 && latency > m_BaseLatency * congestion){
+		Change(m_Limit / 2, wxString::Format("latency %.2fms against %.2fms", latency * 1000, m_BaseLatency * 1000));
+	}
+	else if(m_Throughput > previous * improvement){
+		Change(m_Limit + 1, wxString::Format("throughput up to %.0f/s", m_Throughput));
+	}
+	else if(m_Throughput < previous * worsening){
+		Change(m_Limit / 2, wxString::Format("throughput down to %.0f/s", m_Throughput));
+	}
+	return m_Limit;
+}
+
+void ConcurrencyController::Change(size_t limit, const wxString &reason){
+	limit = std::min(std::max(limit, m_Minimum), m_Maximum);
+	if(limit != m_Limit){
+		wxLogVerbose("%s workers %lu -> %lu, %s", m_Name, static_cast<unsigned long>(m_Limit), 
+		             static_cast<unsigned long>(limit), reason);
+		m_Limit = limit;
+	}
+}
@@ -0,0 +1,41 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_CONCURRENCY
+#define H_CONCURRENCY
+
+#include <wx/string.h>
+#include <stddef.h>
+
+//Decides how many workers a pool should use from how it has been doing. It
+//adds one at a time while that makes things faster and halves the count when
+//each operation starts taking much longer, which is the device queueing 
+//rather than working. Decisions are logged verbosely for tuning
+class ConcurrencyController
+{
+public:
+	ConcurrencyController(const wxString &name, size_t minimum, size_t maximum, size_t initial);
+
+	//Reports a finished batch, how many operations it did, the seconds it 
+	//took and the average seconds each operation took. Returns the new limit
+	size_t Update(size_t operations, double elapsed, double latency);
+	size_t GetLimit() const {return m_Limit;}
+
+private:
+	void Change(size_t limit, const wxString &reason);
+
+	wxString m_Name;
+	size_t m_Minimum;
+	size_t m_Maximum;
+	size_t m_Limit;
+	//Operations a second in the last batch
+	double m_Throughput;
+	//The quickest operations have been, what we compare against for queueing
+	double m_BaseLatency;
+	bool m_HasSample;
+};
+
+#endif
@@ -0,0 +1,261 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "packstream.h"
+#include "../hash.h"
+#include "../cancel.h"
+#include <string.h>
+#include <wx/file.h>
+
+#ifdef TOUCAN_ZSTD
+	#include <zstd.h>
+#endif
+
+namespace{
+	const char magic[] = "ToucanPack";
+	const size_t magiclength = sizeof(magic) - 1;
+	const unsigned int packversion = 1;
+
+	const size_t chunksize = 1024 * 1024;
+	//Small records are written out in groups of this many
+	const unsigned long long flushrecords = 1024;
+	//Quick enough to keep up with a disk while still worth doing
+	const int compressionlevel = 3;
+
+	const unsigned char ChunkStored = 0;
+	const unsigned char ChunkCompressed = 1;
+
+	size_t CompressBound(){
+	#ifdef TOUCAN_ZSTD
+		return ZSTD_compressBound(chunksize);
+	#else
+		return chunksize;
+	#endif
+	}
+}
+
+PackWriter::PackWriter(int fd, bool compress) : m_Channel(-1, fd), m_Compress(compress && CanCompress()), m_Records(0),
+                                                m_Buffer(chunksize), m_Compressed(m_Compress ? CompressBound() : 0)
+{}
+
+bool PackWriter::CanCompress(){
+#ifdef TOUCAN_ZSTD
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool PackWriter::WriteHeader(){
+	m_Channel.WriteBytes(magic, magiclength);
+	m_Channel.WriteInt(packversion);
+	return m_Channel.Flush();
+}
+
+void PackWriter::WriteFolder(const wxString &path, long long modified){
+	m_Channel.WriteByte(PackFolder);
+	m_Channel.WriteString(path);
+	m_Channel.WriteLong(static_cast<unsigned long long>(modified));
+	m_Records++;
+	if(m_Records % flushrecords == 0){
+		m_Channel.Flush();
+	}
+}
+
+bool PackWriter::WriteFile(const PackRecord &record, wxFile &file, const CancelToken *cancel){
+	m_Channel.WriteByte(PackFile);
+	m_Channel.WriteString(record.path);
+	m_Channel.WriteLong(record.size);
+	m_Channel.WriteLong(static_cast<unsigned long long>(record.modified));
+	m_Channel.WriteInt(record.mode);
+	m_Records++;
+	ContentHash whole;
+	for(;;){
+		ssize_t count = file.Read(&m_Buffer[0], m_Buffer.size());
+		//A reader can't carry on after a file that stops part way through
+		if(count == wxInvalidOffset || (cancel && cancel->IsCancelled())){
+			return false;
+		}
+		if(count == 0){
+			break;
+		}
+		ContentHash chunk;
+		chunk.Update(&m_Buffer[0], count);
+		whole.Update(&m_Buffer[0], count);
+		m_Channel.WriteInt(count);
+		size_t stored = 0;
+	#ifdef TOUCAN_ZSTD
+		if(m_Compress){
+			size_t result = ZSTD_compress(&m_Compressed[0], m_Compressed.size(), &m_Buffer[0], count, compressionlevel);
+			if(!ZSTD_isError(result) && result < static_cast<size_t>(count)){
+				stored = result;
+			}
+		}
+	#endif
+		if(stored > 0){
+			m_Channel.WriteByte(ChunkCompressed);
+			m_Channel.WriteInt(stored);
+			m_Channel.WriteBytes(&m_Compressed[0], stored);
+		}
+		else{
+			//Not worth it, or not wanted
+			m_Channel.WriteByte(ChunkStored);
+			m_Channel.WriteInt(count);
+			m_Channel.WriteBytes(&m_Buffer[0], count);
+		}
+		m_Channel.WriteLong(chunk.GetValue());
+		if(!m_Channel.Flush()){
+			return false;
+		}
+	}
+	m_Channel.WriteInt(0);
+	m_Channel.WriteLong(whole.GetValue());
+	return m_Channel.Flush();
+}
+
+void PackWriter::WriteRemove(const wxString &path){
+	m_Channel.WriteByte(PackRemove);
+	m_Channel.WriteString(path);
+	m_Records++;
+	if(m_Records % flushrecords == 0){
+		m_Channel.Flush();
+	}
+}
+
+bool PackWriter::Finish(){
+	m_Channel.WriteByte(PackEnd);
+	m_Channel.WriteLong(m_Records);
+	return m_Channel.Flush();
+}
+
+PackReader::PackReader(int fd) : m_Channel(fd, -1), m_Finished(false), m_Records(0),
+                                 m_Buffer(chunksize), m_Compressed(CompressBound())
+{}
+
+bool PackReader::Fail(const wxString &error){
+	//The first problem is the one worth reporting
+	if(m_Error.IsEmpty()){
+		m_Error = error;
+	}
+	return false;
+}
+
+bool PackReader::ReadHeader(){
+	char header[magiclength];
+	unsigned int version;
+	if(!m_Channel.ReadBytes(header, magiclength) || memcmp(header, magic, magiclength) != 0 || !m_Channel.ReadInt(version)){
+		return Fail("This is not a Toucan pack");
+	}
+	if(version != packversion){
+		return Fail("The pack was made by a different version of Toucan");
+	}
+	return true;
+}
+
+bool PackReader::Next(PackRecord &record){
+	if(m_Finished){
+		return false;
+	}
+	unsigned char type;
+	unsigned long long value;
+	if(!m_Channel.ReadByte(type)){
+		return Fail("The pack ends part way through");
+	}
+	record = PackRecord();
+	record.type = static_cast<PackRecordType>(type);
+	switch(type){
+		case PackEnd:
+			if(!m_Channel.ReadLong(value) || value != m_Records){
+				return Fail("The pack is missing records");
+			}
+			m_Finished = true;
+			return false;
+		case PackFolder:
+			if(!m_Channel.ReadString(record.path) || !m_Channel.ReadLong(value)){
+				return Fail("The pack ends part way through");
+			}
+			record.modified = static_cast<long long>(value);
+			break;
+		case PackFile:
+			if(!m_Channel.ReadString(record.path) || !m_Channel.ReadLong(record.size)
+			|| !m_Channel.ReadLong(value) || !m_Channel.ReadInt(record.mode)){
+				return Fail("The pack ends part way through");
+			}
+			record.modified = static_cast<long long>(value);
+			break;
+		case PackRemove:
+			if(!m_Channel.ReadString(record.path)){
+				return Fail("The pack ends part way through");
+			}
+			break;
+		default:
+			return Fail("The pack is damaged");
+	}
+	m_Records++;
+	return true;
+}
+
+bool PackReader::ReadContents(wxFile *file, const CancelToken *cancel){
+	ContentHash whole;
+	for(;;){
+		unsigned int length, stored;
+		unsigned char kind;
+		if(!m_Channel.ReadInt(length)){
+			return Fail("The pack ends part way through");
+		}
+		if(length == 0){
+			break;
+		}
+		if(cancel && cancel->IsCancelled()){
+			return Fail("Stopped");
+		}
+		if(length > chunksize || !m_Channel.ReadByte(kind) || !m_Channel.ReadInt(stored)){
+			return Fail("The pack is damaged");
+		}
+		if(kind == ChunkStored){
+			if(stored != length || !m_Channel.ReadBytes(&m_Buffer[0], length)){
+				return Fail("The pack is damaged");
+			}
+		}
+		else if(kind == ChunkCompressed){
+		#ifdef TOUCAN_ZSTD
+			if(stored > m_Compressed.size() || !m_Channel.ReadBytes(&m_Compressed[0], stored)){
+				return Fail("The pack is damaged");
+			}
+			size_t result = ZSTD_decompress(&m_Buffer[0], length, &m_Compressed[0], stored);
+			if(ZSTD_isError(result) || result != length){
+				return Fail("The pack is damaged");
+			}
+		#else
+			return Fail("The pack is compressed and this copy of Toucan was built without zstd");
+		#endif
+		}
+		else{
+			return Fail("The pack is damaged");
+		}
+		unsigned long long expected;
+		if(!m_Channel.ReadLong(expected)){
+			return Fail("The pack ends part way through");
+		}
+		ContentHash chunk;
+		chunk.Update(&m_Buffer[0], length);
+		if(chunk.GetValue() != expected){
+			return Fail("The pack is damaged");
+		}
+		whole.Update(&m_Buffer[0], length);
+		if(file && file->Write(&m_Buffer[0], length) != length){
+			return Fail("Could not write the file");
+		}
+	}
+	unsigned long long expected;
+	if(!m_Channel.ReadLong(expected)){
+		return Fail("The pack ends part way through");
+	}
+	if(whole.GetValue() != expected){
+		return Fail("The pack is damaged");
+	}
+	return true;
+}
@@ -0,0 +1,93 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_PACKSTREAM
+#define H_PACKSTREAM
+
+class CancelToken;
+class wxFile;
+
+#include "syncagent.h"
+#include <vector>
+#include <wx/string.h>
+
+//A sync written out as one stream so it can be carried between machines that
+//can't see each other's folders, through a pipe or on removable media. After
+//a header it is a list of records. Files follow their record in chunks which
+//each carry the hash of what they held before compression, so damage is
+//found as soon as it is read. Paths are relative with / between folders
+enum PackRecordType{
+	PackFolder = 'D',
+	PackFile = 'F',
+	PackRemove = 'R',
+	PackEnd = 'E'
+};
+
+struct PackRecord{
+	PackRecordType type;
+	wxString path;
+	unsigned long long size;
+	long long modified;
+	unsigned int mode;
+
+	PackRecord() : type(PackEnd), size(0), modified(0), mode(0)
+	{}
+};
+
+class PackWriter{
+
+public:
+	//Compression is only used if Toucan was built with zstd
+	PackWriter(int fd, bool compress);
+
+	bool WriteHeader();
+	//Small records are buffered, so a failure shows up when the stream is 
+	//next written out by a file or the end
+	void WriteFolder(const wxString &path, long long modified);
+	void WriteRemove(const wxString &path);
+	//Sends the contents of the open file after its record
+	bool WriteFile(const PackRecord &record, wxFile &file, const CancelToken *cancel = NULL);
+	//Ends the stream, a reader fails if it never sees the end
+	bool Finish();
+
+	static bool CanCompress();
+
+private:
+	AgentChannel m_Channel;
+	bool m_Compress;
+	unsigned long long m_Records;
+	std::vector<char> m_Buffer;
+	std::vector<char> m_Compressed;
+};
+
+class PackReader{
+
+public:
+	PackReader(int fd);
+
+	bool ReadHeader();
+	//False once the end has been read or the stream is broken, IsFinished
+	//tells them apart
+	bool Next(PackRecord &record);
+	//Writes the contents of the file record just read, checking each chunk.
+	//Without a file they are checked and thrown away
+	bool ReadContents(wxFile *file, const CancelToken *cancel = NULL);
+
+	bool IsFinished() const {return m_Finished;}
+	const wxString& GetError() const {return m_Error;}
+
+private:
+	bool Fail(const wxString &error);
+
+	AgentChannel m_Channel;
+	bool m_Finished;
+	unsigned long long m_Records;
+	wxString m_Error;
+	std::vector<char> m_Buffer;
+	std::vector<char> m_Compressed;
+};
+
+#endif
@@ -0,0 +1,105 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "patharena.h"
+#include <type_traits>
+#include <wx/filefn.h>
+
+namespace{
+	unsigned long Lower(unsigned long c){
+#ifdef __WXMSW__
+		return wxTolower(c);
+#else
+		//Only plain ASCII as anything else is part of a multibyte character
+		return c < 128 ? wxTolower(c) : c;
+#endif
+	}
+}
+
+PathArena::PathArena(){
+	//Most trees fit in this without growing
+	m_Entries.reserve(4096);
+	m_Names.reserve(65536);
+	Entry root = {Root, 0, 0, 0};
+	m_Entries.push_back(root);
+}
+
+PathArena::Node PathArena::Add(Node parent, const Char *name, size_t length, int tag){
+	Entry entry = {parent, m_Names.size(), length, tag};
+	m_Names.insert(m_Names.end(), name, name + length);
+	m_Entries.push_back(entry);
+	return m_Entries.size() - 1;
+}
+
+PathArena::Node PathArena::Add(Node parent, const wxString &name, int tag){
+	NativeString native = ToNative(name);
+	return Add(parent, native.data(), native.length(), tag);
+}
+
+wxString PathArena::GetName(Node node) const {
+	const Entry &entry = m_Entries[node];
+	return entry.length ? ToString(&m_Names[entry.offset], entry.length) : wxString();
+}
+
+void PathArena::AppendName(Node node, NativeString &path) const {
+	const Entry &entry = m_Entries[node];
+	if(entry.length){
+		path.append(&m_Names[entry.offset], entry.length);
+	}
+}
+
+wxString PathArena::ToString(const Char *name, size_t length){
+#ifdef __WXMSW__
+	return wxString(name, length);
+#else
+	return wxString(name, wxConvFile, length);
+#endif
+}
+
+PathArena::NativeString PathArena::ToNative(const wxString &name){
+#ifdef __WXMSW__
+	return NativeString(name.wc_str(), name.length());
+#else
+	wxCharBuffer buffer = name.fn_str();
+	return buffer.data() ? NativeString(buffer.data(), buffer.length()) : NativeString();
+#endif
+}
+
+wxString PathArena::GetPath(Node node) const {
+	wxString path;
+	while(node != Root){
+		path = path.empty() ? GetName(node) : GetName(node) + wxFILE_SEP_PATH + path;
+		node = m_Entries[node].parent;
+	}
+	return path;
+}
+
+int PathArena::Compare(Node first, Node second, bool casesensitive) const {
+	const Entry &a = m_Entries[first], &b = m_Entries[second];
+	size_t length = a.length < b.length ? a.length : b.length;
+	for(size_t i = 0; i < length; i++){
+		//Compare as unsigned so UTF-8 names sort by code point
+		unsigned long x = static_cast<std::make_unsigned<Char>::type>(m_Names[a.offset + i]);
+		unsigned long y = static_cast<std::make_unsigned<Char>::type>(m_Names[b.offset + i]);
+		if(!casesensitive){
+			x = Lower(x);
+			y = Lower(y);
+		}
+		if(x != y){
+			return x < y ? -1 : 1;
+		}
+	}
+	return a.length == b.length ? 0 : (a.length < b.length ? -1 : 1);
+}
+
+void PathArena::Release(Node mark){
+	//The root is never released
+	if(mark < 1 || mark >= m_Entries.size()){
+		return;
+	}
+	m_Names.resize(m_Entries[mark].offset);
+	m_Entries.resize(mark);
+}
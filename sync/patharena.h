@@ -0,0 +1,68 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_PATHARENA
+#define H_PATHARENA
+
+#include <vector>
+#include <string>
+#include <wx/string.h>
+
+//Holds the relative paths of a traversal as a parent and a name so a whole 
+//tree costs little more than its names. Entries are handed out in order and 
+//given back a subtree at a time, so the storage is only ever grown or cut.
+//Names are kept as the filesystem gives them to us and only turned into a 
+//wxString when something needs one
+class PathArena
+{
+public:
+#ifdef __WXMSW__
+	typedef wxChar Char;
+#else
+	typedef char Char;
+#endif
+	typedef std::basic_string<Char> NativeString;
+	typedef unsigned int Node;
+	//The empty path that everything else is relative to
+	static const Node Root = 0;
+
+	PathArena();
+
+	Node Add(Node parent, const Char *name, size_t length, int tag = 0);
+	Node Add(Node parent, const wxString &name, int tag = 0);
+
+	wxString GetName(Node node) const;
+	//Adds the name to the end of a native path without converting it
+	void AppendName(Node node, NativeString &path) const;
+	//The path from the root, joined with the platform separator
+	wxString GetPath(Node node) const;
+	Node GetParent(Node node) const {return m_Entries[node].parent;}
+	int GetTag(Node node) const {return m_Entries[node].tag;}
+	void SetTag(Node node, int tag) {m_Entries[node].tag = tag;}
+	int Compare(Node first, Node second, bool casesensitive) const;
+
+	//Everything added after the mark can be released together
+	Node GetMark() const {return m_Entries.size();}
+	void Release(Node mark);
+
+	size_t GetCount() const {return m_Entries.size() - 1;}
+
+	static wxString ToString(const Char *name, size_t length);
+	static NativeString ToNative(const wxString &name);
+
+private:
+	struct Entry{
+		Node parent;
+		size_t offset;
+		size_t length;
+		int tag;
+	};
+
+	std::vector<Entry> m_Entries;
+	std::vector<Char> m_Names;
+};
+
+#endif
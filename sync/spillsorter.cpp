@@ -0,0 +1,191 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "spillsorter.h"
+#include <algorithm>
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+namespace{
+	struct NameLess{
+		bool casesensitive;
+
+		NameLess(bool sensitive) : casesensitive(sensitive)
+		{}
+
+		bool operator()(const wxString &first, const wxString &second) const {
+			return SpillSorter::Compare(first, second, casesensitive) < 0;
+		}
+	};
+}
+
+SpillSorter::SpillSorter(size_t budget, bool casesensitive) 
+           : m_Position(0), m_Budget(budget), m_CaseSensitive(casesensitive), m_Spilled(false), m_Failed(false)
+{}
+
+SpillSorter::~SpillSorter(){
+	for(std::vector<Run*>::iterator iter = m_Runs.begin(); iter != m_Runs.end(); ++iter){
+		CloseRun(*iter);
+	}
+}
+
+int SpillSorter::Compare(const wxString &first, const wxString &second, bool casesensitive){
+	return casesensitive ? first.Cmp(second) : first.CmpNoCase(second);
+}
+
+void SpillSorter::Add(const wxString &name){
+	if(!m_Failed && m_Budget > 0 && m_Buffer.size() >= m_Budget){
+		//If we can't write then there is nothing for it but to keep going in memory
+		if(!WriteRun()){
+			m_Failed = true;
+		}
+	}
+	m_Buffer.push_back(name);
+}
+
+void SpillSorter::Finish(){
+	SortBuffer();
+	m_Position = 0;
+	for(std::vector<Run*>::iterator iter = m_Runs.begin(); iter != m_Runs.end(); ++iter){
+		OpenRun(*iter);
+	}
+}
+
+bool SpillSorter::Next(wxString &name){
+	int run = SmallestRun();
+	if(m_Position < m_Buffer.size() 
+	&& (run < 0 || Compare(m_Buffer[m_Position], m_Runs[run]->head, m_CaseSensitive) <= 0)){
+		name = m_Buffer[m_Position++];
+		return true;
+	}
+	if(run < 0){
+		return false;
+	}
+	name = m_Runs[run]->head;
+	m_Runs[run]->valid = ReadName(m_Runs[run]->file, m_Runs[run]->head);
+	return true;
+}
+
+void SpillSorter::SortBuffer(){
+	std::sort(m_Buffer.begin(), m_Buffer.end(), NameLess(m_CaseSensitive));
+}
+
+bool SpillSorter::WriteRun(){
+	SortBuffer();
+	Run *run = new Run;
+	run->file = NULL;
+	run->valid = false;
+	run->path = wxFileName::CreateTempFileName(wxFileName::GetTempDir() + wxFILE_SEP_PATH + wxT("toucan"));
+	if(run->path.empty()){
+		delete run;
+		return false;
+	}
+	wxFFile file(run->path, wxT("wb"));
+	bool success = file.IsOpened();
+	for(std::vector<wxString>::iterator iter = m_Buffer.begin(); success && iter != m_Buffer.end(); ++iter){
+		success = WriteName(&file, *iter);
+	}
+	success = file.Close() && success;
+	if(!success){
+		CloseRun(run);
+		return false;
+	}
+	m_Buffer.clear();
+	m_Runs.push_back(run);
+	m_Spilled = true;
+	//Keep the number of open files and their buffers bounded 
+	if(m_Runs.size() >= MaxRuns){
+		return MergeRuns();
+	}
+	return true;
+}
+
+bool SpillSorter::MergeRuns(){
+	Run *merged = new Run;
+	merged->file = NULL;
+	merged->valid = false;
+	merged->path = wxFileName::CreateTempFileName(wxFileName::GetTempDir() + wxFILE_SEP_PATH + wxT("toucan"));
+	wxFFile file(merged->path, wxT("wb"));
+	bool success = !merged->path.empty() && file.IsOpened();
+	for(std::vector<Run*>::iterator iter = m_Runs.begin(); success && iter != m_Runs.end(); ++iter){
+		success = OpenRun(*iter);
+	}
+	int run;
+	while(success && (run = SmallestRun()) >= 0){
+		success = WriteName(&file, m_Runs[run]->head);
+		m_Runs[run]->valid = ReadName(m_Runs[run]->file, m_Runs[run]->head);
+	}
+	success = file.Close() && success;
+	for(std::vector<Run*>::iterator iter = m_Runs.begin(); iter != m_Runs.end(); ++iter){
+		//On failure we still have the original runs to fall back on
+		if(success){
+			CloseRun(*iter);
+		}
+		else if((*iter)->file){
+			(*iter)->file->Seek(0);
+		}
+	}
+	if(!success){
+		CloseRun(merged);
+		return false;
+	}
+	m_Runs.clear();
+	m_Runs.push_back(merged);
+	return true;
+}
+
+bool SpillSorter::OpenRun(Run *run){
+	if(!run->file){
+		run->file = new wxFFile(run->path, wxT("rb"));
+	}
+	if(!run->file->IsOpened()){
+		run->valid = false;
+		return false;
+	}
+	run->valid = ReadName(run->file, run->head);
+	return true;
+}
+
+int SpillSorter::SmallestRun() const {
+	int smallest = -1;
+	for(size_t i = 0; i < m_Runs.size(); i++){
+		if(m_Runs[i]->valid && (smallest < 0 
+		|| Compare(m_Runs[i]->head, m_Runs[smallest]->head, m_CaseSensitive) < 0)){
+			smallest = i;
+		}
+	}
+	return smallest;
+}
+
+//Each name is its length in bytes followed by the name in UTF-8
+bool SpillSorter::ReadName(wxFFile *file, wxString &name){
+	wxUint32 length;
+	if(file->Read(&length, sizeof(length)) != sizeof(length)){
+		return false;
+	}
+	m_ReadBuffer.resize(length + 1);
+	if(file->Read(&m_ReadBuffer[0], length) != length){
+		return false;
+	}
+	name = wxString::FromUTF8(&m_ReadBuffer[0], length);
+	return true;
+}
+
+bool SpillSorter::WriteName(wxFFile *file, const wxString &name){
+	wxScopedCharBuffer utf8 = name.utf8_str();
+	wxUint32 length = utf8.length();
+	return file->Write(&length, sizeof(length)) == sizeof(length)
+	    && file->Write(utf8.data(), length) == length;
+}
+
+void SpillSorter::CloseRun(Run *run){
+	delete run->file;
+	if(!run->path.empty() && wxFileExists(run->path)){
+		wxRemoveFile(run->path);
+	}
+	delete run;
+}
@@ -0,0 +1,69 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_SPILLSORTER
+#define H_SPILLSORTER
+
+class wxFFile;
+
+#include <vector>
+#include <wx/string.h>
+
+//Sorts any number of names in a fixed amount of memory. Names are kept in 
+//memory until there are more than the budget, then written out to temporary
+//files in sorted runs which are merged back together as they are read
+class SpillSorter
+{
+public:
+	//The budget is the most names held in memory at once
+	SpillSorter(size_t budget, bool casesensitive);
+	~SpillSorter();
+
+	void Add(const wxString &name);
+	//Must be called once everything has been added and before reading
+	void Finish();
+	//Gets the next name in order, false once they have all been read
+	bool Next(wxString &name);
+
+	//Whether any names had to be written out
+	bool IsSpilled() const {return m_Spilled;}
+	//Whether writing failed, in which case everything was kept in memory
+	bool IsFailed() const {return m_Failed;}
+
+	static int Compare(const wxString &first, const wxString &second, bool casesensitive);
+
+	//The most runs we read from at once, any more are merged first
+	static const size_t MaxRuns = 16;
+
+private:
+	struct Run{
+		wxString path;
+		wxFFile *file;
+		wxString head;
+		bool valid;
+	};
+
+	void SortBuffer();
+	bool WriteRun();
+	bool MergeRuns();
+	bool OpenRun(Run *run);
+	//The run with the smallest next name, or -1 if they are all read
+	int SmallestRun() const;
+	bool ReadName(wxFFile *file, wxString &name);
+	bool WriteName(wxFFile *file, const wxString &name);
+	void CloseRun(Run *run);
+
+	std::vector<wxString> m_Buffer;
+	size_t m_Position;
+	std::vector<Run*> m_Runs;
+	std::vector<char> m_ReadBuffer;
+	size_t m_Budget;
+	bool m_CaseSensitive;
+	bool m_Spilled;
+	bool m_Failed;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "statprefetcher.h"
+#include "../throttle.h"
+#include "../toucan.h"
+#include <algorithm>
+#include <wx/stopwatch.h>
+
+class StatPrefetcher::Worker : public wxThread{
+public:
+	Worker(StatPrefetcher *prefetcher, size_t workerindex) 
+	    : wxThread(wxTHREAD_JOINABLE), owner(prefetcher), index(workerindex), seen(0)
+	{}
+
+	virtual void* Entry(){
+		for(;;){
+			{
+				wxMutexLocker lock(owner->m_Mutex);
+				while(!owner->m_Stopping && owner->m_Batch == seen){
+					owner->m_Started.Wait();
+				}
+				if(owner->m_Stopping){
+					return NULL;
+				}
+				seen = owner->m_Batch;
+				//Sit this batch out if the controller wants fewer of us
+				if(index >= owner->m_Limit){
+					continue;
+				}
+			}
+			owner->Work(seen);
+		}
+	}
+
+private:
+	StatPrefetcher *owner;
+	size_t index;
+	unsigned long seen;
+};
+
+StatPrefetcher::StatPrefetcher(size_t threads) 
+              : m_Started(m_Mutex), m_Finished(m_Mutex), m_Batch(0), m_Stopping(false), 
+                m_Controller("Stat", 1, threads + 1, std::min<size_t>(threads + 1, 4)), m_Limit(m_Controller.GetLimit()),
+                m_Paths(NULL), m_States(NULL), m_Next(0), m_Remaining(0), m_Busy(0){
+	//The calling thread is the first worker
+	for(size_t i = 1; i <= threads; i++){
+		Worker *worker = new Worker(this, i);
+		if(worker->Create() != wxTHREAD_NO_ERROR || worker->Run() != wxTHREAD_NO_ERROR){
+			delete worker;
+			break;
+		}
+		m_Workers.push_back(worker);
+	}
+}
+
+StatPrefetcher::~StatPrefetcher(){
+	{
+		wxMutexLocker lock(m_Mutex);
+		m_Stopping = true;
+		m_Started.Broadcast();
+	}
+	for(std::vector<Worker*>::iterator iter = m_Workers.begin(); iter != m_Workers.end(); ++iter){
+		(*iter)->Wait();
+		delete *iter;
+	}
+}
+
+void StatPrefetcher::Get(const std::vector<PathArena::NativeString> &paths, std::vector<FileState> &states){
+	states.assign(paths.size(), FileState());
+	if(paths.empty()){
+		return;
+	}
+	unsigned long batch;
+	{
+		wxMutexLocker lock(m_Mutex);
+		m_Paths = &paths;
+		m_States = &states;
+		m_Remaining = paths.size();
+		m_Next = 0;
+		m_Busy = 0;
+		batch = ++m_Batch;
+		m_Started.Broadcast();
+	}
+	wxStopWatch watch;
+	Work(batch);
+	wxMutexLocker lock(m_Mutex);
+	while(m_Remaining > 0){
+		m_Finished.Wait();
+	}
+	//Small batches say more about the folder than the device
+	if(paths.size() >= m_Limit * 4){
+		m_Limit = m_Controller.Update(paths.size(), watch.TimeInMicro().ToDouble() / 1e6, m_Busy / 1e6 / paths.size());
+	}
+}
+
+void StatPrefetcher::Work(unsigned long batch){
+	size_t begin = 0, end = 0;
+	wxStopWatch watch;
+	for(;;){
+		{
+			wxMutexLocker lock(m_Mutex);
+			if(end > begin){
+				m_Busy += watch.TimeInMicro().ToDouble();
+				m_Remaining -= end - begin;
+				if(m_Remaining == 0){
+					m_Finished.Broadcast();
+				}
+			}
+			//A worker that woke late mustn't take from the next batch
+			if(batch != m_Batch || m_Next >= m_Paths->size()){
+				return;
+			}
+			//Once stopped nobody will look at the rest, so give up on them
+			if(wxGetApp().GetAbort()){
+				m_Remaining -= m_Paths->size() - m_Next;
+				m_Next = m_Paths->size();
+				if(m_Remaining == 0){
+					m_Finished.Broadcast();
+				}
+				return;
+			}
+			//Paths are handed out a few at a time as a stat costs far more 
+			//than the lock, but not so many that threads are left idle
+			size_t chunk = std::max<size_t>(1, std::min<size_t>(8, m_Paths->size() / (m_Limit * 2)));
+			begin = m_Next;
+			end = std::min(begin + chunk, m_Paths->size());
+			m_Next = end;
+		}
+		watch.Start();
+		for(size_t i = begin; i < end; i++){
+			(*m_States)[i] = FileState::Get((*m_Paths)[i]);
+		}
+		Throttle::Account(0, end - begin);
+	}
+}
@@ -0,0 +1,55 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_STATPREFETCHER
+#define H_STATPREFETCHER
+
+#include "patharena.h"
+#include "syncplan.h"
+#include "concurrency.h"
+#include <vector>
+#include <wx/thread.h>
+
+//Looks at a batch of files on several threads at once. On a network share 
+//each look is a round trip, so having many in flight hides most of the wait.
+//How many threads are used is worked out as it goes
+class StatPrefetcher
+{
+public:
+	//At most threads are started on top of the calling one
+	StatPrefetcher(size_t threads);
+	~StatPrefetcher();
+
+	//Fills states with the state of each path, the calling thread helps out
+	//and it returns once they are all done
+	void Get(const std::vector<PathArena::NativeString> &paths, std::vector<FileState> &states);
+
+private:
+	class Worker;
+
+	//Takes paths from the given batch until there are none left
+	void Work(unsigned long batch);
+
+	std::vector<Worker*> m_Workers;
+	wxMutex m_Mutex;
+	wxCondition m_Started;
+	wxCondition m_Finished;
+	//Bumped for each batch so the workers know there is something new
+	unsigned long m_Batch;
+	bool m_Stopping;
+	ConcurrencyController m_Controller;
+	//How many threads, including the caller, take part in each batch
+	size_t m_Limit;
+
+	const std::vector<PathArena::NativeString> *m_Paths;
+	std::vector<FileState> *m_States;
+	size_t m_Next;
+	size_t m_Remaining;
+	//Microseconds spent looking at files in this batch, across all threads
+	double m_Busy;
+};
+
+#endif
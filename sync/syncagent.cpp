@@ -0,0 +1,569 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "syncagent.h"
+#include "../hash.h"
+#include <string.h>
+#include <errno.h>
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+#ifdef __WXMSW__
+	#include <io.h>
+	#include <fcntl.h>
+#else
+	#include <unistd.h>
+	#include <signal.h>
+	#include <dirent.h>
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <pthread.h>
+	#include <sys/stat.h>
+	#include <sys/wait.h>
+#endif
+
+namespace{
+	//Sent by the agent first so we know we are talking to one and not to
+	//whatever a remote shell printed when it started
+	const char hello[] = "ToucanAgent";
+	const size_t hellolength = sizeof(hello) - 1;
+
+	const unsigned char RequestList = 'L';
+	const unsigned char RequestStat = 'S';
+	const unsigned char RequestHash = 'H';
+	const unsigned char RequestQuit = 'Q';
+
+	const unsigned char StatusOk = 0;
+	const unsigned char StatusFailed = 1;
+
+	const unsigned char WireEnd = 0;
+	const unsigned char WireFile = 1;
+	const unsigned char WireFolder = 2;
+
+	const size_t channelbuffer = 64 * 1024;
+	//Nobody has a name this long, anything bigger is a broken stream
+	const unsigned int maxstring = 64 * 1024;
+
+	ssize_t ReadSome(int fd, char *data, size_t length){
+	#ifdef __WXMSW__
+		return _read(fd, data, length);
+	#else
+		ssize_t count;
+		do{
+			count = read(fd, data, length);
+		}
+		while(count < 0 && errno == EINTR);
+		return count;
+	#endif
+	}
+
+	ssize_t WriteSome(int fd, const char *data, size_t length){
+	#ifdef __WXMSW__
+		return _write(fd, data, length);
+	#else
+		//If the agent goes away we want a failed write rather than to be 
+		//killed, so SIGPIPE is held back on this thread while we write and
+		//the rest of the program is left alone
+		sigset_t pipeset, oldset, pending;
+		sigemptyset(&pipeset);
+		sigaddset(&pipeset, SIGPIPE);
+		pthread_sigmask(SIG_BLOCK, &pipeset, &oldset);
+		sigpending(&pending);
+		bool waiting = sigismember(&pending, SIGPIPE) != 0;
+		ssize_t count;
+		do{
+			count = write(fd, data, length);
+		}
+		while(count < 0 && errno == EINTR);
+		int error = errno;
+		if(count < 0 && error == EPIPE && !waiting){
+			//Take back the signal our write raised before it is unblocked
+			sigpending(&pending);
+			if(sigismember(&pending, SIGPIPE)){
+				int raised;
+				sigwait(&pipeset, &raised);
+			}
+		}
+		pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+		errno = error;
+		return count;
+	#endif
+	}
+
+	//False if nothing arrived in time
+	bool WaitToRead(int fd, long milliseconds){
+	#ifdef __WXMSW__
+		wxUnusedVar(fd);
+		wxUnusedVar(milliseconds);
+		return true;
+	#else
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		int ready;
+		do{
+			ready = poll(&pfd, 1, static_cast<int>(milliseconds));
+		}
+		while(ready < 0 && errno == EINTR);
+		//Errors and hang ups are left for the read to find
+		return ready != 0;
+	#endif
+	}
+
+	void CloseDescriptor(int fd){
+	#ifdef __WXMSW__
+		_close(fd);
+	#else
+		close(fd);
+	#endif
+	}
+
+	void WriteEntry(AgentChannel &channel, const wxString &name, bool folder,
+	                unsigned long long size, long long modified){
+		channel.WriteByte(folder ? WireFolder : WireFile);
+		channel.WriteString(name);
+		channel.WriteLong(size);
+		channel.WriteLong(static_cast<unsigned long long>(modified));
+	}
+
+	void ServeList(AgentChannel &channel, const wxString &path){
+	#ifdef __WXMSW__
+		wxDir dir(path);
+		if(!wxDirExists(path) || !dir.IsOpened()){
+			channel.WriteByte(StatusFailed);
+			return;
+		}
+		channel.WriteByte(StatusOk);
+		wxString name;
+		if(dir.GetFirst(&name)){
+			do{
+				wxStructStat st;
+				if(wxStat(path + wxFILE_SEP_PATH + name, &st) == 0){
+					WriteEntry(channel, name, (st.st_mode & S_IFDIR) != 0, st.st_size, st.st_mtime);
+				}
+			}
+			while(dir.GetNext(&name));
+		}
+	#else
+		DIR *dir = opendir(path.fn_str());
+		if(!dir){
+			channel.WriteByte(StatusFailed);
+			return;
+		}
+		channel.WriteByte(StatusOk);
+		//Looking at each entry here is what saves the round trips
+		struct dirent *entry;
+		while((entry = readdir(dir)) != NULL){
+			const char *name = entry->d_name;
+			if(name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))){
+				continue;
+			}
+			struct stat st;
+			if(fstatat(dirfd(dir), name, &st, 0) == 0){
+				WriteEntry(channel, wxString(name, *wxConvFileName), S_ISDIR(st.st_mode), st.st_size, st.st_mtime);
+			}
+		}
+		closedir(dir);
+	#endif
+		channel.WriteByte(WireEnd);
+	}
+
+	void ServeStat(AgentChannel &channel, const wxString &path){
+		wxStructStat st;
+		if(wxStat(path, &st) != 0){
+			channel.WriteByte(StatusFailed);
+			return;
+		}
+		channel.WriteByte(StatusOk);
+		WriteEntry(channel, wxFileName(path).GetFullName(), (st.st_mode & S_IFDIR) != 0, st.st_size, st.st_mtime);
+	}
+
+	void ServeHash(AgentChannel &channel, const wxString &path, unsigned int blocksize){
+		wxFile file;
+		if(!wxFileExists(path) || !file.Open(path, wxFile::read)){
+			channel.WriteByte(StatusFailed);
+			return;
+		}
+		ContentHash whole, block;
+		std::vector<unsigned long long> blocks;
+		std::vector<char> buffer(1024 * 1024);
+		unsigned long long inblock = 0;
+		for(;;){
+			size_t wanted = buffer.size();
+			if(blocksize > 0 && blocksize - inblock < wanted){
+				wanted = blocksize - inblock;
+			}
+			ssize_t count = file.Read(&buffer[0], wanted);
+			if(count == wxInvalidOffset){
+				channel.WriteByte(StatusFailed);
+				return;
+			}
+			if(count == 0){
+				break;
+			}
+			whole.Update(&buffer[0], count);
+			if(blocksize > 0){
+				block.Update(&buffer[0], count);
+				inblock += count;
+				if(inblock == blocksize){
+					blocks.push_back(block.GetValue());
+					block.Reset();
+					inblock = 0;
+				}
+			}
+		}
+		if(inblock > 0){
+			blocks.push_back(block.GetValue());
+		}
+		channel.WriteByte(StatusOk);
+		channel.WriteLong(whole.GetValue());
+		channel.WriteInt(blocks.size());
+		for(std::vector<unsigned long long>::iterator iter = blocks.begin(); iter != blocks.end(); ++iter){
+			channel.WriteLong(*iter);
+		}
+	}
+}
+
+AgentChannel::AgentChannel(int in, int out) : m_In(in), m_Out(out), m_Timeout(-1), m_Failed(false), m_ReadPosition(0)
+{}
+
+void AgentChannel::Attach(int in, int out){
+	m_In = in;
+	m_Out = out;
+	m_Failed = false;
+	m_ReadBuffer.clear();
+	m_ReadPosition = 0;
+	m_WriteBuffer.clear();
+}
+
+void AgentChannel::Close(){
+	if(m_In >= 0){
+		CloseDescriptor(m_In);
+	}
+	if(m_Out >= 0 && m_Out != m_In){
+		CloseDescriptor(m_Out);
+	}
+	m_In = m_Out = -1;
+}
+
+void AgentChannel::WriteByte(unsigned char value){
+	m_WriteBuffer.push_back(static_cast<char>(value));
+}
+
+void AgentChannel::WriteInt(unsigned int value){
+	for(int i = 0; i < 4; i++){
+		m_WriteBuffer.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+	}
+}
+
+void AgentChannel::WriteLong(unsigned long long value){
+	for(int i = 0; i < 8; i++){
+		m_WriteBuffer.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+	}
+}
+
+void AgentChannel::WriteString(const wxString &value){
+	const wxCharBuffer utf8 = value.utf8_str();
+	WriteInt(utf8.length());
+	WriteBytes(utf8.data(), utf8.length());
+}
+
+void AgentChannel::WriteBytes(const char *data, size_t length){
+	m_WriteBuffer.insert(m_WriteBuffer.end(), data, data + length);
+}
+
+bool AgentChannel::Flush(){
+	size_t written = 0;
+	while(!m_Failed && written < m_WriteBuffer.size()){
+		ssize_t count = WriteSome(m_Out, &m_WriteBuffer[written], m_WriteBuffer.size() - written);
+		if(count <= 0){
+			m_Failed = true;
+		}
+		else{
+			written += count;
+		}
+	}
+	m_WriteBuffer.clear();
+	return !m_Failed;
+}
+
+bool AgentChannel::ReadBytes(char *data, size_t length){
+	while(length > 0 && !m_Failed){
+		if(m_ReadPosition == m_ReadBuffer.size()){
+			m_ReadBuffer.resize(channelbuffer);
+			ssize_t count = -1;
+			if(m_Timeout < 0 || WaitToRead(m_In, m_Timeout)){
+				count = ReadSome(m_In, &m_ReadBuffer[0], m_ReadBuffer.size());
+			}
+			if(count <= 0){
+				m_ReadBuffer.clear();
+				m_Failed = true;
+				break;
+			}
+			m_ReadBuffer.resize(count);
+			m_ReadPosition = 0;
+		}
+		size_t available = wxMin(length, m_ReadBuffer.size() - m_ReadPosition);
+		memcpy(data, &m_ReadBuffer[m_ReadPosition], available);
+		m_ReadPosition += available;
+		data += available;
+		length -= available;
+	}
+	return !m_Failed;
+}
+
+bool AgentChannel::ReadByte(unsigned char &value){
+	char byte;
+	if(!ReadBytes(&byte, 1)){
+		return false;
+	}
+	value = static_cast<unsigned char>(byte);
+	return true;
+}
+
+bool AgentChannel::ReadInt(unsigned int &value){
+	unsigned char bytes[4];
+	if(!ReadBytes(reinterpret_cast<char*>(bytes), 4)){
+		return false;
+	}
+	value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<unsigned int>(bytes[3]) << 24);
+	return true;
+}
+
+bool AgentChannel::ReadLong(unsigned long long &value){
+	unsigned char bytes[8];
+	if(!ReadBytes(reinterpret_cast<char*>(bytes), 8)){
+		return false;
+	}
+	value = 0;
+	for(int i = 7; i >= 0; i--){
+		value = (value << 8) | bytes[i];
+	}
+	return true;
+}
+
+bool AgentChannel::ReadString(wxString &value){
+	unsigned int length;
+	if(!ReadInt(length)){
+		return false;
+	}
+	if(length > maxstring){
+		m_Failed = true;
+		return false;
+	}
+	std::vector<char> data(length + 1, 0);
+	if(length > 0 && !ReadBytes(&data[0], length)){
+		return false;
+	}
+	value = wxString::FromUTF8(&data[0], length);
+	return true;
+}
+
+SyncAgent::SyncAgent() : m_Pid(0)
+{}
+
+SyncAgent::~SyncAgent(){
+	Stop();
+}
+
+bool SyncAgent::Start(const wxString &command){
+#ifdef __WXMSW__
+	wxUnusedVar(command);
+	return false;
+#else
+	int tochild[2], fromchild[2];
+	if(pipe(tochild) != 0){
+		return false;
+	}
+	if(pipe(fromchild) != 0){
+		close(tochild[0]);
+		close(tochild[1]);
+		return false;
+	}
+	//Only exec is safe after forking a threaded program so get this ready now
+	const wxCharBuffer shell = command.mb_str();
+	pid_t pid = fork();
+	if(pid < 0){
+		close(tochild[0]);
+		close(tochild[1]);
+		close(fromchild[0]);
+		close(fromchild[1]);
+		return false;
+	}
+	if(pid == 0){
+		dup2(tochild[0], 0);
+		dup2(fromchild[1], 1);
+		close(tochild[0]);
+		close(tochild[1]);
+		close(fromchild[0]);
+		close(fromchild[1]);
+		execl("/bin/sh", "sh", "-c", shell.data(), static_cast<char*>(NULL));
+		_exit(127);
+	}
+	close(tochild[0]);
+	close(fromchild[1]);
+	m_Pid = pid;
+	return Attach(fromchild[0], tochild[1]);
+#endif
+}
+
+bool SyncAgent::Attach(int in, int out, long timeout){
+	m_Channel.Attach(in, out);
+	return Hello(timeout);
+}
+
+bool SyncAgent::Hello(long timeout){
+	//A command that never starts the agent, or is stuck asking for a 
+	//password, mustn't hold up the job for ever
+	m_Channel.SetTimeout(timeout);
+	char greeting[hellolength];
+	unsigned int version;
+	if(!m_Channel.ReadBytes(greeting, hellolength) || memcmp(greeting, hello, hellolength) != 0
+	|| !m_Channel.ReadInt(version) || version != Version){
+		m_Channel.SetTimeout(-1);
+		Interrupt();
+		Stop();
+		return false;
+	}
+	//After that a request can take as long as the disk does
+	m_Channel.SetTimeout(-1);
+	return true;
+}
+
+void SyncAgent::Interrupt(){
+#ifndef __WXMSW__
+	if(m_Pid > 0){
+		kill(m_Pid, SIGTERM);
+	}
+#endif
+}
+
+void SyncAgent::Stop(){
+	if(m_Channel.IsOk()){
+		m_Channel.WriteByte(RequestQuit);
+		m_Channel.Flush();
+	}
+	m_Channel.Close();
+#ifndef __WXMSW__
+	if(m_Pid > 0){
+		waitpid(m_Pid, NULL, 0);
+		m_Pid = 0;
+	}
+#endif
+}
+
+bool SyncAgent::List(const wxString &path, std::vector<Entry> &entries){
+	entries.clear();
+	m_Channel.WriteByte(RequestList);
+	m_Channel.WriteString(path);
+	unsigned char status;
+	if(!m_Channel.Flush() || !m_Channel.ReadByte(status) || status != StatusOk){
+		return false;
+	}
+	for(;;){
+		unsigned char kind;
+		if(!m_Channel.ReadByte(kind)){
+			return false;
+		}
+		if(kind == WireEnd){
+			return true;
+		}
+		Entry entry;
+		unsigned long long modified;
+		if(!m_Channel.ReadString(entry.name) || !m_Channel.ReadLong(entry.size) || !m_Channel.ReadLong(modified)){
+			return false;
+		}
+		entry.folder = kind == WireFolder;
+		entry.modified = static_cast<long long>(modified);
+		entries.push_back(entry);
+	}
+}
+
+bool SyncAgent::Stat(const wxString &path, Entry &entry){
+	m_Channel.WriteByte(RequestStat);
+	m_Channel.WriteString(path);
+	unsigned char status, kind;
+	unsigned long long modified;
+	if(!m_Channel.Flush() || !m_Channel.ReadByte(status) || status != StatusOk
+	|| !m_Channel.ReadByte(kind) || !m_Channel.ReadString(entry.name)
+	|| !m_Channel.ReadLong(entry.size) || !m_Channel.ReadLong(modified)){
+		return false;
+	}
+	entry.folder = kind == WireFolder;
+	entry.modified = static_cast<long long>(modified);
+	return true;
+}
+
+bool SyncAgent::Hash(const wxString &path, unsigned int blocksize, unsigned long long &hash,
+                     std::vector<unsigned long long> *blocks){
+	m_Channel.WriteByte(RequestHash);
+	m_Channel.WriteString(path);
+	m_Channel.WriteInt(blocksize);
+	unsigned char status;
+	unsigned int count;
+	if(!m_Channel.Flush() || !m_Channel.ReadByte(status) || status != StatusOk
+	|| !m_Channel.ReadLong(hash) || !m_Channel.ReadInt(count)){
+		return false;
+	}
+	if(blocks){
+		blocks->clear();
+	}
+	for(unsigned int i = 0; i < count; i++){
+		unsigned long long block;
+		if(!m_Channel.ReadLong(block)){
+			return false;
+		}
+		if(blocks){
+			blocks->push_back(block);
+		}
+	}
+	return true;
+}
+
+bool SyncAgent::Serve(int in, int out){
+#ifdef __WXMSW__
+	_setmode(in, _O_BINARY);
+	_setmode(out, _O_BINARY);
+#endif
+	AgentChannel channel(in, out);
+	channel.WriteBytes(hello, hellolength);
+	channel.WriteInt(Version);
+	if(!channel.Flush()){
+		return false;
+	}
+	for(;;){
+		unsigned char request;
+		wxString path;
+		//The other side going away is as good as being told to stop
+		if(!channel.ReadByte(request) || request == RequestQuit){
+			return true;
+		}
+		if(!channel.ReadString(path)){
+			return false;
+		}
+		if(request == RequestList){
+			ServeList(channel, path);
+		}
+		else if(request == RequestStat){
+			ServeStat(channel, path);
+		}
+		else if(request == RequestHash){
+			unsigned int blocksize;
+			if(!channel.ReadInt(blocksize)){
+				return false;
+			}
+			ServeHash(channel, path, blocksize);
+		}
+		else{
+			return false;
+		}
+		if(!channel.Flush()){
+			return false;
+		}
+	}
+}
@@ -0,0 +1,102 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_SYNCAGENT
+#define H_SYNCAGENT
+
+#include <vector>
+#include <wx/string.h>
+
+//Buffered reading and writing of the agent protocol over a pair of file
+//descriptors. Numbers are little endian and strings are UTF-8 with their
+//length in front
+class AgentChannel
+{
+public:
+	AgentChannel(int in = -1, int out = -1);
+
+	void Attach(int in, int out);
+	//Closes both descriptors
+	void Close();
+	//How long a read waits for the other side before failing, -1 for as 
+	//long as it takes. Not supported on Windows
+	void SetTimeout(long milliseconds) {m_Timeout = milliseconds;}
+	bool IsOk() const {return m_In >= 0 && m_Out >= 0 && !m_Failed;}
+
+	void WriteByte(unsigned char value);
+	void WriteInt(unsigned int value);
+	void WriteLong(unsigned long long value);
+	void WriteString(const wxString &value);
+	void WriteBytes(const char *data, size_t length);
+	bool Flush();
+
+	bool ReadByte(unsigned char &value);
+	bool ReadInt(unsigned int &value);
+	bool ReadLong(unsigned long long &value);
+	bool ReadString(wxString &value);
+	bool ReadBytes(char *data, size_t length);
+
+private:
+	int m_In;
+	int m_Out;
+	long m_Timeout;
+	bool m_Failed;
+	std::vector<char> m_ReadBuffer;
+	size_t m_ReadPosition;
+	std::vector<char> m_WriteBuffer;
+};
+
+//Talks to a toucan --agent process running next to the data so that folders
+//can be listed, files looked at and hashed without a round trip for each one.
+//The agent can be started with any command that ends up running it with its
+//stdin and stdout connected to us, for example over ssh
+class SyncAgent
+{
+public:
+	struct Entry{
+		wxString name;
+		bool folder;
+		unsigned long long size;
+		long long modified;
+	};
+
+	SyncAgent();
+	~SyncAgent();
+
+	//Runs the command through the shell, not supported on Windows
+	bool Start(const wxString &command);
+	//Uses an agent that is already running on the other end of in and out,
+	//giving up if it hasn't said hello within the timeout
+	bool Attach(int in, int out, long timeout = HelloTimeout);
+	bool IsOk() const {return m_Channel.IsOk();}
+	//Stops an agent we started so that a request waiting on it fails, it
+	//is safe to call from another thread
+	void Interrupt();
+
+	bool List(const wxString &path, std::vector<Entry> &entries);
+	//False if the path doesn't exist or the agent has gone
+	bool Stat(const wxString &path, Entry &entry);
+	//The ContentHash of the whole file along with one for each block if
+	//blocks are wanted
+	bool Hash(const wxString &path, unsigned int blocksize, unsigned long long &hash,
+	          std::vector<unsigned long long> *blocks = NULL);
+
+	//Answers requests until told to stop or the other side goes away
+	static bool Serve(int in, int out);
+
+	static const unsigned int Version = 1;
+	//Long enough for a remote shell to log in and start the agent
+	static const long HelloTimeout = 30000;
+
+private:
+	bool Hello(long timeout);
+	void Stop();
+
+	AgentChannel m_Channel;
+	long m_Pid;
+};
+
+#endif
@@ -5,9 +5,12 @@
 /////////////////////////////////////////////////////////////////////////////////
 
 #include "syncbase.h"
+#include "syncplan.h"
 #include "../rules.h"
 #include "../path.h"
 #include "../basicfunctions.h"
+#include "../hash.h"
+#include "../throttle.h"
 #include "../data/syncdata.h"
 #include <wx/dir.h>
 #include <wx/filefn.h>
@@ -18,8 +21,9 @@
 #include <memory>
 
 SyncBase::SyncBase(const wxFileName &source, const wxFileName &dest, SyncData* syncdata) 
-         :data(syncdata)
+         :data(syncdata), function(syncdata->GetFunctionType()), checks(syncdata->GetChecks())
 {
+    comparer = GetComparer(checks);
     this->sourceroot = Path::Normalise(source);
     this->destroot = Path::Normalise(dest);
 }
@@ -72,34 +76,92 @@ void SyncBase::OperationCaller(std::map<wxString, Location> paths){
         if(wxGetApp().GetAbort())
 			return;
 
-        wxFileName source, dest;
-        if(wxDirExists(sourceroot.GetPathWithSep() + (*iter).first)
-        || wxDirExists(destroot.GetPathWithSep() + (*iter).first)){
-            source = wxFileName::DirName(sourceroot.GetPathWithSep() + (*iter).first);
-            dest = wxFileName::DirName(destroot.GetPathWithSep() + (*iter).first); 
-
-            if((*iter).second == Source)
-                OnSourceNotDestFolder(source, dest);
-            else if((*iter).second == Dest)
-                OnNotSourceDestFolder(source, dest);
-            else if((*iter).second == SourceAndDest)
-                OnSourceAndDestFolder(source, dest);
-        }
-        else{
-            source = wxFileName::FileName(sourceroot.GetPathWithSep() + (*iter).first);
-            dest = wxFileName::FileName(destroot.GetPathWithSep() + (*iter).first); 
-
-            if((*iter).second == Source)
-                OnSourceNotDestFile(source, dest);
-            else if((*iter).second == Dest)
-                OnNotSourceDestFile(source, dest);				
-            else if((*iter).second == SourceAndDest)
-                OnSourceAndDestFile(source, dest);
-        }
+        Dispatch(sourceroot.GetPathWithSep() + (*iter).first, destroot.GetPathWithSep() + (*iter).first, (*iter).second);
     }
     return;
 }
 
+void SyncBase::Dispatch(const wxString &sourcepath, const wxString &destpath, Location location, EntryKind kind){
+    wxFileName source, dest;
+    if(kind == EntryFolder || (kind == EntryUnknown && (wxDirExists(sourcepath) || wxDirExists(destpath)))){
+        source = wxFileName::DirName(sourcepath);
+        dest = wxFileName::DirName(destpath); 
+
+        if(location == Source)
+            OnSourceNotDestFolder(source, dest);
+        else if(location == Dest)
+            OnNotSourceDestFolder(source, dest);
+        else if(location == SourceAndDest)
+            OnSourceAndDestFolder(source, dest);
+    }
+    else{
+        source = wxFileName::FileName(sourcepath);
+        dest = wxFileName::FileName(destpath); 
+
+        if(location == Source)
+            OnSourceNotDestFile(source, dest);
+        else if(location == Dest)
+            OnNotSourceDestFile(source, dest);				
+        else if(location == SourceAndDest)
+            OnSourceAndDestFile(source, dest);
+    }
+}
+
+namespace{
+	template<int Checks>
+	bool ShouldCopyWith(const wxFileName &source, const wxFileName &dest, 
+	                    const FileState *sourcestate, const FileState *deststate){
+		bool states = sourcestate && deststate;
+		//Copy if anything says copy
+		return ((Checks & SyncCheckSize) && (states ? SyncBase::ShouldCopySize(*sourcestate, *deststate) 
+		                                            : SyncBase::ShouldCopySize(source, dest)))
+		    || ((Checks & SyncCheckTime) && (states ? SyncBase::ShouldCopyTime(*sourcestate, *deststate)
+		                                            : SyncBase::ShouldCopyTime(source, dest)))
+		    || ((Checks & SyncCheckShort) && SyncBase::ShouldCopyShort(source, dest))
+		    || ((Checks & SyncCheckFull) && SyncBase::ShouldCopyFull(source, dest));
+	}
+}
+
+SyncComparer SyncBase::GetComparer(int checks){
+	static const SyncComparer comparers[16] = {
+		ShouldCopyWith<0>, ShouldCopyWith<1>, ShouldCopyWith<2>, ShouldCopyWith<3>,
+		ShouldCopyWith<4>, ShouldCopyWith<5>, ShouldCopyWith<6>, ShouldCopyWith<7>,
+		ShouldCopyWith<8>, ShouldCopyWith<9>, ShouldCopyWith<10>, ShouldCopyWith<11>,
+		ShouldCopyWith<12>, ShouldCopyWith<13>, ShouldCopyWith<14>, ShouldCopyWith<15>
+	};
+	return comparers[checks & 15];
+}
+
+bool SyncBase::ShouldCopy(const wxFileName &source, const wxFileName &dest, SyncData *data){
+	int checks = data->GetChecks();
+	return ShouldCopy(source, dest, checks, GetComparer(checks));
+}
+
+bool SyncBase::ShouldCopy(const wxFileName &source, const wxFileName &dest, int checks, SyncComparer comparer,
+                          const FileState *sourcestate, const FileState *deststate, bool preview){
+	//If the dest file doesn't exists then we must copy
+	if(deststate ? !deststate->exists : !dest.FileExists()){
+		return true;
+	}
+	//With no checks we always copy
+	if(checks == 0){
+		return true;
+	}
+	//Only the comparisons that read the files are worth remembering, the 
+	//others are as cheap as checking the files haven't changed
+	bool remember = (checks & (SyncCheckShort | SyncCheckFull)) != 0;
+	bool copy;
+	if(remember && SyncDecisions::Recall(source, dest, checks, copy)){
+		return copy;
+	}
+	copy = comparer(source, dest, sourcestate, deststate);
+	//Nothing will come along to use what a run works out
+	if(remember && preview){
+		SyncDecisions::Remember(source, dest, checks, copy);
+	}
+	return copy;
+}
+
 bool SyncBase::ShouldCopySize(const wxFileName &source, const wxFileName &dest){
 	return !(source.GetSize() == dest.GetSize());
 }
@@ -122,6 +184,15 @@ bool SyncBase::ShouldCopyTime(const wxFileName &source, const wxFileName &dest){
 	}
 }
 
+bool SyncBase::ShouldCopySize(const FileState &source, const FileState &dest){
+	return source.size != dest.size;
+}
+
+bool SyncBase::ShouldCopyTime(const FileState &source, const FileState &dest){
+	//The same two second allowance as above
+	return source.modified - dest.modified > 2;
+}
+
 bool SyncBase::ShouldCopyShort(const wxFileName &source, const wxFileName &dest){
 	//For more detailed comments see the ShouldCopyFull function
 	std::unique_ptr<wxFileInputStream> sourcestream(new wxFileInputStream(source.GetFullPath()));
@@ -175,6 +246,14 @@ bool SyncBase::ShouldCopyShort(const wxFileName &source, const wxFileName &dest)
 }
 
 bool SyncBase::ShouldCopyFull(const wxFileName &source, const wxFileName &dest){
+	//If we have read both files before and they are unchanged we already know
+	unsigned long long sourcehash, desthash;
+	if(HashCache::Recall(source, sourcehash) && HashCache::Recall(dest, desthash)){
+		return sourcehash != desthash;
+	}
+	//Taken before reading so a file changed while we read it isn't trusted
+	FileIdentity sourceidentity = FileIdentity::Get(source), destidentity = FileIdentity::Get(dest);
+
 	std::unique_ptr<wxFileInputStream> sourcestream(new wxFileInputStream(source.GetFullPath()));
 	std::unique_ptr<wxFileInputStream> deststream(new wxFileInputStream(dest.GetFullPath()));
 
@@ -200,6 +279,8 @@ bool SyncBase::ShouldCopyFull(const wxFileName &source, const wxFileName &dest){
 	std::vector<char> sourcebuf(4096);
 	std::vector<char> destbuf(4096);
 
+	//Remember what we read in case we see these files again
+	ContentHash hash;
 	wxFileOffset bytesLeft = size;
 	while(bytesLeft > 0){
 		wxFileOffset bytesToRead = wxMin(4096, bytesLeft);
@@ -209,8 +290,9 @@ bool SyncBase::ShouldCopyFull(const wxFileName &source, const wxFileName &dest){
 		deststream->Read(&destbuf[0], bytesToRead);
 
 		//If we have a read error then return false as it is potentially 
-		//unsafe to copy
-		if(sourcestream->GetLastError() != wxSTREAM_NO_ERROR || deststream->GetLastError() != wxSTREAM_NO_ERROR){
+		//unsafe to copy, the same goes for being stopped part way through
+		if(sourcestream->GetLastError() != wxSTREAM_NO_ERROR || deststream->GetLastError() != wxSTREAM_NO_ERROR
+		|| wxGetApp().GetAbort()){
 			return false;
 		}
 
@@ -219,8 +301,13 @@ bool SyncBase::ShouldCopyFull(const wxFileName &source, const wxFileName &dest){
 		if(wxTmemcmp(&sourcebuf[0], &destbuf[0], bytesToRead) != 0){
 			return true;
 		}
+		hash.Update(&sourcebuf[0], bytesToRead);
 		bytesLeft-=bytesToRead;
+		//The streams are buffered so only the bytes count against us
+		Throttle::Account(bytesToRead * 2, 0);
 	}
 	//If we make it here then the files are the same
+	HashCache::Remember(source, sourceidentity, hash.GetValue());
+	HashCache::Remember(dest, destidentity, hash.GetValue());
 	return false;
 }
@@ -7,9 +7,10 @@
 #ifndef H_SYNCBASE
 #define H_SYNCBASE
 
-class SyncData;
 class Rules;
 
+#include "../data/syncdata.h"
+#include "syncplan.h"
 #include <map>
 #include <list>
 #include <wx/string.h>
@@ -21,16 +22,47 @@ enum Location{
     SourceAndDest
 };
 
+//What an entry found while listing a folder is, if the listing told us
+enum EntryKind{
+    EntryUnknown,
+    EntryFile,
+    EntryFolder
+};
+
+//Compares two files with a fixed set of checks, see SyncBase::GetComparer.
+//The states are used instead of asking the filesystem again when both given
+typedef bool (*SyncComparer)(const wxFileName &source, const wxFileName &dest, 
+                             const FileState *sourcestate, const FileState *deststate);
+
 class SyncBase
 {
 public:
 	SyncBase(const wxFileName &syncsource, const wxFileName &syncdest, SyncData* syncdata);
 	virtual ~SyncBase();
 
+	//Whether dest needs replacing with source given the checks of the job,
+	//reusing the result of a preview if neither file has changed since. A 
+	//preview remembers what it works out for the run after it
+	static bool ShouldCopy(const wxFileName &source, const wxFileName &dest, SyncData *data);
+	static bool ShouldCopy(const wxFileName &source, const wxFileName &dest, int checks, SyncComparer comparer,
+	                       const FileState *sourcestate = NULL, const FileState *deststate = NULL, bool preview = false);
+	//The comparison for a set of SyncCheck bits, each set is compiled 
+	//separately so unused checks cost nothing per file
+	static SyncComparer GetComparer(int checks);
+
+	static bool ShouldCopySize(const wxFileName &source, const wxFileName &dest);
+	static bool ShouldCopyTime(const wxFileName &source, const wxFileName &dest);
+	static bool ShouldCopySize(const FileState &source, const FileState &dest);
+	static bool ShouldCopyTime(const FileState &source, const FileState &dest);
+	static bool ShouldCopyShort(const wxFileName &source, const wxFileName &dest);
+	static bool ShouldCopyFull(const wxFileName &source, const wxFileName &dest);
+
 protected:
 	std::list<wxString> FolderContentsToList(const wxFileName &path);
     std::map<wxString, Location> MergeListsToMap(std::list<wxString> sourcelist, std::list<wxString> destlist);
     void OperationCaller(std::map<wxString, Location> paths);
+    //Calls the right handler for an entry found in either or both folders
+    void Dispatch(const wxString &sourcepath, const wxString &destpath, Location location, EntryKind kind = EntryUnknown);
 
 	virtual void OnSourceNotDestFile(const wxFileName &source, const wxFileName &dest) = 0;
 	virtual void OnNotSourceDestFile(const wxFileName &source, const wxFileName &dest) = 0;
@@ -39,14 +71,12 @@ protected:
 	virtual void OnNotSourceDestFolder(const wxFileName &source, const wxFileName &dest) = 0;
 	virtual void OnSourceAndDestFolder(const wxFileName &source, const wxFileName &dest) = 0;
 
-	bool ShouldCopySize(const wxFileName &source, const wxFileName &dest);
-	bool ShouldCopyTime(const wxFileName &source, const wxFileName &dest);
-	bool ShouldCopyShort(const wxFileName &source, const wxFileName &dest);
-	bool ShouldCopyFull(const wxFileName &source, const wxFileName &dest);
-
 	wxFileName sourceroot;
 	wxFileName destroot;
 	SyncData *data;
+	SyncFunction function;
+	int checks;
+	SyncComparer comparer;
 };
 
 #endif
@@ -11,77 +11,754 @@
 #include "../basicfunctions.h"
 #include "../fileops.h"
 #include "../path.h"
+#include "../progress.h"
+#include "../settings.h"
+#include "../hash.h"
+#include "../throttle.h"
+#include "spillsorter.h"
 
 #include <list>
 #include <map>
+#include <algorithm>
+#include <chrono>
 #include <wx/string.h>
 #include <wx/log.h>
 #include <wx/dir.h>
 #include <wx/filename.h>
 
-SyncJob::SyncJob(SyncData *Data) : Job(Data){
+#ifndef __WXMSW__
+	#include <dirent.h>
+	#include <string.h>
+#endif
+
+namespace{
+	//Throttles the job for as long as it runs, limits given on the command
+	//line win over the job's own. The settings come from the first job, the
+	//disks watched are those of all of them
+	class JobThrottle{
+	public:
+		JobThrottle(const std::vector<SyncData*> &datas){
+			SyncData *data = datas.front();
+			Throttle::Limits limits = wxGetApp().GetThrottle();
+			limits.background = limits.background || data->GetBackground();
+			if(limits.bytespersec == 0 && data->GetBandwidthLimit() > 0){
+				limits.bytespersec = static_cast<unsigned long long>(data->GetBandwidthLimit()) * 1024;
+			}
+			if(limits.opspersec == 0 && data->GetIopsLimit() > 0){
+				limits.opspersec = data->GetIopsLimit();
+			}
+			if(limits.background){
+				Throttle::LowerPriority();
+			}
+			wxArrayString paths;
+			paths.Add(data->GetSource().GetFullPath());
+			for(size_t i = 0; i < datas.size(); i++){
+				paths.Add(datas[i]->GetDest().GetFullPath());
+			}
+			Throttle::Begin(limits, &wxGetApp().GetCancel(), paths);
+		}
+
+		~JobThrottle(){
+			Throttle::End();
+		}
+	};
+
+	//Clears out the old versions the job no longer wants to keep
+	void PruneVersions(SyncData *data){
+		if(!data->GetVersions() || data->GetKeepVersions() <= 0 || wxGetApp().GetAbort()){
+			return;
+		}
+		size_t removed = SyncVersions::Prune(data->GetDest(), data->GetKeepVersions(), &wxGetApp().GetCancel());
+		if(removed > 0){
+			OutputProgress(wxString::Format(_("Removed old versions from %u days"), static_cast<unsigned int>(removed)), Message);
+		}
+	}
+}
+
+SyncJob::SyncJob(SyncData *Data, SyncPlan *Plan) : Job(Data), m_Plan(Plan){
 	;
 }
 
 void* SyncJob::Entry(){
 	SyncData *data = static_cast<SyncData*>(GetData());
-	SyncFiles sync(data->GetSource(), data->GetDest(), data);
-	sync.Execute();
+	JobThrottle throttle(std::vector<SyncData*>(1, data));
+	WriteBarrier barrier(data->GetDurability());
+	std::unique_ptr<SyncBaseline> baseline;
+	if(data->GetFunctionType() == SyncEqualise){
+		baseline.reset(new SyncBaseline(data, data->GetCheckFull()));
+	}
+	if(m_Plan){
+		SyncRunner runner(data, &barrier, NULL, baseline.get());
+		runner.Run(*m_Plan);
+		//The final barrier, so everything is on disk before we say we are done
+		runner.Commit();
+		//A plan only covers what it changes, so the rest of the baseline stays
+		if(baseline){
+			baseline->Save(false);
+		}
+		PruneVersions(data);
+		return NULL;
+	}
+	SyncJournal journal(data);
+	if(journal.IsResumed()){
+		OutputProgress(_("Carrying on from where the last run stopped"), Message);
+	}
+	SyncRunner runner(data, &barrier, &journal, baseline.get());
+	SyncFiles sync(data->GetSource(), data->GetDest(), data, &runner, NULL, &journal, baseline.get());
+	sync.Start();
+	runner.Commit();
+	//Keep the journal for next time if we were stopped
+	if(!wxGetApp().GetAbort()){
+		journal.Finish();
+	}
+	//Folders skipped by the journal weren't seen, so a resumed run keeps 
+	//what it had for them
+	if(baseline){
+		baseline->Save(!wxGetApp().GetAbort() && !journal.IsResumed());
+	}
+	PruneVersions(data);
 	return NULL;
 }
 
-SyncFiles::SyncFiles(const wxFileName &syncsource, const wxFileName &syncdest, SyncData* syncdata) 
-          : SyncBase(syncsource, syncdest, syncdata)
+namespace{
+	//Works out the plan for one destination of a fan out
+	class SyncPlanner : public wxThread{
+	public:
+		SyncPlanner(SyncData *syncdata, SyncPlan *syncplan) 
+		    : wxThread(wxTHREAD_JOINABLE), data(syncdata), plan(syncplan)
+		{}
+
+		void Plan(){
+			SyncFiles sync(data->GetSource(), data->GetDest(), data, NULL, plan);
+			sync.Start();
+		}
+
+	protected:
+		virtual void* Entry(){
+			Plan();
+			return NULL;
+		}
+
+	private:
+		SyncData *data;
+		SyncPlan *plan;
+	};
+
+	//Where a copy is in the plans, the plan and then the operation
+	typedef std::vector<std::pair<size_t, size_t> > CopyTargets;
+}
+
+SyncFanOutJob::SyncFanOutJob(const std::vector<SyncData*> &datas) : Job(datas.front()), m_Datas(datas){
+	;
+}
+
+SyncFanOutJob::~SyncFanOutJob(){
+	//The first one belongs to the job
+	for(size_t i = 1; i < m_Datas.size(); i++){
+		delete m_Datas[i];
+	}
+}
+
+void* SyncFanOutJob::Entry(){
+	JobThrottle throttle(m_Datas);
+	std::vector<SyncPlan> plans(m_Datas.size());
+	std::vector<std::unique_ptr<SyncPlanner> > planners;
+	for(size_t i = 0; i < m_Datas.size(); i++){
+		planners.push_back(std::unique_ptr<SyncPlanner>(new SyncPlanner(m_Datas[i], &plans[i])));
+		if(planners.back()->Create() == wxTHREAD_NO_ERROR){
+			planners.back()->Run();
+		}
+		else{
+			planners.back()->Plan();
+			planners.pop_back();
+		}
+	}
+	for(size_t i = 0; i < planners.size(); i++){
+		planners[i]->Wait();
+	}
+	if(wxGetApp().GetAbort()){
+		return NULL;
+	}
+
+	//Group the copies by their source so each is only read once, and only
+	//count its bytes once
+	std::map<wxString, CopyTargets> copies;
+	unsigned long long files = 0, bytes = 0;
+	for(size_t i = 0; i < plans.size(); i++){
+		const std::vector<SyncOperation> &operations = plans[i].GetOperations();
+		for(size_t j = 0; j < operations.size(); j++){
+			const SyncOperation &operation = operations[j];
+			if(operation.type == SyncCopyFile || operation.type == SyncSkipFile || operation.type == SyncRemoveFile){
+				files++;
+			}
+			if(operation.type == SyncSkipFile && operation.sourcestate.exists){
+				bytes += operation.sourcestate.size;
+			}
+			else if(operation.type == SyncCopyFile){
+				CopyTargets &targets = copies[operation.source];
+				if(targets.empty() && operation.sourcestate.exists){
+					bytes += operation.sourcestate.size;
+				}
+				targets.push_back(std::make_pair(i, j));
+			}
+		}
+	}
+	Progress::SetTotal(files, bytes);
+
+	SyncData *data = m_Datas.front();
+	WriteBarrier barrier(data->GetDurability());
+	SyncRunner runner(data, &barrier);
+	for(size_t i = 1; i < m_Datas.size(); i++){
+		if(m_Datas[i]->GetVersions()){
+			runner.AddVersions(m_Datas[i]->GetDest());
+		}
+	}
+	std::vector<std::vector<bool> > done(plans.size());
+	for(size_t i = 0; i < plans.size(); i++){
+		done[i].assign(plans[i].GetOperations().size(), false);
+	}
+	for(size_t i = 0; i < plans.size() && !wxGetApp().GetAbort(); i++){
+		const std::vector<SyncOperation> &operations = plans[i].GetOperations();
+		for(size_t j = 0; j < operations.size() && !wxGetApp().GetAbort(); j++){
+			if(done[i][j]){
+				continue;
+			}
+			if(operations[j].type != SyncCopyFile){
+				runner.Run(operations[j]);
+				continue;
+			}
+			//Take this copy for every destination that needs it now
+			std::vector<wxFileName> dests;
+			const CopyTargets &targets = copies[operations[j].source];
+			for(CopyTargets::const_iterator iter = targets.begin(); iter != targets.end(); ++iter){
+				if(!done[iter->first][iter->second]){
+					done[iter->first][iter->second] = true;
+					dests.push_back(wxFileName::FileName(plans[iter->first].GetOperations()[iter->second].dest));
+				}
+			}
+			runner.RunCopy(wxFileName::FileName(operations[j].source), dests);
+		}
+	}
+	runner.Commit();
+	for(size_t i = 0; i < m_Datas.size(); i++){
+		PruneVersions(m_Datas[i]);
+	}
+	return NULL;
+}
+
+SyncFiles::SyncFiles(const wxFileName &syncsource, const wxFileName &syncdest, SyncData* syncdata, 
+                     SyncRunner *syncrunner, SyncPlan *syncplan, SyncJournal *syncjournal, SyncBaseline *syncbaseline) 
+          : SyncBase(syncsource, syncdest, syncdata), runner(syncrunner), plan(syncplan), journal(syncjournal), baseline(syncbaseline), 
+            current(PathArena::Root), casesensitive(wxFileName::IsCaseSensitive()), 
+            spillthreshold(wxGetApp().m_Settings->GetSpillThreshold()), sourcestate(NULL), deststate(NULL)
 {
-    Path::CreateDirectoryPath(sourceroot);
-    Path::CreateDirectoryPath(destroot);
+	if(!data->GetAgent().IsEmpty()){
+		agent.reset(new SyncAgent);
+		if(agent->Start(data->GetAgent())){
+			agentroot = data->GetAgentRoot().IsEmpty() ? destroot.GetPathWithSep() : data->GetAgentRoot();
+			if(!agentroot.EndsWith(wxString(wxFILE_SEP_PATH))){
+				agentroot += wxFILE_SEP_PATH;
+			}
+		}
+		else{
+			OutputProgress(_("Could not start the agent, reading the destination directly"), Error);
+			agent.reset();
+		}
+	}
+	//Only the size and time checks use what the listing can tell us
+	long threads = wxGetApp().m_Settings->GetStatThreads();
+	if(threads > 0 && (checks & (SyncCheckSize | SyncCheckTime))){
+		prefetcher.reset(new StatPrefetcher(threads));
+	}
 }
 
-bool SyncFiles::Execute(){
-	auto sourcepaths = FolderContentsToList(sourceroot);
-	auto destpaths = FolderContentsToList(destroot);
-	auto mergeresult = MergeListsToMap(sourcepaths, destpaths);
-	OperationCaller(mergeresult);
+//Both sides of a folder too big to sort in memory, merged a name at a time
+class SpilledFolder{
+public:
+	SpilledFolder(size_t budget, bool sensitive) 
+	    : source(budget, sensitive), dest(budget, sensitive), casesensitive(sensitive), hassource(false), hasdest(false)
+	{}
+
+	SpillSorter& Get(Location location){
+		return location == Dest ? dest : source;
+	}
+
+	void Finish(){
+		source.Finish();
+		dest.Finish();
+		hassource = source.Next(sourcename);
+		hasdest = dest.Next(destname);
+	}
+
+	bool Next(wxString &name, Location &location){
+		if(!hassource && !hasdest){
+			return false;
+		}
+		int res = !hasdest ? -1 : (!hassource ? 1 : SpillSorter::Compare(sourcename, destname, casesensitive));
+		if(res < 0){
+			name = sourcename;
+			location = Source;
+			hassource = source.Next(sourcename);
+		}
+		else if(res > 0){
+			name = destname;
+			location = Dest;
+			hasdest = dest.Next(destname);
+		}
+		else{
+			name = sourcename;
+			location = SourceAndDest;
+			hassource = source.Next(sourcename);
+			hasdest = dest.Next(destname);
+		}
+		return true;
+	}
+
+	bool IsFailed() const {
+		return source.IsFailed() || dest.IsFailed();
+	}
+
+private:
+	SpillSorter source;
+	SpillSorter dest;
+	bool casesensitive;
+	wxString sourcename;
+	wxString destname;
+	bool hassource;
+	bool hasdest;
+};
+
+namespace{
+	//Files at least this big can be carried on with after being stopped
+	const unsigned long long resumesize = 64 * 1024 * 1024;
+
+	//Records the progress of a large copy in the journal
+	class JournalCheckpoint : public CopyCheckpoint{
+	public:
+		JournalCheckpoint(SyncJournal *syncjournal, const wxString &destpath, const FileState &sourcestate)
+		    : journal(syncjournal), dest(destpath), source(sourcestate)
+		{}
+
+		virtual void Checkpoint(long long offset){
+			journal->Checkpoint(dest, source, offset);
+		}
+
+	private:
+		SyncJournal *journal;
+		wxString dest;
+		FileState source;
+	};
+
+	//The tag of an arena entry is where it was found and what it is
+	const int LocationMask = 3;
+	const int FolderFlag = 4;
+	const int UnknownFlag = 8;
+	//What we know about the entry is in sourcestates or deststates
+	const int SourceStateFlag = 16;
+	const int DestStateFlag = 32;
+	//Folders with fewer files than this are quicker to look at one by one
+	const size_t prefetchminimum = 4;
+
+	//Orders the entries of a folder by name, source entries first when a 
+	//name is in both so they can be merged
+	struct NameLess{
+		const PathArena &arena;
+		bool casesensitive;
+
+		NameLess(const PathArena &patharena, bool sensitive) : arena(patharena), casesensitive(sensitive)
+		{}
+
+		bool operator()(PathArena::Node first, PathArena::Node second) const {
+			int res = arena.Compare(first, second, casesensitive);
+			return res != 0 ? res < 0 : first < second;
+		}
+	};
+}
+
+bool SyncFiles::Start(){
+	//A request to the agent can take a while, such as hashing a large file,
+	//so stopping the job stops the agent
+	std::unique_ptr<CancelCallback> interrupt;
+	if(agent){
+		SyncAgent *running = agent.get();
+		interrupt.reset(new CancelCallback(wxGetApp().GetCancel(), [running](){running->Interrupt();}));
+	}
+	Emit(SyncEnterFolder, sourceroot, destroot);
+	Push(PathArena::Root, sourceroot.GetPathWithSep(), destroot.GetPathWithSep(), 
+	     PathArena::ToNative(sourceroot.GetPathWithSep()), PathArena::ToNative(destroot.GetPathWithSep()), false, 0);
+	while(!frames.empty()){
+		//Pushing a folder can move the frame so it isn't used after Visit
+		Frame &frame = frames.back();
+		if(frame.spilled){
+			//Only the entry we are on is kept in the arena, and only until 
+			//we are done with it
+			arena.Release(frame.mark);
+			wxString name;
+			Location location;
+			if(wxGetApp().GetAbort() || !frame.spilled->Next(name, location)){
+				Pop();
+				continue;
+			}
+			current = arena.Add(frame.node, name, location | UnknownFlag);
+			Visit(frame);
+			continue;
+		}
+		if(frame.next == frame.end || wxGetApp().GetAbort()){
+			Pop();
+			continue;
+		}
+		current = order[frame.next++];
+		Visit(frame);
+	}
+	return true;
+}
+
+void SyncFiles::Visit(const Frame &frame){
+	int tag = arena.GetTag(current);
+	Location location = static_cast<Location>(tag & LocationMask);
+	EntryKind kind = (tag & FolderFlag) ? EntryFolder : ((tag & UnknownFlag) ? EntryUnknown : EntryFile);
+
+	//Reuse the same buffers for every entry
+	nativesource.assign(frame.nativesource);
+	arena.AppendName(current, nativesource);
+	nativedest.assign(frame.nativedest);
+	arena.AppendName(current, nativedest);
+
+	//What the listing told us saves asking the filesystem later
+	sourcestate = deststate = NULL;
+	if(kind == EntryFile){
+		if(location == Source){
+			deststate = &missing;
+		}
+		else if(location == Dest){
+			sourcestate = &missing;
+		}
+		else if(checks & (SyncCheckSize | SyncCheckTime)){
+			currentsource = (tag & SourceStateFlag) ? sourcestates[current] : FileState::Get(nativesource);
+			currentdest = (tag & DestStateFlag) ? deststates[current] : FileState::Get(nativedest);
+			sourcestate = &currentsource;
+			deststate = &currentdest;
+		}
+	}
+
+	//Rules and the rest of the sync work with wxStrings so this is where we 
+	//convert, once per entry
+	wxString name = arena.GetName(current);
+	//Old versions are kept out of the sync whether or not this job keeps them
+	if(frame.node == PathArena::Root && SyncVersions::IsVersionsFolder(name)){
+		return;
+	}
+	Dispatch(frame.source + name, frame.dest + name, location, kind);
+}
+
+void SyncFiles::Push(PathArena::Node node, const wxString &source, const wxString &dest, 
+                     const PathArena::NativeString &nativesourcepath, const PathArena::NativeString &nativedestpath,
+                     bool leave, int flags){
+	Frame frame;
+	frame.node = node;
+	frame.mark = arena.GetMark();
+	frame.source = source;
+	frame.dest = dest;
+	frame.nativesource = nativesourcepath;
+	frame.nativedest = nativedestpath;
+	frame.leave = leave;
+	frame.flags = flags;
+	frame.failures = runner ? runner->GetFailures() : 0;
+
+	ReadFolder(source, nativesourcepath, node, Source, frame);
+	if(!agent || !agent->IsOk() || !ReadRemoteFolder(dest, node, frame)){
+		ReadFolder(dest, nativedestpath, node, Dest, frame);
+	}
+
+	if(frame.spilled){
+		frame.spilled->Finish();
+		if(frame.spilled->IsFailed()){
+			OutputProgress(_("Could not write temporary files, sorting in memory ") + source, Error);
+		}
+		frame.next = frame.end = order.size();
+		frames.push_back(frame);
+		return;
+	}
+
+	//Sort the new entries and merge any name that is in both folders
+	size_t begin = order.size();
+	for(PathArena::Node i = frame.mark; i < arena.GetMark(); i++){
+		order.push_back(i);
+	}
+	std::sort(order.begin() + begin, order.end(), NameLess(arena, casesensitive));
+	size_t end = begin;
+	for(size_t i = begin; i < order.size(); i++){
+		int previous = end > begin ? arena.GetTag(order[end - 1]) : 0;
+		int tag = arena.GetTag(order[i]);
+		if(end > begin && (previous & LocationMask) == Source && (tag & LocationMask) == Dest
+		&& arena.Compare(order[end - 1], order[i], casesensitive) == 0){
+			arena.SetTag(order[end - 1], SourceAndDest | ((previous | tag) & ~LocationMask));
+			if(tag & DestStateFlag){
+				deststates[order[end - 1]] = deststates[order[i]];
+			}
+		}
+		else{
+			order[end++] = order[i];
+		}
+	}
+	order.resize(end);
+	frame.next = begin;
+	frame.end = end;
+	Prefetch(frame);
+	frames.push_back(frame);
+}
+
+void SyncFiles::Prefetch(const Frame &frame){
+	if(!prefetcher){
+		return;
+	}
+	//Only files on both sides need looking at, the rest are missing on one
+	std::vector<PathArena::Node> nodes;
+	std::vector<PathArena::NativeString> paths;
+	for(size_t i = frame.next; i < frame.end; i++){
+		int tag = arena.GetTag(order[i]);
+		if((tag & LocationMask) == SourceAndDest && !(tag & (FolderFlag | UnknownFlag))){
+			nodes.push_back(order[i]);
+		}
+	}
+	if(nodes.size() < prefetchminimum){
+		return;
+	}
+	for(std::vector<PathArena::Node>::const_iterator iter = nodes.begin(); iter != nodes.end(); ++iter){
+		paths.push_back(frame.nativesource);
+		arena.AppendName(*iter, paths.back());
+		if(!(arena.GetTag(*iter) & DestStateFlag)){
+			paths.push_back(frame.nativedest);
+			arena.AppendName(*iter, paths.back());
+		}
+	}
+	std::vector<FileState> states;
+	prefetcher->Get(paths, states);
+	if(sourcestates.size() < arena.GetMark()){
+		sourcestates.resize(arena.GetMark());
+		deststates.resize(arena.GetMark());
+	}
+	size_t next = 0;
+	for(std::vector<PathArena::Node>::const_iterator iter = nodes.begin(); iter != nodes.end(); ++iter){
+		int tag = arena.GetTag(*iter);
+		sourcestates[*iter] = states[next++];
+		if(!(tag & DestStateFlag)){
+			deststates[*iter] = states[next++];
+		}
+		arena.SetTag(*iter, tag | SourceStateFlag | DestStateFlag);
+	}
+}
+
+void SyncFiles::Pop(){
+	Frame frame = frames.back();
+	frames.pop_back();
+	//The whole subtree is done with so give back its names
+	order.resize(frames.empty() ? 0 : frames.back().end);
+	arena.Release(frame.mark);
+	if(frame.leave){
+		Emit(SyncLeaveFolder, wxFileName::DirName(frame.source), wxFileName::DirName(frame.dest), frame.flags);
+	}
+	if(journal && runner && !wxGetApp().GetAbort() && runner->GetFailures() == frame.failures){
+		journal->Done(frame.source, frame.dest);
+		runner->Finished();
+	}
+}
+
+void SyncFiles::ReadFolder(const wxString &path, const PathArena::NativeString &nativepath, 
+                           PathArena::Node parent, Location location, Frame &frame){
+#ifdef __WXMSW__
+	wxUnusedVar(nativepath);
+	if(!wxDirExists(path)){
+		return;
+	}
+	wxDir dir(path);
+	if(!dir.IsOpened()){
+		return;
+	}
+	wxString filename;
+	if(dir.GetFirst(&filename)){
+		do{
+			AddEntry(filename.wc_str(), filename.length(), parent, location | UnknownFlag, frame);
+		}
+		while(dir.GetNext(&filename));
+	}
+#else
+	wxUnusedVar(path);
+	//Read the names as they are, the type saves checking for folders later
+	DIR *dir = opendir(nativepath.c_str());
+	if(!dir){
+		return;
+	}
+	struct dirent *entry;
+	while((entry = readdir(dir)) != NULL){
+		const char *name = entry->d_name;
+		if(name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))){
+			continue;
+		}
+		int tag = location;
+	#ifdef _DIRENT_HAVE_D_TYPE
+		if(entry->d_type == DT_DIR){
+			tag |= FolderFlag;
+		}
+		//Links may point at folders so we have to look
+		else if(entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK){
+			tag |= UnknownFlag;
+		}
+	#else
+		tag |= UnknownFlag;
+	#endif
+		AddEntry(name, strlen(name), parent, tag, frame);
+	}
+	closedir(dir);
+#endif
+}
+
+bool SyncFiles::ReadRemoteFolder(const wxString &path, PathArena::Node parent, Frame &frame){
+	std::vector<SyncAgent::Entry> entries;
+	if(!agent->List(GetRemotePath(path), entries)){
+		//A folder that isn't there yet is fine, a missing agent isn't
+		if(agent->IsOk()){
+			return true;
+		}
+		//We stopped it ourselves if the job was stopped. It is kept around as
+		//the cancel callback may still be using it
+		if(!wxGetApp().GetAbort()){
+			OutputProgress(_("Lost the agent, reading the destination directly"), Error);
+		}
+		return false;
+	}
+	for(std::vector<SyncAgent::Entry>::const_iterator iter = entries.begin(); iter != entries.end(); ++iter){
+		PathArena::NativeString name = PathArena::ToNative(iter->name);
+		int tag = Dest | (iter->folder ? FolderFlag : DestStateFlag);
+		AddEntry(name.c_str(), name.length(), parent, tag, frame);
+		//Spilled entries are looked at directly when we get to them
+		if(!frame.spilled && !iter->folder){
+			PathArena::Node node = arena.GetMark() - 1;
+			if(deststates.size() <= node){
+				deststates.resize(node + 1);
+			}
+			deststates[node].exists = true;
+			deststates[node].size = iter->size;
+			deststates[node].modified = iter->modified;
+		}
+	}
 	return true;
 }
 
+wxString SyncFiles::GetRemotePath(const wxString &path) const{
+	wxString root = destroot.GetPathWithSep();
+	if(!path.StartsWith(root)){
+		return path;
+	}
+	wxString remote = agentroot + path.Mid(root.length());
+#ifdef __WXMSW__
+	//The agent only runs on something posix
+	remote.Replace("\\", "/");
+#endif
+	return remote;
+}
+
+void SyncFiles::HashRemote(const wxFileName &local, const wxFileName &remote){
+	unsigned long long remotehash, localhash;
+	if(!HashCache::Recall(remote, remotehash)){
+		FileIdentity identity = FileIdentity::Get(remote);
+		if(!agent->Hash(GetRemotePath(remote.GetFullPath()), 0, remotehash)){
+			return;
+		}
+		HashCache::Remember(remote, identity, remotehash);
+	}
+	if(!HashCache::Recall(local, localhash)){
+		//Taken before reading so a file changed while we do isn't trusted
+		FileIdentity identity = FileIdentity::Get(local);
+		if(ContentHash::File(local.GetFullPath(), localhash, false, &wxGetApp().GetCancel())){
+			HashCache::Remember(local, identity, localhash);
+		}
+	}
+}
+
+void SyncFiles::AddEntry(const PathArena::Char *name, size_t length, PathArena::Node parent, int tag, Frame &frame){
+	if(frame.spilled){
+		frame.spilled->Get(static_cast<Location>(tag & LocationMask)).Add(PathArena::ToString(name, length));
+	}
+	else{
+		arena.Add(parent, name, length, tag);
+		if(spillthreshold > 0 && arena.GetMark() - frame.mark > spillthreshold){
+			Spill(frame);
+		}
+	}
+}
+
+void SyncFiles::Spill(Frame &frame){
+	//Move what we have so far out of the arena, from now on both sides go
+	//straight to the sorters
+	frame.spilled.reset(new SpilledFolder(spillthreshold, casesensitive));
+	for(PathArena::Node i = frame.mark; i < arena.GetMark(); i++){
+		frame.spilled->Get(static_cast<Location>(arena.GetTag(i) & LocationMask)).Add(arena.GetName(i));
+	}
+	arena.Release(frame.mark);
+}
+
+void SyncFiles::Descend(const wxFileName &source, const wxFileName &dest, bool leave, int flags){
+	if(journal && journal->IsDone(dest.GetPathWithSep())){
+		return;
+	}
+	Emit(SyncEnterFolder, source, dest);
+	Push(current, source.GetPathWithSep(), dest.GetPathWithSep(), 
+	     nativesource + PathArena::Char(wxFILE_SEP_PATH), nativedest + PathArena::Char(wxFILE_SEP_PATH), leave, flags);
+}
+
+void SyncFiles::Emit(SyncOperationType type, const wxFileName &source, const wxFileName &dest, int flags){
+	SyncOperation operation;
+	operation.type = type;
+	operation.source = source.GetFullPath();
+	operation.dest = dest.GetFullPath();
+	operation.flags = flags;
+	if(plan){
+		//We only need the state of the files if we are going to check them later
+		if(type != SyncEnterFolder && type != SyncLeaveFolder){
+			operation.sourcestate = FileState::Get(source);
+			operation.deststate = FileState::Get(dest);
+		}
+		plan->Add(operation);
+	}
+	if(runner){
+		runner->Run(operation);
+	}
+}
+
 void SyncFiles::OnSourceNotDestFile(const wxFileName &source, const wxFileName &dest){
 	//Clean doesnt copy any files
-	if(data->GetFunction() != _("Clean")){
+	if(function != SyncClean){
 		if(data->GetRules()->Matches(source) != Excluded){
-			if(CopyIfNeeded(source, dest)){
-				if(data->GetFunction() == _("Move")){
-					RemoveFile(source);
-				}
-			}	
+			CopyIfNeeded(source, dest, function == SyncMove ? SyncMoveSource : 0);
 		}	
 	}
 }
 
 void SyncFiles::OnNotSourceDestFile(const wxFileName &source, const wxFileName &dest){
-	if(data->GetFunction() == _("Mirror") || data->GetFunction() == _("Clean")){
+	//Unfinished copies are picked up along with the file they belong to
+	if(journal && SyncJournal::IsPartial(dest.GetFullPath())){
+		return;
+	}
+	if(function == SyncMirror || function == SyncClean){
 		if(data->GetRules()->Matches(dest) != Excluded){
-			RemoveFile(dest);	
+			Emit(SyncRemoveFile, source, dest);
 		}
 	}
-	else if(data->GetFunction() == _("Equalise")){
+	else if(function == SyncEqualise){
 		if(data->GetRules()->Matches(dest) != Excluded){
-			CopyIfNeeded(dest, source);
+			CopyIfNeeded(dest, source, 0, true);
 		}
 	}
 }
 
 void SyncFiles::OnSourceAndDestFile(const wxFileName &source, const wxFileName &dest){
-	if(data->GetFunction() == _("Copy") || data->GetFunction() == _("Mirror") || data->GetFunction() == _("Move")){
+	if(function == SyncCopy || function == SyncMirror || function == SyncMove){
 		if(data->GetRules()->Matches(source) != Excluded){
-			if(CopyIfNeeded(source, dest)){
-				if(data->GetFunction() == _("Move")){
-					RemoveFile(source);
-				}				
-			}
+			CopyIfNeeded(source, dest, function == SyncMove ? SyncMoveSource : 0);
 		}
 	}	
-	else if(data->GetFunction() == _("Equalise")){
+	else if(function == SyncEqualise){
 		SourceAndDestCopy(source, dest);
 	}
 }
@@ -90,154 +767,424 @@ void SyncFiles::OnSourceNotDestFolder(const wxFileName &source, const wxFileName
 	//Always recurse into the next directory unless we have an absolute exclude
     RuleResult res = data->GetRules()->Matches(source);
     if(res != AbsoluteExcluded){
-	    SyncFiles sync(source, dest, data);
-	    sync.Execute();
-        if(data->GetFunction() != _("Clean")){
-		    wxDir destdir(dest.GetFullPath());
-		    wxDir sourcedir(source.GetFullPath());
-		    if(!destdir.HasFiles() && !destdir.HasSubDirs() && res == Excluded){
-			    DeleteDirectory(dest);
-		    }
-		    else{
-			    //Set the timestamps if needed
-			    if(data->GetTimeStamps()){
-				    CopyFolderTimestamp(source, dest);
-			    }	
-		    }
-		    if(!sourcedir.HasFiles() && !sourcedir.HasSubDirs() && data->GetFunction() == _("Move")){
-			    //If we are moving and there are no files left then we need to remove the folder
-			    DeleteDirectory(source);
-		    }
-	    }
+        int flags = 0;
+        if(res == Excluded){
+            flags |= SyncRemoveDestIfEmpty;
+        }
+        //Set the timestamps if needed
+        if(data->GetTimeStamps()){
+            flags |= SyncCopyTimes;
+        }
+        //If we are moving and there are no files left then we need to remove the folder
+        if(function == SyncMove){
+            flags |= SyncRemoveSourceIfEmpty;
+        }
+        Descend(source, dest, function != SyncClean, flags);
     }
 }
 
 void SyncFiles::OnNotSourceDestFolder(const wxFileName &source, const wxFileName &dest){
     RuleResult res = data->GetRules()->Matches(dest);
-	if(data->GetFunction() == _("Mirror") || data->GetFunction() == _("Clean")){
+	if(function == SyncMirror || function == SyncClean){
 		if(res != Excluded && res != AbsoluteExcluded){
-			DeleteDirectory(dest);		
+			Emit(SyncRemoveFolder, source, dest);
 		}
 	}
-	else if(data->GetFunction() == _("Equalise")){
+	else if(function == SyncEqualise){
+        //Set the timestamps if needed
         if(res != AbsoluteExcluded){
-		    SyncFiles sync(source, dest, data);
-		    sync.Execute();
+		    Descend(source, dest, data->GetTimeStamps(), SyncCopyTimesReverse);
         }
-        //Set the timestamps if needed
-		if(data->GetTimeStamps()){
-			CopyFolderTimestamp(dest, source);
+		else if(data->GetTimeStamps()){
+			Emit(SyncLeaveFolder, source, dest, SyncCopyTimesReverse);
 		}	
 	}
 }
 
 void SyncFiles::OnSourceAndDestFolder(const wxFileName &source, const wxFileName &dest){
-	//Always recurse into the next directory
     RuleResult res = data->GetRules()->Matches(source);
+	int flags = 0;
+	if(res != Excluded && res != AbsoluteExcluded){
+		flags |= SyncRemoveDestIfEmpty;
+	}
+	//Set the timestamps if needed
+	if(data->GetTimeStamps()){
+		flags |= SyncCopyTimes;
+	}
+	//If we are moving and there are no files left then we need to remove the folder
+	if(function == SyncMove){
+		flags |= SyncRemoveSourceIfEmpty;
+	}
+	//Always recurse into the next directory
     if(res != AbsoluteExcluded){
-	    SyncFiles sync(source, dest, data);
-	    sync.Execute();
+	    Descend(source, dest, function != SyncClean, flags);
     }
-	if(data->GetFunction() != _("Clean")){
-		wxDir destdir(dest.GetFullPath());
-		wxDir sourcedir(source.GetFullPath());
-		if(!destdir.HasFiles() && !destdir.HasSubDirs() && res != Excluded && res != AbsoluteExcluded){
-			DeleteDirectory(dest);
+	else if(function != SyncClean){
+		Emit(SyncLeaveFolder, source, dest, flags);
+	}
+}
+
+void SyncFiles::CopyIfNeeded(const wxFileName &source, const wxFileName &dest, int flags, bool reverse){
+	const FileState *from = reverse ? deststate : sourcestate;
+	const FileState *to = reverse ? sourcestate : deststate;
+	//Let the agent read its side of the comparison where the data is
+	if(agent && agent->IsOk() && (checks & SyncCheckFull) && from && to && from->exists && to->exists && from->size == to->size){
+		HashRemote(reverse ? dest : source, reverse ? source : dest);
+	}
+	Emit(ShouldCopy(source, dest, checks, comparer, from, to) ? SyncCopyFile : SyncSkipFile, source, dest, flags);
+}
+
+void SyncFiles::CopyChanged(const wxFileName &source, const wxFileName &dest, const FileState &from, const FileState &to, bool reverse){
+	if(agent && agent->IsOk() && (checks & SyncCheckFull) && from.exists && to.exists && from.size == to.size){
+		HashRemote(reverse ? dest : source, reverse ? source : dest);
+	}
+	Emit(baseline->ShouldCopy(source, dest, from, to) ? SyncCopyFile : SyncSkipFile, source, dest);
+}
+
+void SyncFiles::SourceAndDestCopy(const wxFileName &source, const wxFileName &dest){
+	//Only a side that has changed since the last run is copied from, which 
+	//needs nothing more than the states we already have
+	if(baseline){
+		FileState sourcenow = sourcestate ? *sourcestate : FileState::Get(source);
+		FileState destnow = deststate ? *deststate : FileState::Get(dest);
+		SyncBaseline::Changes changes = baseline->GetChanges(source, sourcenow, destnow);
+		if(changes == SyncBaseline::Unchanged){
+			baseline->Keep(source, sourcenow, destnow);
+			return;
 		}
-		else{
-			//Set the timestamps if needed
-			if(data->GetTimeStamps()){
-				CopyFolderTimestamp(source, dest);
-			}	
+		else if(changes == SyncBaseline::SourceChanged){
+			if(data->GetRules()->Matches(source) != Excluded){
+				CopyChanged(source, dest, sourcenow, destnow);
+			}
+			return;
+		}
+		else if(changes == SyncBaseline::DestChanged){
+			if(data->GetRules()->Matches(source) != Excluded){
+				CopyChanged(dest, source, destnow, sourcenow, true);
+			}
+			return;
+		}
+		//Changed on both sides or not seen before, so the newer one wins. With
+		//nothing to pick between them they are only the same if their contents
+		//are
+		if(sourcenow.modified == destnow.modified && sourcenow.size == destnow.size){
+			if((checks & SyncCheckFull) && !ShouldCopyFull(source, dest)){
+				baseline->Synced(source, dest);
+			}
+			return;
+		}
+	}
+
+	wxDateTime to, from;
+	dest.GetTimes(NULL, &to, NULL);
+	source.GetTimes(NULL, &from, NULL);		
+
+	from.MakeTimezone(wxDateTime::UTC, true);
+	to.MakeTimezone(wxDateTime::UTC, true);
+
+	if(from.IsLaterThan(to)){
+		if(data->GetRules()->Matches(source) != Excluded){
+			CopyIfNeeded(source, dest);			
+		}
+	}
+	else if(to.IsLaterThan(from)){
+		if(data->GetRules()->Matches(source) != Excluded){
+			CopyIfNeeded(dest, source, 0, true);
+		}
+	}
+}
+
+SyncRunner::SyncRunner(SyncData *syncdata, WriteBarrier *syncbarrier, SyncJournal *syncjournal, SyncBaseline *syncbaseline) 
+           : data(syncdata), barrier(syncbarrier), journal(syncjournal), baseline(syncbaseline), revalidate(false), failures(0){
+	if(data->GetVersions()){
+		AddVersions(data->GetDest());
+	}
+}
+
+bool SyncRunner::Commit(){
+	bool ok = barrier->Commit();
+	if(journal){
+		journal->Flushed(ok);
+	}
+	if(ok){
+		return true;
+	}
+	OutputProgress(_("Failed to flush what was written to ") + data->GetDest().GetFullPath(), Error);
+	failures++;
+	return false;
+}
+
+void SyncRunner::Finished(){
+	if(journal && barrier->IsFlushed()){
+		journal->Flushed(true);
+	}
+}
+
+void SyncRunner::AddVersions(const wxFileName &destroot){
+	versions.push_back(SyncVersions(destroot));
+}
+
+const SyncVersions* SyncRunner::GetVersions(const wxFileName &path) const{
+	for(std::vector<SyncVersions>::const_iterator iter = versions.begin(); iter != versions.end(); ++iter){
+		if(iter->Contains(path)){
+			return &*iter;
+		}
+	}
+	return NULL;
+}
+
+void SyncRunner::Run(const SyncPlan &plan){
+	revalidate = true;
+	const std::vector<SyncOperation> &operations = plan.GetOperations();
+	for(std::vector<SyncOperation>::const_iterator iter = operations.begin(); iter != operations.end(); ++iter){
+		if(wxGetApp().GetAbort()){
+			break;
+		}
+		Run(*iter);
+	}
+	revalidate = false;
+}
+
+void SyncRunner::Run(const SyncOperation &operation){
+	const wxFileName source = (operation.type == SyncCopyFile || operation.type == SyncSkipFile || operation.type == SyncRemoveFile) 
+	                          ? wxFileName::FileName(operation.source) : wxFileName::DirName(operation.source);
+	const wxFileName dest = (operation.type == SyncCopyFile || operation.type == SyncSkipFile || operation.type == SyncRemoveFile) 
+	                        ? wxFileName::FileName(operation.dest) : wxFileName::DirName(operation.dest);
+	switch(operation.type){
+		case SyncCopyFile:
+		case SyncSkipFile:{
+			bool copy = operation.type == SyncCopyFile;
+			//If anything changed since the plan was made then decide again
+			if(revalidate && (FileState::Get(source) != operation.sourcestate || FileState::Get(dest) != operation.deststate)){
+				copy = SyncBase::ShouldCopy(source, dest, data);
+			}
+			if(!copy){
+				Skip(source);
+			}
+			else if(!CopyFile(source, dest)){
+				failures++;
+				break;
+			}
+			else if((operation.flags & SyncMoveSource) && !RemoveFile(source)){
+				failures++;
+				break;
+			}
+			//Both sides are now the same as far as the next equalise is concerned,
+			//but a skip only shows that if the contents were compared
+			if(baseline && (copy || (data->GetChecks() & SyncCheckFull))){
+				baseline->Synced(source, dest);
+			}
+			break;
 		}
-		if(!sourcedir.HasFiles() && !sourcedir.HasSubDirs() && data->GetFunction() == _("Move")){
-			//If we are moving and there are no files left then we need to remove the folder
-			DeleteDirectory(source);
+		case SyncRemoveFile:
+		case SyncRemoveFolder:
+			//Never remove something that has changed since we planned to remove it
+			if(revalidate && FileState::Get(dest) != operation.deststate){
+				OutputProgress(_("Not removing changed ") + operation.dest, Error);
+			}
+			else if(operation.type == SyncRemoveFile){
+				if(!RemoveFile(dest)){
+					failures++;
+				}
+			}
+			else{
+				DeleteDirectory(dest);
+			}
+			break;
+		case SyncEnterFolder:
+			folders.Create(source);
+			folders.Create(dest);
+			break;
+		case SyncLeaveFolder:{
+			if(operation.flags & (SyncRemoveDestIfEmpty | SyncCopyTimes)){
+				wxDir destdir(dest.GetFullPath());
+				if((operation.flags & SyncRemoveDestIfEmpty) && !destdir.HasFiles() && !destdir.HasSubDirs()){
+					DeleteDirectory(dest);
+				}
+				else if(operation.flags & SyncCopyTimes){
+					CopyFolderTimestamp(source, dest);
+				}
+			}
+			if(operation.flags & SyncCopyTimesReverse){
+				CopyFolderTimestamp(dest, source);
+			}
+			if(operation.flags & SyncRemoveSourceIfEmpty){
+				wxDir sourcedir(source.GetFullPath());
+				if(!sourcedir.HasFiles() && !sourcedir.HasSubDirs()){
+					DeleteDirectory(source);
+				}
+			}
+			break;
 		}
 	}
 }
 
-bool SyncFiles::CopyFile(const wxFileName &source, const wxFileName &dest){
-    wxString sourcepath = source.GetFullPath(), destpath = dest.GetFullPath();
+void SyncRunner::RunCopy(const wxFileName &source, const std::vector<wxFileName> &dests){
+	//The folders of the other destinations may not have been entered yet
+	for(std::vector<wxFileName>::const_iterator iter = dests.begin(); iter != dests.end(); ++iter){
+		folders.Create(wxFileName::DirName(iter->GetPath()));
+	}
+	failures += dests.size() - CopyFile(source, dests);
+}
+
+void SyncRunner::Skip(const wxFileName &source){
+    wxULongLong size = source.GetSize();
+    if(!data->GetNoSkipped()) {
+        OutputEvent(EventSkip, source.GetFullPath(), 0, size != wxInvalidSize ? size.GetValue() : 0);
+    }
+    //Skipped files still count towards the total so the estimate needs them
+    if(size != wxInvalidSize){
+        Progress::SkipBytes(size.GetValue());
+    }
+}
+
+bool SyncRunner::CopyFile(const wxFileName &source, const wxFileName &dest){
+	std::vector<wxFileName> dests(1, dest);
+	return CopyFile(source, dests) == 1;
+}
+
+size_t SyncRunner::CopyFile(const wxFileName &source, const std::vector<wxFileName> &dests){
+    wxString sourcepath = source.GetFullPath();
 	//ATTN : Needs linux support
 	#ifdef __WXMSW__
-		long destAttributes = 0;
 		long sourceAttributes = 0;
+		std::vector<long> destAttributes(dests.size(), 0);
 		if(data->GetIgnoreRO() || data->GetAttributes()){
-				destAttributes = dest.FileExists() ? GetFileAttributes(destpath.fn_str()) : FILE_ATTRIBUTE_NORMAL;
 				sourceAttributes = source.FileExists() ? GetFileAttributes(sourcepath.fn_str()) : FILE_ATTRIBUTE_NORMAL;
+				for(size_t i = 0; i < dests.size(); i++){
+					destAttributes[i] = dests[i].FileExists() ? GetFileAttributes(dests[i].GetFullPath().fn_str()) : FILE_ATTRIBUTE_NORMAL;
+				}
 		}
 		if(data->GetIgnoreRO()){
-			SetFileAttributes(destpath.fn_str(), FILE_ATTRIBUTE_NORMAL);
+			for(size_t i = 0; i < dests.size(); i++){
+				SetFileAttributes(dests[i].GetFullPath().fn_str(), FILE_ATTRIBUTE_NORMAL);
+			}
 		}
 	#endif
 
-	wxString desttemp = dest.GetPathWithSep() + wxT("Toucan.tmp");
-	if(File::Copy(source, desttemp)){
-		if(File::Rename(desttemp, dest, true)){
-			OutputProgress(_("Copied ") + sourcepath, Message);
+	std::vector<wxFileName> desttemps;
+	for(size_t i = 0; i < dests.size(); i++){
+		desttemps.push_back(wxFileName(dests[i].GetPathWithSep() + wxT("Toucan.tmp")));
+	}
+	bool flush = barrier->GetLevel() == Durability::File;
+	//The hash is worked out as we copy, for checking the copy and for later
+	//full comparisons
+	bool hashed = data->GetVerify() || data->GetCheckFull();
+	unsigned long long hash = 0;
+	int metadata = (data->GetTimeStamps() ? File::KeepTimes : 0) | (data->GetAttributes() ? File::KeepOwner : 0);
+	//Why each destination failed, 0 for those that didn't
+	std::vector<int> errors;
+	//Large files are copied so that they can be carried on with if we are 
+	//stopped, but only when they are going to one place
+	FileState sourcestate = journal ? FileState::Get(source) : FileState();
+	bool resumable = dests.size() == 1 && sourcestate.size >= resumesize;
+	unsigned long long size = journal ? sourcestate.size : FileState::Get(source).size;
+	//The hash is only of the file as it was before we started reading it
+	FileIdentity sourceidentity = hashed ? FileIdentity::Get(source) : FileIdentity();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if(resumable){
+		wxString destpath = dests[0].GetFullPath();
+		desttemps[0] = wxFileName(SyncJournal::GetPartialPath(destpath));
+		JournalCheckpoint checkpoint(journal, destpath, sourcestate);
+		bool resumed = File::Resume(source, desttemps[0], journal->GetOffset(destpath, sourcestate), &checkpoint, flush, hashed ? &hash : NULL, metadata, 
+		                            &wxGetApp().GetCancel()) != 0;
+		errors.assign(1, resumed ? 0 : (wxGetApp().GetAbort() ? -1 : ProgressEvent::LastError()));
+	}
+	else{
+		File::Copy(source, desttemps, errors, flush, hashed ? &hash : NULL, metadata, &wxGetApp().GetCancel());
+	}
+	unsigned long duration = static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+
+	#ifdef __WXMSW__
+		//Elsewhere the times are set on the copy before it is renamed
+		wxDateTime access, mod, created;
+		bool times = data->GetTimeStamps() && source.GetTimes(&access, &mod, &created);
+	#endif
+	size_t copied = 0;
+	for(size_t i = 0; i < dests.size(); i++){
+		wxString destpath = dests[i].GetFullPath();
+		if(errors[i] != 0){
+			OutputEvent(EventCopy, sourcepath, errors[i]);
+			continue;
 		}
-		else{
-			OutputProgress(_("Failed to copy ") + sourcepath, Error);
-			if(wxFileExists(desttemp)){
-				wxRemoveFile(desttemp);
-			}
-			#ifdef __WXMSW__
-				if(data->GetIgnoreRO()){
-					SetFileAttributes(sourcepath, sourceAttributes); 
+		if(data->GetVerify()){
+			//Read back only the copy, from the disk rather than the cache, 
+			//before it replaces anything
+			unsigned long long desthash;
+			bool verified = ContentHash::File(File::GetLongPath(desttemps[i]), desthash, true, &wxGetApp().GetCancel());
+			Throttle::Account(desttemps[i].GetSize().GetValue(), 1);
+			if(!verified || desthash != hash){
+				OutputEvent(EventVerify, destpath, -1);
+				//The file we were replacing is left as it was
+				wxRemoveFile(desttemps[i].GetFullPath());
+				if(resumable){
+					//and a later run starts the copy again from the beginning
+					journal->Copied(destpath);
 				}
-			#endif 
-			return false;
+				continue;
+			}
+		}
+		//The file being replaced is kept by linking it into the versions 
+		//first, it stays in place until the new copy is renamed over it
+		const SyncVersions *keep = GetVersions(dests[i]);
+		wxFileName kept;
+		if(keep && dests[i].FileExists() && !keep->KeepLinked(dests[i], folders, kept)){
+			OutputEvent(EventKeepVersion, destpath, ProgressEvent::LastError());
+			wxRemoveFile(desttemps[i].GetFullPath());
+			continue;
+		}
+		if(!folders.Rename(desttemps[i], dests[i])){
+			OutputEvent(EventCopy, sourcepath, ProgressEvent::LastError());
+			if(desttemps[i].FileExists()){
+				wxRemoveFile(desttemps[i].GetFullPath());
+			}
+			//The old file is still where it was so it doesn't need keeping
+			if(kept.IsOk()){
+				wxRemoveFile(kept.GetFullPath());
+			}
+			continue;
+		}
+		OutputEvent(EventCopy, sourcepath, 0, size, duration);
+		if(resumable){
+			journal->Copied(destpath);
 		}
-	}
-	else{
-        OutputProgress(_("Failed to copy ") + sourcepath, Error);
 		#ifdef __WXMSW__
+			if(times){
+				folders.SetTimes(dests[i], access, mod, created); 
+			}
 			if(data->GetIgnoreRO()){
-				SetFileAttributes(sourcepath.fn_str(), sourceAttributes); 
+				SetFileAttributes(destpath.fn_str(), destAttributes[i]); 
 			} 
+			if(data->GetAttributes()){                   
+				SetFileAttributes(destpath.fn_str(), sourceAttributes);
+			}
 		#endif
-		return false;
-	}
-	if(data->GetTimeStamps()){
-		wxDateTime access, mod, created;
-		if(source.GetTimes(&access, &mod, &created)){
-			dest.SetTimes(&access, &mod, &created); 
+		if(hashed){
+			HashCache::Remember(dests[i], hash);
 		}
-	}	
+		bool written = barrier->Written(dests[i]);
+		if(!written){
+			OutputProgress(_("Failed to flush ") + destpath, Error);
+			failures++;
+		}
+		//The barrier may have committed everything so far on its own
+		if(journal && (!written || barrier->IsFlushed())){
+			journal->Flushed(written);
+		}
+		copied++;
+	}
 	#ifdef __WXMSW__
 		if(data->GetIgnoreRO()){
-			SetFileAttributes(destpath.fn_str(), destAttributes); 
 			SetFileAttributes(sourcepath.fn_str(), sourceAttributes); 
 		} 
-		if(data->GetAttributes()){                   
-			SetFileAttributes(destpath.fn_str(), sourceAttributes);
-		}
 	#endif
-	return true;
-}
-
-bool SyncFiles::CopyIfNeeded(const wxFileName &source, const wxFileName &dest){
-	//If the dest file doesn't exists then we must copy
-	if(!dest.FileExists()){
-        return CopyFile(source, dest);
-	}
-	//If copy if anything says copy
-	if((data->GetCheckSize() && ShouldCopySize(source, dest))
-    || (data->GetCheckTime() && ShouldCopyTime(source, dest))
-    || (data->GetCheckShort() && ShouldCopyShort(source, dest))
-    || (data->GetCheckFull() && ShouldCopyFull(source, dest))
-    || (!data->GetCheckSize() && !data->GetCheckTime() 
-    &&  !data->GetCheckShort() && !data->GetCheckFull())){
-		return CopyFile(source, dest);
+	if(hashed && copied > 0){
+		HashCache::Remember(source, sourceidentity, hash);
 	}
-    if(!data->GetNoSkipped()) {
-        OutputProgress(_("Skipped ") + source.GetFullPath(), Message);
-    }
-	return false;
+	return copied;
 }
 
-bool SyncFiles::DeleteDirectory(const wxFileName &path){
+bool SyncRunner::DeleteDirectory(const wxFileName &path){
 	if(wxGetApp().GetAbort()){
 		return true;
 	}
@@ -257,60 +1204,40 @@ bool SyncFiles::DeleteDirectory(const wxFileName &path){
 				DeleteDirectory(wxFileName::DirName(path.GetFullPath() + filename));
 			}
 			else{
-				if(RemoveFile(wxFileName(path.GetFullPath() + filename))){
-					OutputProgress(_("Removed file ") + path.GetFullPath() + filename, Message);
+				wxString filepath = path.GetFullPath() + filename;
+				if(RemoveFile(wxFileName(filepath))){
+					OutputEvent(EventRemoveFile, filepath);
 				}
 				else{
-					OutputProgress(_("Failed to remove file ") + path.GetFullPath() + filename, Error);
+					OutputEvent(EventRemoveFile, filepath, ProgressEvent::LastError());
+					failures++;
 				}
 			}
 		}
 		while (dir->GetNext(&filename) );
 	} 
 	delete dir;
-	{
-		wxLogNull log;
-		if(wxRmdir(path.GetFullPath())){
-			OutputProgress(_("Removed directory ") + path.GetFullPath(), Message);
-		}
-		else{
-			OutputProgress(_("Failed to remove directory ") + path.GetFullPath(), Error);
-		}
+	if(folders.RemoveFolder(path)){
+		OutputEvent(EventRemoveFolder, path.GetFullPath());
+	}
+	else{
+		OutputEvent(EventRemoveFolder, path.GetFullPath(), ProgressEvent::LastError());
+		failures++;
 	}
 	return true;
 }
 
-bool SyncFiles::CopyFolderTimestamp(const wxFileName &source, const wxFileName &dest){
-	wxDateTime access, mod, created;
-	source.GetTimes(&access, &mod, &created);
-	dest.SetTimes(&access, &mod, &created); 
-	return true;
+bool SyncRunner::CopyFolderTimestamp(const wxFileName &source, const wxFileName &dest){
+	return folders.CopyTimes(source, dest);
 }
 
-bool SyncFiles::RemoveFile(const wxFileName &path){
-	if(File::Delete(path, data->GetRecycle(), data->GetIgnoreRO())){
+bool SyncRunner::RemoveFile(const wxFileName &path){
+	const SyncVersions *keep = GetVersions(path);
+	if(keep){
+		return keep->Keep(path, folders);
+	}
+	if(folders.Remove(path, data->GetRecycle(), data->GetIgnoreRO())){
 		return true;
 	}
 	return false;
 }
-
-bool SyncFiles::SourceAndDestCopy(const wxFileName &source, const wxFileName &dest){
-	wxDateTime to, from;
-	dest.GetTimes(NULL, &to, NULL);
-	source.GetTimes(NULL, &from, NULL);		
-
-	from.MakeTimezone(wxDateTime::UTC, true);
-	to.MakeTimezone(wxDateTime::UTC, true);
-
-	if(from.IsLaterThan(to)){
-		if(data->GetRules()->Matches(source) != Excluded){
-			CopyIfNeeded(source, dest);			
-		}
-	}
-	else if(to.IsLaterThan(from)){
-		if(data->GetRules()->Matches(source) != Excluded){
-			CopyIfNeeded(dest, source);
-		}
-	}
-	return true;	
-}
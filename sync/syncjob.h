@@ -8,23 +8,110 @@
 #define H_SYNCJOB
 
 class SyncData;
+class SpilledFolder;
 #include "../job.h"
 #include "syncbase.h"
+#include "syncplan.h"
+#include "patharena.h"
+#include "syncagent.h"
+#include "statprefetcher.h"
+#include "syncversions.h"
+#include "../fileops.h"
+#include <vector>
+#include <memory>
 #include <wx/string.h>
 
 
 class SyncJob : public Job
 {
 public:
-	SyncJob(SyncData *Data);
+	//If a plan is given then it is run rather than working out what to do,
+	//the caller keeps ownership of it
+	SyncJob(SyncData *Data, SyncPlan *Plan = NULL);
 	virtual void* Entry();
+
+private:
+	SyncPlan *m_Plan;
+};
+
+//Syncs one source to several destinations. Each destination is planned on 
+//its own thread and then the plans are run together, so that a file going to
+//more than one of them is only read once
+class SyncFanOutJob : public Job
+{
+public:
+	//The job owns the data, there is one for each destination
+	SyncFanOutJob(const std::vector<SyncData*> &datas);
+	virtual ~SyncFanOutJob();
+	virtual void* Entry();
+
+private:
+	std::vector<SyncData*> m_Datas;
+};
+
+//Carries out the operations of a sync, either as soon as they are worked out
+//or from a saved plan
+class SyncRunner
+{
+public:
+	SyncRunner(SyncData *syncdata, WriteBarrier *syncbarrier, SyncJournal *syncjournal = NULL, SyncBaseline *syncbaseline = NULL);
+
+	void Run(const SyncOperation &operation);
+	//Runs a saved plan, checking each file is still as it was when planned
+	void Run(const SyncPlan &plan);
+
+	//Copies a file to several places, reading it only once
+	void RunCopy(const wxFileName &source, const std::vector<wxFileName> &dests);
+
+	//How many operations have gone wrong so far
+	const unsigned long& GetFailures() const {return failures;}
+
+	//Makes sure everything written so far is on disk, a failure is reported
+	//and counted
+	bool Commit();
+	//Call once a folder is done in the journal, it is written straight away
+	//if nothing written to the folder still needs flushing, otherwise it 
+	//waits for the barrier to next commit
+	void Finished();
+
+	//Keeps old versions of what is overwritten or removed under another 
+	//destination, for running plans that go to more than one
+	void AddVersions(const wxFileName &destroot);
+
+protected:
+	bool CopyFile(const wxFileName &source, const wxFileName &dest);
+	//Returns how many of the destinations were copied to
+	size_t CopyFile(const wxFileName &source, const std::vector<wxFileName> &dests);
+	bool CopyFolderTimestamp(const wxFileName &source, const wxFileName &dest);
+	bool DeleteDirectory(const wxFileName &path);
+	bool RemoveFile(const wxFileName &path);
+	void Skip(const wxFileName &source);
+	//The versions kept for the path, NULL if it isn't under a versioned destination
+	const SyncVersions* GetVersions(const wxFileName &path) const;
+
+	SyncData *data;
+	WriteBarrier *barrier;
+	SyncJournal *journal;
+	SyncBaseline *baseline;
+	bool revalidate;
+	unsigned long failures;
+	//The folders we have already made and the ones we are working in
+	FolderCache folders;
+	std::vector<SyncVersions> versions;
 };
 
+//Works out what a sync needs to do one folder at a time, handing each 
+//operation to a runner to do straight away and/or a plan to keep. The tree
+//is walked with a stack of folders rather than recursion, with the names 
+//waiting to be visited kept in an arena
 class SyncFiles : public SyncBase
 {
 public:
-	SyncFiles(const wxFileName &syncsource, const wxFileName &syncdest, SyncData* syncdata);
-	bool Execute();
+	SyncFiles(const wxFileName &syncsource, const wxFileName &syncdest, SyncData* syncdata, 
+	          SyncRunner *syncrunner, SyncPlan *syncplan = NULL, SyncJournal *syncjournal = NULL,
+	          SyncBaseline *syncbaseline = NULL);
+	//Syncs from the root folders, making sure they exist first
+	bool Start();
 
 protected:
 	virtual void OnSourceNotDestFile(const wxFileName &source, const wxFileName &dest);
@@ -34,13 +121,87 @@ protected:
 	virtual void OnNotSourceDestFolder(const wxFileName &source, const wxFileName &dest);
 	virtual void OnSourceAndDestFolder(const wxFileName &source, const wxFileName &dest);
 
-	bool CopyIfNeeded(const wxFileName &source, const wxFileName &dest);
-	bool CopyFile(const wxFileName &source, const wxFileName &dest);
-	bool CopyFolderTimestamp(const wxFileName &source, const wxFileName &dest);
-	bool SourceAndDestCopy(const wxFileName &source, const wxFileName &dest);
+	//Reverse is set when copying from the dest side of the entry to the source
+	void CopyIfNeeded(const wxFileName &source, const wxFileName &dest, int flags = 0, bool reverse = false);
+	//Copies a file the baseline says has only changed on the source side of
+	//the call, whatever the times say
+	void CopyChanged(const wxFileName &source, const wxFileName &dest, const FileState &from, const FileState &to, 
+	                 bool reverse = false);
+	void SourceAndDestCopy(const wxFileName &source, const wxFileName &dest);
+	//Syncs the contents of a folder once the current one is done with, then
+	//leaves it with the given flags if needed
+	void Descend(const wxFileName &source, const wxFileName &dest, bool leave = false, int flags = 0);
+	void Emit(SyncOperationType type, const wxFileName &source, const wxFileName &dest, int flags = 0);
+	//Where a path under the destination is as far as the agent is concerned
+	wxString GetRemotePath(const wxString &path) const;
+	//Has the agent hash its side of a full comparison so it isn't read here
+	void HashRemote(const wxFileName &local, const wxFileName &remote);
 
-	bool DeleteDirectory(const wxFileName &path);
-	bool RemoveFile(const wxFileName &path);
+	SyncRunner *runner;
+	SyncPlan *plan;
+	//Folders finished by an earlier run are skipped
+	SyncJournal *journal;
+	//Decides which way an equalise copies when there is one
+	SyncBaseline *baseline;
+
+private:
+	struct Frame{
+		PathArena::Node node;
+		//Everything from here on in the arena belongs to this folder
+		PathArena::Node mark;
+		//The entries still to visit, in the order list
+		size_t next;
+		size_t end;
+		wxString source;
+		wxString dest;
+		PathArena::NativeString nativesource;
+		PathArena::NativeString nativedest;
+		bool leave;
+		int flags;
+		//The failures before we started, if there are more at the end the 
+		//folder isn't done
+		unsigned long failures;
+		//Set when the folder was too big to sort in memory
+		std::shared_ptr<SpilledFolder> spilled;
+	};
+
+	void Push(PathArena::Node node, const wxString &source, const wxString &dest, 
+	          const PathArena::NativeString &nativesourcepath, const PathArena::NativeString &nativedestpath,
+	          bool leave, int flags);
+	void Pop();
+	//Fills in the state of the files on both sides of a new folder
+	void Prefetch(const Frame &frame);
+	void Visit(const Frame &frame);
+	void ReadFolder(const wxString &path, const PathArena::NativeString &nativepath, 
+	                PathArena::Node parent, Location location, Frame &frame);
+	void AddEntry(const PathArena::Char *name, size_t length, PathArena::Node parent, int tag, Frame &frame);
+	//False if the agent has gone and the folder needs reading directly
+	bool ReadRemoteFolder(const wxString &path, PathArena::Node parent, Frame &frame);
+	void Spill(Frame &frame);
+
+	PathArena arena;
+	std::vector<PathArena::Node> order;
+	std::vector<Frame> frames;
+	PathArena::Node current;
+	bool casesensitive;
+	size_t spillthreshold;
+	//The entry we are on in the filesystem's encoding
+	PathArena::NativeString nativesource;
+	PathArena::NativeString nativedest;
+	//What we know about the entry, NULL if we have to ask
+	FileState currentsource;
+	FileState currentdest;
+	FileState missing;
+	const FileState *sourcestate;
+	const FileState *deststate;
+	//Lists the destination for us if there is one
+	std::unique_ptr<SyncAgent> agent;
+	wxString agentroot;
+	//Looks at the files of a folder all at once as soon as it is read
+	std::unique_ptr<StatPrefetcher> prefetcher;
+	//What the agent or the prefetcher told us about each entry
+	std::vector<FileState> sourcestates;
+	std::vector<FileState> deststates;
 };
 
 #endif
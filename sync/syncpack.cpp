@@ -0,0 +1,419 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "syncpack.h"
+#include "packstream.h"
+#include "syncplan.h"
+#include "syncversions.h"
+#include "../toucan.h"
+#include "../rules.h"
+#include "../fileops.h"
+#include "../basicfunctions.h"
+#include "../data/syncdata.h"
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/tokenzr.h>
+
+#ifdef __WXMSW__
+	#include <io.h>
+	#include <fcntl.h>
+#else
+	#include <sys/stat.h>
+#endif
+
+namespace{
+	const char stateheader[] = "ToucanPackState";
+	const size_t stateheaderlength = sizeof(stateheader) - 1;
+	const unsigned int stateversion = 1;
+
+	//What was sent last time, folders end with a /
+	typedef std::map<wxString, FileState> PackState;
+
+	wxString GetStatePath(SyncData *data){
+		wxString folder = wxGetApp().GetSettingsPath() + "packs" + wxFILE_SEP_PATH;
+		if(!wxDirExists(folder)){
+			wxMkdir(folder);
+		}
+		return folder + data->GetName() + ".packstate";
+	}
+
+	//Only used if it was made for the same source
+	bool LoadState(const wxString &path, const wxString &source, PackState &state){
+		wxFile file;
+		if(!wxFileExists(path) || !file.Open(path, wxFile::read)){
+			return false;
+		}
+		AgentChannel channel(file.fd(), -1);
+		char header[stateheaderlength];
+		unsigned int version;
+		wxString statesource;
+		unsigned long long count;
+		if(!channel.ReadBytes(header, stateheaderlength) || memcmp(header, stateheader, stateheaderlength) != 0
+		|| !channel.ReadInt(version) || version != stateversion || !channel.ReadString(statesource)
+		|| statesource != source || !channel.ReadLong(count)){
+			return false;
+		}
+		for(unsigned long long i = 0; i < count; i++){
+			wxString name;
+			FileState entry;
+			unsigned long long modified;
+			if(!channel.ReadString(name) || !channel.ReadLong(entry.size) || !channel.ReadLong(modified)){
+				state.clear();
+				return false;
+			}
+			entry.exists = true;
+			entry.modified = static_cast<long long>(modified);
+			state[name] = entry;
+		}
+		return true;
+	}
+
+	bool SaveState(const wxString &path, const wxString &source, const PackState &state){
+		wxString temp = path + ".tmp";
+		{
+			wxFile file;
+			if(!file.Create(temp, true)){
+				return false;
+			}
+			AgentChannel channel(-1, file.fd());
+			channel.WriteBytes(stateheader, stateheaderlength);
+			channel.WriteInt(stateversion);
+			channel.WriteString(source);
+			channel.WriteLong(state.size());
+			for(PackState::const_iterator iter = state.begin(); iter != state.end(); ++iter){
+				channel.WriteString(iter->first);
+				channel.WriteLong(iter->second.size);
+				channel.WriteLong(static_cast<unsigned long long>(iter->second.modified));
+			}
+			if(!channel.Flush() || !file.Close()){
+				return false;
+			}
+		}
+		return wxRenameFile(temp, path, true);
+	}
+
+	//Walks the source sending whatever has changed since the last pack
+	class Packer{
+	public:
+		Packer(SyncData *syncdata, PackWriter &packwriter, const PackState &previous)
+		    : data(syncdata), writer(packwriter), old(previous), files(0), failed(false)
+		{}
+
+		bool Walk(const wxString &folder, const wxString &relative){
+			wxDir dir(folder);
+			if(!dir.IsOpened()){
+				OutputProgress(_("Failed to read ") + folder, Error);
+				return true;
+			}
+			wxArrayString names, folders;
+			wxString name;
+			for(bool found = dir.GetFirst(&name, wxEmptyString, wxDIR_FILES | wxDIR_HIDDEN); found; found = dir.GetNext(&name)){
+				names.Add(name);
+			}
+			for(bool found = dir.GetFirst(&name, wxEmptyString, wxDIR_DIRS | wxDIR_HIDDEN); found; found = dir.GetNext(&name)){
+				//Old versions kept by a sync to this folder are never sent
+				if(!(relative.IsEmpty() && SyncVersions::IsVersionsFolder(name))){
+					folders.Add(name);
+				}
+			}
+			names.Sort();
+			folders.Sort();
+			for(size_t i = 0; i < names.GetCount(); i++){
+				if(failed || wxGetApp().GetAbort()){
+					return false;
+				}
+				Send(folder + names[i], relative + names[i]);
+			}
+			for(size_t i = 0; i < folders.GetCount(); i++){
+				wxString path = folder + folders[i] + wxFILE_SEP_PATH;
+				if(data->GetRules()->Matches(wxFileName::DirName(path)) == AbsoluteExcluded){
+					continue;
+				}
+				wxString key = relative + folders[i] + "/";
+				FileState state = FileState::Get(wxFileName::DirName(path));
+				current[key] = state;
+				PackState::const_iterator iter = old.find(key);
+				if(iter == old.end() || iter->second.modified != state.modified){
+					writer.WriteFolder(key, state.modified);
+				}
+				if(!Walk(path, key)){
+					return false;
+				}
+			}
+			return true;
+		}
+
+		//Anything sent before that isn't there now, the contents of a folder
+		//come before the folder itself
+		void SendRemovals(){
+			std::vector<wxString> removed;
+			for(PackState::const_iterator iter = old.begin(); iter != old.end(); ++iter){
+				if(current.find(iter->first) == current.end()){
+					removed.push_back(iter->first);
+				}
+			}
+			std::sort(removed.rbegin(), removed.rend());
+			for(std::vector<wxString>::const_iterator iter = removed.begin(); iter != removed.end(); ++iter){
+				writer.WriteRemove(*iter);
+				OutputEvent(EventPackRemove, *iter);
+			}
+		}
+
+		const PackState& GetState() const {return current;}
+		const unsigned long& GetFiles() const {return files;}
+		bool HasFailed() const {return failed;}
+
+	private:
+		void Send(const wxString &path, const wxString &key){
+			PackState::const_iterator iter = old.find(key);
+			//Like a mirror an excluded file is left alone rather than removed
+			if(data->GetRules()->Matches(wxFileName::FileName(path)) == Excluded){
+				if(iter != old.end()){
+					current[key] = iter->second;
+				}
+				return;
+			}
+			FileState state = FileState::Get(wxFileName::FileName(path));
+			if(iter != old.end() && iter->second == state){
+				current[key] = state;
+				return;
+			}
+			wxFile file;
+			if(!file.Open(path, wxFile::read)){
+				OutputProgress(_("Failed to read ") + path, Error);
+				//Still there so not removed, but sent again next time
+				if(iter != old.end()){
+					current[key] = iter->second;
+				}
+				return;
+			}
+			PackRecord record;
+			record.type = PackFile;
+			record.path = key;
+			record.size = state.size;
+			record.modified = state.modified;
+		#ifndef __WXMSW__
+			struct stat st;
+			if(fstat(file.fd(), &st) == 0){
+				record.mode = st.st_mode & 07777;
+			}
+		#endif
+			//A file can't be left half sent so this ends the pack
+			if(!writer.WriteFile(record, file, &wxGetApp().GetCancel())){
+				OutputEvent(EventPack, path, -1);
+				failed = true;
+				return;
+			}
+			current[key] = state;
+			files++;
+			OutputEvent(EventPack, path, 0, state.size);
+		}
+
+		SyncData *data;
+		PackWriter &writer;
+		const PackState &old;
+		PackState current;
+		unsigned long files;
+		bool failed;
+	};
+
+	bool IsSafePart(const wxString &part){
+		if(part.IsEmpty() || part == "." || part == ".."){
+			return false;
+		}
+	#ifdef __WXMSW__
+		//Either could take us to another folder or drive
+		if(part.find_first_of("\\:") != wxString::npos){
+			return false;
+		}
+	#endif
+		return true;
+	}
+
+	//Only a plain relative path may be written to, never anything outside
+	//of the destination
+	bool IsSafe(const wxString &path){
+		wxArrayString parts = wxStringTokenize(path, "/", wxTOKEN_RET_EMPTY_ALL);
+		for(size_t i = 0; i < parts.GetCount(); i++){
+			//A folder ends with an empty part
+			bool folderend = i > 0 && i + 1 == parts.GetCount() && parts[i].IsEmpty();
+			if(!folderend && !IsSafePart(parts[i])){
+				return false;
+			}
+		}
+		return !parts.IsEmpty();
+	}
+
+	wxString ToLocal(const wxFileName &dest, const wxString &path){
+		wxString local = path;
+		local.Replace("/", wxString(wxFILE_SEP_PATH));
+		return dest.GetPathWithSep() + local;
+	}
+
+	int OpenStandard(int fd){
+	#ifdef __WXMSW__
+		//Text mode would change every newline
+		_setmode(fd, _O_BINARY);
+	#endif
+		return fd;
+	}
+}
+
+bool SyncPack::Pack(SyncData *data, const wxString &path, bool compress){
+	SyncFunction function = data->GetFunctionType();
+	if(function != SyncCopy && function != SyncMirror){
+		OutputProgress(_("Only copy and mirror jobs can be packed"), Error);
+		return false;
+	}
+	if(compress && !PackWriter::CanCompress()){
+		OutputProgress(_("This copy of Toucan can't compress packs, the pack will not be compressed"), Error);
+	}
+	wxFile file;
+	int fd;
+	if(path == "-"){
+		fd = OpenStandard(1);
+	}
+	else if(file.Create(path, true)){
+		fd = file.fd();
+	}
+	else{
+		OutputProgress(_("Could not create ") + path, Error);
+		return false;
+	}
+
+	wxString source = data->GetSource().GetPathWithSep();
+	wxString statepath = GetStatePath(data);
+	PackState old;
+	LoadState(statepath, source, old);
+
+	PackWriter writer(fd, compress);
+	Packer packer(data, writer, old);
+	bool ok = writer.WriteHeader() && packer.Walk(source, wxEmptyString) && !packer.HasFailed();
+	if(ok && function == SyncMirror){
+		packer.SendRemovals();
+	}
+	//Without the end the pack can't be unpacked, so nothing is remembered
+	if(!ok || !writer.Finish() || (file.IsOpened() && !file.Close())){
+		OutputProgress(_("The pack could not be finished"), Error);
+		return false;
+	}
+	if(!SaveState(statepath, source, packer.GetState())){
+		OutputProgress(_("Could not save what was packed, the next pack will send everything again"), Error);
+	}
+	OutputProgress(wxString::Format(_("Packed %lu files"), packer.GetFiles()), Message);
+	return true;
+}
+
+bool SyncPack::Unpack(const wxString &path, const wxFileName &dest){
+	wxFile file;
+	int fd;
+	if(path == "-"){
+		fd = OpenStandard(0);
+	}
+	else if(file.Open(path, wxFile::read)){
+		fd = file.fd();
+	}
+	else{
+		OutputProgress(_("Could not open ") + path, Error);
+		return false;
+	}
+
+	FolderCache folders;
+	folders.Create(dest);
+	PackReader reader(fd);
+	//Folder times are set at the end as filling them changes them
+	std::vector<std::pair<wxString, long long> > times;
+	unsigned long files = 0;
+	PackRecord record;
+	bool ok = reader.ReadHeader();
+	while(ok && reader.Next(record)){
+		if(wxGetApp().GetAbort()){
+			ok = false;
+			break;
+		}
+		if(!IsSafe(record.path)){
+			OutputProgress(_("The pack contains an unsafe path ") + record.path, Error);
+			ok = false;
+			break;
+		}
+		wxString local = ToLocal(dest, record.path);
+		if(record.type == PackFolder){
+			if(!folders.Create(wxFileName::DirName(local))){
+				OutputProgress(_("Failed to create ") + local, Error);
+			}
+			times.push_back(std::make_pair(local, record.modified));
+		}
+		else if(record.type == PackRemove){
+			if(record.path.EndsWith("/")){
+				if(wxDirExists(local) && folders.RemoveFolder(wxFileName::DirName(local))){
+					OutputEvent(EventRemoveFolder, local);
+				}
+			}
+			else if(wxFileExists(local)){
+				if(folders.Remove(wxFileName::FileName(local), false, false)){
+					OutputEvent(EventRemoveFile, local);
+				}
+				else{
+					OutputEvent(EventRemoveFile, local, ProgressEvent::LastError());
+				}
+			}
+		}
+		else if(record.type == PackFile){
+			wxFileName target = wxFileName::FileName(local);
+			wxFileName temp = wxFileName::FileName(local + ".toucanunpack");
+			folders.Create(wxFileName::DirName(target.GetPath()));
+			wxFile out;
+			//The contents have to be read whatever happens to stay in step
+			bool created = out.Create(temp.GetFullPath(), true);
+			if(!created){
+				OutputProgress(_("Failed to create ") + local, Error);
+			}
+			if(!reader.ReadContents(created ? &out : NULL, &wxGetApp().GetCancel())){
+				out.Close();
+				if(created){
+					wxRemoveFile(temp.GetFullPath());
+				}
+				ok = false;
+				break;
+			}
+			if(!created){
+				continue;
+			}
+		#ifndef __WXMSW__
+			fchmod(out.fd(), record.mode);
+		#endif
+			out.Close();
+			wxDateTime modified(static_cast<time_t>(record.modified));
+			temp.SetTimes(&modified, &modified, NULL);
+			if(folders.Rename(temp, target)){
+				OutputEvent(EventUnpack, local, 0, record.size);
+				files++;
+			}
+			else{
+				OutputEvent(EventUnpack, local, ProgressEvent::LastError());
+				wxRemoveFile(temp.GetFullPath());
+			}
+		}
+	}
+	if(!ok || !reader.IsFinished()){
+		if(!reader.GetError().IsEmpty()){
+			OutputProgress(reader.GetError(), Error);
+		}
+		OutputProgress(_("The pack was not fully unpacked"), Error);
+		return false;
+	}
+	for(std::vector<std::pair<wxString, long long> >::reverse_iterator iter = times.rbegin(); iter != times.rend(); ++iter){
+		wxDateTime modified(static_cast<time_t>(iter->second));
+		folders.SetTimes(wxFileName::DirName(iter->first), modified, modified, modified);
+	}
+	OutputProgress(wxString::Format(_("Unpacked %lu files"), files), Message);
+	return true;
+}
@@ -0,0 +1,26 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_SYNCPACK
+#define H_SYNCPACK
+
+class SyncData;
+
+#include <wx/string.h>
+#include <wx/filename.h>
+
+//Syncs without the source and destination being there at the same time.
+//Packing writes what has changed in a job's source since it was last packed,
+//along with what has gone if the job mirrors, and unpacking applies that to a
+//destination. The state of what was sent is kept in the packs folder of the
+//settings once a whole pack has been written. A path of - is standard output
+//for packing and standard input for unpacking
+namespace SyncPack{
+	bool Pack(SyncData *data, const wxString &path, bool compress);
+	bool Unpack(const wxString &path, const wxFileName &dest);
+}
+
+#endif
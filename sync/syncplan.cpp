@@ -0,0 +1,186 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "syncplan.h"
+#include "../rules.h"
+#include "../toucan.h"
+#include "../basicfunctions.h"
+#include "../hash.h"
+#include "../data/syncdata.h"
+
+#include <map>
+#include <wx/filefn.h>
+#include <wx/thread.h>
+#include <wx/tokenzr.h>
+#include <wx/wfstream.h>
+#include <wx/txtstrm.h>
+
+using namespace SyncText;
+
+namespace{
+	const wxString header = "Toucan Sync Plan";
+	const long version = 1;
+
+	const char* types[] = {"copy", "skip", "removefile", "removefolder", "enter", "leave"};
+
+	wxString BoolToString(bool value){
+		return value ? "1" : "0";
+	}
+
+	//Journals and baselines are kept for each job in their own folder of the
+	//settings
+	wxString GetStatePath(const wxString &folder, const wxString &file){
+		wxString path = wxGetApp().GetSettingsPath() + folder + wxFILE_SEP_PATH;
+		if(!wxDirExists(path)){
+			wxMkdir(path);
+		}
+		return path + file;
+	}
+}
+
+bool SyncPlan::Save(const wxString &path, SyncData *data) const{
+	wxFileOutputStream file(path);
+	if(!file.IsOk()){
+		return false;
+	}
+	wxTextOutputStream stream(file, wxEOL_UNIX, wxConvUTF8);
+
+	stream << header << "\t" << version << "\n";
+	stream << "Source\t" << Escape(data->GetSource().GetFullPath()) << "\n";
+	stream << "Dest\t" << Escape(data->GetDest().GetFullPath()) << "\n";
+	stream << "Function\t" << ToEn(data->GetFunction()) << "\n";
+	stream << "CheckSize\t" << BoolToString(data->GetCheckSize()) << "\n";
+	stream << "CheckTime\t" << BoolToString(data->GetCheckTime()) << "\n";
+	stream << "CheckShort\t" << BoolToString(data->GetCheckShort()) << "\n";
+	stream << "CheckFull\t" << BoolToString(data->GetCheckFull()) << "\n";
+	stream << "TimeStamps\t" << BoolToString(data->GetTimeStamps()) << "\n";
+	stream << "Attributes\t" << BoolToString(data->GetAttributes()) << "\n";
+	stream << "IgnoreReadOnly\t" << BoolToString(data->GetIgnoreRO()) << "\n";
+	stream << "Recycle\t" << BoolToString(data->GetRecycle()) << "\n";
+	stream << "NoSkipped\t" << BoolToString(data->GetNoSkipped()) << "\n";
+	stream << "Verify\t" << BoolToString(data->GetVerify()) << "\n";
+	stream << "Durability\t" << Durability::ToString(data->GetDurability()) << "\n";
+	stream << "Background\t" << BoolToString(data->GetBackground()) << "\n";
+	stream << "BandwidthLimit\t" << data->GetBandwidthLimit() << "\n";
+	stream << "IopsLimit\t" << data->GetIopsLimit() << "\n";
+	stream << "Versions\t" << BoolToString(data->GetVersions()) << "\n";
+	stream << "KeepVersions\t" << data->GetKeepVersions() << "\n";
+	stream << "Rules\t" << Escape(data->GetRules() ? data->GetRules()->GetName() : "") << "\n";
+
+	for(std::vector<SyncOperation>::const_iterator iter = m_Operations.begin(); iter != m_Operations.end(); ++iter){
+		stream << types[iter->type] << "\t" << iter->flags << "\t" 
+		       << StateToString(iter->sourcestate) << "\t" << StateToString(iter->deststate) << "\t"
+		       << Escape(iter->source) << "\t" << Escape(iter->dest) << "\n";
+	}
+	return file.Close();
+}
+
+bool SyncPlan::Load(const wxString &path, SyncData *data){
+	wxFileInputStream file(path);
+	if(!file.IsOk()){
+		return false;
+	}
+	wxTextInputStream stream(file, "\t", wxConvUTF8);
+
+	wxString line = stream.ReadLine();
+	long fileversion;
+	if(line.BeforeFirst('\t') != header || !line.AfterFirst('\t').ToLong(&fileversion) || fileversion != version){
+		return false;
+	}
+
+	m_Operations.clear();
+	while(!file.Eof()){
+		line = stream.ReadLine();
+		if(line.IsEmpty()){
+			continue;
+		}
+		wxArrayString fields = wxStringTokenize(line, "\t", wxTOKEN_RET_EMPTY_ALL);
+		if(fields.Count() == 2){
+			wxString key = fields.Item(0), value = Unescape(fields.Item(1));
+			if(key == "Source")
+				data->SetSource(wxFileName::DirName(value));
+			else if(key == "Dest")
+				data->SetDest(wxFileName::DirName(value));
+			else if(key == "Function")
+				data->SetFunction(ToLang(value));
+			else if(key == "CheckSize")
+				data->SetCheckSize(value == "1");
+			else if(key == "CheckTime")
+				data->SetCheckTime(value == "1");
+			else if(key == "CheckShort")
+				data->SetCheckShort(value == "1");
+			else if(key == "CheckFull")
+				data->SetCheckFull(value == "1");
+			else if(key == "TimeStamps")
+				data->SetTimeStamps(value == "1");
+			else if(key == "Attributes")
+				data->SetAttributes(value == "1");
+			else if(key == "IgnoreReadOnly")
+				data->SetIgnoreRO(value == "1");
+			else if(key == "Recycle")
+				data->SetRecycle(value == "1");
+			else if(key == "NoSkipped")
+				data->SetNoSkipped(value == "1");
+			else if(key == "Verify")
+				data->SetVerify(value == "1");
+			else if(key == "Durability")
+				data->SetDurability(Durability::FromString(value));
+			else if(key == "Background")
+				data->SetBackground(value == "1");
+			else if(key == "BandwidthLimit")
+				data->SetBandwidthLimit(wxAtol(value));
+			else if(key == "IopsLimit")
+				data->SetIopsLimit(wxAtol(value));
+			else if(key == "Versions")
+				data->SetVersions(value == "1");
+			else if(key == "KeepVersions")
+				data->SetKeepVersions(wxAtol(value));
+			else if(key == "Rules"){
+				RuleSet *rules = new RuleSet(value);
+				rules->TransferFromFile();
+				data->SetRules(rules);
+			}
+			continue;
+		}
+		if(fields.Count() != 6){
+			return false;
+		}
+		SyncOperation operation;
+		bool found = false;
+		for(unsigned int i = 0; i < WXSIZEOF(types); i++){
+			if(fields.Item(0) == types[i]){
+				operation.type = static_cast<SyncOperationType>(i);
+				found = true;
+				break;
+			}
+		}
+		long flags;
+		if(!found || !fields.Item(1).ToLong(&flags)
+		|| !StringToState(fields.Item(2), operation.sourcestate)
+		|| !StringToState(fields.Item(3), operation.deststate)){
+			return false;
+		}
+		operation.flags = flags;
+		operation.source = Unescape(fields.Item(4));
+		operation.dest = Unescape(fields.Item(5));
+		m_Operations.push_back(operation);
+	}
+	return true;
+}
+
+SyncJournal::SyncJournal(SyncData *data) 
+           : SyncJournal(GetStatePath("journals", data->GetName() + ".journal"), 
+                         "Job\t" + Escape(data->GetSource().GetFullPath()) + "\t" 
+                         + Escape(data->GetDest().GetFullPath()) + "\t" + ToEn(data->GetFunction()) + "\t" 
+                         + Escape(data->GetRules() ? data->GetRules()->GetName() : wxString()) 
+                         + wxString::Format("\t%d", data->GetChecks()), 
+                         data->GetDurability() != Durability::None)
+{}
+
+SyncBaseline::SyncBaseline(SyncData *data, bool full) 
+            : SyncBaseline(GetStatePath("baselines", data->GetName() + ".baseline"), 
+                           data->GetSource(), data->GetDest(), full, &wxGetApp().GetCancel())
+{}
@@ -0,0 +1,68 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_SYNCPLAN
+#define H_SYNCPLAN
+
+class SyncData;
+
+#include "syncstate.h"
+#include <vector>
+#include <wx/string.h>
+#include <wx/filename.h>
+
+enum SyncOperationType{
+	SyncCopyFile,
+	SyncSkipFile,
+	SyncRemoveFile,
+	SyncRemoveFolder,
+	//Make sure both folders exist before their contents are synced
+	SyncEnterFolder,
+	//Tidy up the folders once their contents are done
+	SyncLeaveFolder
+};
+
+enum SyncOperationFlags{
+	SyncMoveSource = 1,          //Remove the source once it has been copied
+	SyncRemoveDestIfEmpty = 2,
+	SyncRemoveSourceIfEmpty = 4,
+	SyncCopyTimes = 8,           //From the source folder to the dest folder
+	SyncCopyTimesReverse = 16    //From the dest folder to the source folder
+};
+
+//A single step of a sync along with the state of the files it was based on.
+//Copies and skips always go from source to dest, so an equalise copying 
+//backwards has them swapped
+struct SyncOperation{
+	SyncOperationType type;
+	wxString source;
+	wxString dest;
+	int flags;
+	FileState sourcestate;
+	FileState deststate;
+
+	SyncOperation() : type(SyncSkipFile), flags(0)
+	{}
+};
+
+//Everything a sync job is going to do, in the order it will do it. It can be
+//saved to disk, looked at and run later
+class SyncPlan{
+
+public:
+	void Add(const SyncOperation &operation) {m_Operations.push_back(operation);}
+	const std::vector<SyncOperation>& GetOperations() const {return m_Operations;}
+	void Clear() {m_Operations.clear();}
+
+	//The job settings are saved with the plan so it can be run on its own
+	bool Save(const wxString &path, SyncData *data) const;
+	bool Load(const wxString &path, SyncData *data);
+
+private:
+	std::vector<SyncOperation> m_Operations;
+};
+
+#endif
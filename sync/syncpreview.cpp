@@ -50,11 +50,11 @@ DirCtrlItemArray SyncPreview::Execute(){
 void SyncPreview::OnSourceNotDestFile(const wxFileName &source, const wxFileName &dest){
     DirCtrlItem *sourceitem = new DirCtrlItem(source);
     sourceitems.push_back(sourceitem);
-    if(data->GetFunction() != _("Clean") && data->GetRules()->Matches(source) != Excluded){
+    if(function != SyncClean && data->GetRules()->Matches(source) != Excluded){
         DirCtrlItem* destitem = new DirCtrlItem(dest);
         destitem->SetColour("Blue");
         destitems.push_back(destitem);
-		if(data->GetFunction() == _("Move")){
+		if(function == SyncMove){
             sourceitem->SetColour(wxT("Grey"));
         }
     }
@@ -64,10 +64,10 @@ void SyncPreview::OnNotSourceDestFile(const wxFileName &source, const wxFileName
     DirCtrlItem *destitem = new DirCtrlItem(dest);
     destitems.push_back(destitem);
     if(data->GetRules()->Matches(dest) != Excluded){
-        if(data->GetFunction() == _("Mirror") || data->GetFunction() == _("Clean")){
+        if(function == SyncMirror || function == SyncClean){
             destitem->SetColour(wxT("Grey"));						
         }
-        else if(data->GetFunction() == _("Equalise")){
+        else if(function == SyncEqualise){
             DirCtrlItem* item = new DirCtrlItem(source);
             item->SetColour(wxT("Blue"));
             sourceitems.push_back(item);
@@ -81,15 +81,15 @@ void SyncPreview::OnSourceAndDestFile(const wxFileName &source, const wxFileName
 	sourceitems.push_back(sourceitem);
     destitems.push_back(destitem);
     if(data->GetRules()->Matches(dest) != Excluded){
-        if(data->GetFunction() == _("Copy") || data->GetFunction() == _("Mirror") || data->GetFunction() == _("Move")){
+        if(function == SyncCopy || function == SyncMirror || function == SyncMove){
             if(CopyIfNeeded(source, dest)){
                 destitem->SetColour(wxT("Green"));		
-                if(data->GetFunction() == _("Move")){
+                if(function == SyncMove){
                     sourceitem->SetColour(wxT("Grey"));
                 }
             }		
         }
-        else if(data->GetFunction() == _("Equalise")){
+        else if(function == SyncEqualise){
             wxDateTime to, from;
             dest.GetTimes(NULL, &to, NULL);
             source.GetTimes(NULL, &from, NULL);		
@@ -108,7 +108,7 @@ void SyncPreview::OnSourceAndDestFile(const wxFileName &source, const wxFileName
 void SyncPreview::OnSourceNotDestFolder(const wxFileName &source, const wxFileName &dest){
     DirCtrlItem *sourceitem = new DirCtrlItem(source);
     sourceitems.push_back(sourceitem);
-    if(data->GetFunction() != _("Clean")){
+    if(function != SyncClean){
         DirCtrlItem* destitem = new DirCtrlItem(dest);
         RuleResult res = data->GetRules()->Matches(source);
         if(res == Excluded){
@@ -122,7 +122,7 @@ void SyncPreview::OnSourceNotDestFolder(const wxFileName &source, const wxFileNa
         else{
             delete destitem;
         }
-        if(data->GetFunction() == _("Move"))
+        if(function == SyncMove)
             sourceitem->SetColour(wxT("Red"));
     }
 }
@@ -130,12 +130,12 @@ void SyncPreview::OnSourceNotDestFolder(const wxFileName &source, const wxFileNa
 void SyncPreview::OnNotSourceDestFolder(const wxFileName &source, const wxFileName &dest){
     DirCtrlItem *destitem = new DirCtrlItem(dest);
     destitems.push_back(destitem);
-    if(data->GetFunction() == _("Mirror") || data->GetFunction() == _("Clean")){
+    if(function == SyncMirror || function == SyncClean){
         RuleResult res = data->GetRules()->Matches(dest);
         if(res != Excluded && res != AbsoluteExcluded)
             destitem->SetColour(wxT("Grey"));		
     }
-    else if(data->GetFunction() == _("Equalise")){
+    else if(function == SyncEqualise){
         RuleResult res = data->GetRules()->Matches(dest);
         DirCtrlItem* sourceitem = new DirCtrlItem(source);
         if(res != Excluded && res != AbsoluteExcluded)
@@ -148,7 +148,7 @@ void SyncPreview::OnSourceAndDestFolder(const wxFileName &source, const wxFileNa
     DirCtrlItem *sourceitem = new DirCtrlItem(source);
     sourceitems.push_back(sourceitem);
     destitems.push_back(new DirCtrlItem(dest));
-    if(data->GetFunction() == _("Move")){
+    if(function == SyncMove){
         RuleResult res = data->GetRules()->Matches(source);
         if(res != Excluded && res != AbsoluteExcluded){
             sourceitem->SetColour(wxT("Red"));						
@@ -157,18 +157,5 @@ void SyncPreview::OnSourceAndDestFolder(const wxFileName &source, const wxFileNa
 }
 
 bool SyncPreview::CopyIfNeeded(const wxFileName &source, const wxFileName &dest){
-    //If the dest file doesn't exists then we must copy
-    if(!dest.FileExists()){
-        return true;
-    }
-    //If copy if anything says copy
-    if((data->GetCheckSize() && ShouldCopySize(source, dest))
-    || (data->GetCheckTime() && ShouldCopyTime(source, dest))
-    || (data->GetCheckShort() && ShouldCopyShort(source, dest))
-    || (data->GetCheckFull() && ShouldCopyFull(source, dest))
-    || (!data->GetCheckSize() && !data->GetCheckTime() && 
-        !data->GetCheckShort() && !data->GetCheckFull())){
-        return true;
-    }
-    return false;
+    return ShouldCopy(source, dest, checks, comparer, NULL, NULL, true);
 }
@@ -0,0 +1,590 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "syncstate.h"
+#include "../hash.h"
+
+#include <map>
+#include <vector>
+#include <wx/datetime.h>
+#include <wx/filefn.h>
+#include <wx/thread.h>
+#include <wx/tokenzr.h>
+#include <wx/wfstream.h>
+#include <wx/txtstrm.h>
+
+#ifdef __WXMSW__
+	#include <io.h>
+#else
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+FileState FileState::Get(const wxFileName &path){
+	FileState state;
+	wxStructStat st;
+	//Folders can't have a trailing separator on windows
+	if(wxStat(path.IsDir() ? path.GetPath() : path.GetFullPath(), &st) == 0){
+		state.exists = true;
+		state.size = st.st_size;
+		state.modified = st.st_mtime;
+	}
+	return state;
+}
+
+FileState FileState::Get(const PathArena::NativeString &path){
+#ifdef __WXMSW__
+	return Get(wxFileName(wxString(path.c_str(), path.length())));
+#else
+	FileState state;
+	struct stat st;
+	if(stat(path.c_str(), &st) == 0){
+		state.exists = true;
+		state.size = st.st_size;
+		state.modified = st.st_mtime;
+	}
+	return state;
+#endif
+}
+
+bool FileState::operator==(const FileState &other) const{
+	return exists == other.exists && size == other.size && modified == other.modified;
+}
+
+FileIdentity FileIdentity::Get(const wxFileName &path){
+	FileIdentity identity;
+#ifdef __WXMSW__
+	identity.state = FileState::Get(path);
+#else
+	struct stat st;
+	if(stat((path.IsDir() ? path.GetPath() : path.GetFullPath()).fn_str(), &st) == 0){
+		identity.state.exists = true;
+		identity.state.size = st.st_size;
+		identity.state.modified = st.st_mtime;
+	#ifdef __DARWIN__
+		identity.modifiednano = st.st_mtimespec.tv_nsec;
+		identity.changednano = st.st_ctimespec.tv_nsec;
+	#else
+		identity.modifiednano = st.st_mtim.tv_nsec;
+		identity.changednano = st.st_ctim.tv_nsec;
+	#endif
+		//The change time also moves when the modified time is set back
+		identity.changed = st.st_ctime;
+		identity.device = st.st_dev;
+		identity.inode = st.st_ino;
+	}
+#endif
+	return identity;
+}
+
+bool FileIdentity::operator==(const FileIdentity &other) const{
+	return state == other.state && modifiednano == other.modifiednano && changed == other.changed 
+	    && changednano == other.changednano && device == other.device && inode == other.inode;
+}
+
+namespace SyncText{
+	//Tabs and newlines are legal in filenames so they need escaping
+	wxString Escape(const wxString &value){
+		wxString escaped;
+		for(wxString::const_iterator iter = value.begin(); iter != value.end(); ++iter){
+			if(*iter == '\\')
+				escaped += "\\\\";
+			else if(*iter == '\t')
+				escaped += "\\t";
+			else if(*iter == '\n')
+				escaped += "\\n";
+			else
+				escaped += *iter;
+		}
+		return escaped;
+	}
+
+	wxString Unescape(const wxString &value){
+		wxString unescaped;
+		for(wxString::const_iterator iter = value.begin(); iter != value.end(); ++iter){
+			if(*iter == '\\' && iter + 1 != value.end()){
+				++iter;
+				if(*iter == 't')
+					unescaped += '\t';
+				else if(*iter == 'n')
+					unescaped += '\n';
+				else
+					unescaped += *iter;
+			}
+			else{
+				unescaped += *iter;
+			}
+		}
+		return unescaped;
+	}
+
+	wxString StateToString(const FileState &state){
+		if(!state.exists){
+			return "-";
+		}
+		return wxString::Format("%llu:%lld", state.size, state.modified);
+	}
+
+	bool StringToState(const wxString &value, FileState &state){
+		state = FileState();
+		if(value == "-"){
+			return true;
+		}
+		wxULongLong_t size;
+		wxLongLong_t modified;
+		if(!value.BeforeFirst(':').ToULongLong(&size) || !value.AfterFirst(':').ToLongLong(&modified)){
+			return false;
+		}
+		state.exists = true;
+		state.size = size;
+		state.modified = modified;
+		return true;
+	}
+}
+
+using namespace SyncText;
+
+namespace{
+	const wxString journalheader = "Toucan Journal";
+	const long journalversion = 2;
+	//A journal older than this, in seconds, is started again rather than
+	//trusted, changes inside a finished folder that leave its time alone are
+	//otherwise only picked up by the next run
+	const long long journalage = 7 * 24 * 60 * 60;
+	const wxString partialextension = ".toucanpart";
+
+	const wxString baselineheader = "Toucan Baseline";
+	const long baselineversion = 1;
+}
+
+SyncJournal::SyncJournal(const wxString &path, const wxString &job, bool durable) 
+           : m_Path(path), m_Durable(durable), m_Resumed(false){
+	if(wxFileExists(m_Path)){
+		m_Resumed = Load(job);
+	}
+	if(m_Resumed){
+		m_File.Open(m_Path, "a");
+	}
+	else{
+		m_Done.clear();
+		m_Partials.clear();
+		m_File.Open(m_Path, "w");
+		Write(journalheader + wxString::Format("\t%ld", journalversion));
+		Write(job);
+		Write(wxString::Format("Started\t%lld", static_cast<long long>(wxDateTime::Now().GetTicks())));
+	}
+}
+
+bool SyncJournal::Load(const wxString &job){
+	wxFileInputStream file(m_Path);
+	if(!file.IsOk()){
+		return false;
+	}
+	wxTextInputStream stream(file, "\t", wxConvUTF8);
+
+	wxString line = stream.ReadLine();
+	long fileversion;
+	if(line.BeforeFirst('\t') != journalheader || !line.AfterFirst('\t').ToLong(&fileversion) 
+	|| fileversion != journalversion || stream.ReadLine() != job){
+		return false;
+	}
+	line = stream.ReadLine();
+	wxLongLong_t started;
+	long long now = wxDateTime::Now().GetTicks();
+	if(line.BeforeFirst('\t') != "Started" || !line.AfterFirst('\t').ToLongLong(&started) 
+	|| started > now || now - started > journalage){
+		return false;
+	}
+	//Folders recorded as done, checked once we have them all
+	std::vector<wxArrayString> done;
+	while(!file.Eof()){
+		//A line cut short when we were stopped is simply ignored
+		wxArrayString fields = wxStringTokenize(stream.ReadLine(), "\t", wxTOKEN_RET_EMPTY_ALL);
+		if(fields.Count() == 5 && fields.Item(0) == "done"){
+			done.push_back(fields);
+		}
+		else if(fields.Count() == 2 && fields.Item(0) == "copied"){
+			m_Partials.erase(Unescape(fields.Item(1)));
+		}
+		else if(fields.Count() == 4 && fields.Item(0) == "part"){
+			Partial partial;
+			wxLongLong_t offset;
+			if(StringToState(fields.Item(2), partial.source) && fields.Item(3).ToLongLong(&offset)){
+				partial.offset = offset;
+				m_Partials[Unescape(fields.Item(1))] = partial;
+			}
+		}
+	}
+	std::set<wxString> changed;
+	for(std::vector<wxArrayString>::const_iterator iter = done.begin(); iter != done.end(); ++iter){
+		wxString source = Unescape(iter->Item(1)), dest = Unescape(iter->Item(2));
+		FileState sourcestate, deststate;
+		if(StringToState(iter->Item(3), sourcestate) && StringToState(iter->Item(4), deststate)
+		&& FileState::Get(wxFileName::DirName(source)) == sourcestate 
+		&& FileState::Get(wxFileName::DirName(dest)) == deststate){
+			m_Done.insert(dest);
+		}
+		else{
+			changed.insert(dest);
+		}
+	}
+	//A folder is only done if everything under it is, so anything above a
+	//folder that has changed has to be looked at again too
+	for(std::set<wxString>::const_iterator iter = changed.begin(); iter != changed.end(); ++iter){
+		wxString folder = *iter;
+		while(!folder.IsEmpty()){
+			m_Done.erase(folder);
+			folder = folder.Left(folder.length() - 1);
+			if(folder.Find(wxFILE_SEP_PATH) == wxNOT_FOUND){
+				break;
+			}
+			folder = folder.BeforeLast(wxFILE_SEP_PATH) + wxFILE_SEP_PATH;
+		}
+	}
+	return true;
+}
+
+void SyncJournal::Write(const wxString &line, bool sync){
+	if(!m_File.IsOpened()){
+		return;
+	}
+	//Each line goes straight to the operating system so it survives us 
+	//being killed
+	m_File.Write(line + "\n", wxConvUTF8);
+	m_File.Flush();
+	if(sync){
+		//And if asked to the disk, so it survives the power going too
+#ifdef __WXMSW__
+		_commit(_fileno(m_File.fp()));
+#else
+		fsync(fileno(m_File.fp()));
+#endif
+	}
+}
+
+bool SyncJournal::IsDone(const wxString &dest) const{
+	return m_Done.find(dest) != m_Done.end();
+}
+
+void SyncJournal::Done(const wxString &source, const wxString &dest){
+	m_Done.insert(dest);
+	//The states are taken now so that any later change to either side means
+	//the folder is looked at again
+	wxString line = "done\t" + Escape(source) + "\t" + Escape(dest) + "\t" 
+	              + StateToString(FileState::Get(wxFileName::DirName(source))) + "\t" 
+	              + StateToString(FileState::Get(wxFileName::DirName(dest)));
+	if(m_Durable){
+		m_Pending.push_back(line);
+	}
+	else{
+		Write(line);
+	}
+}
+
+void SyncJournal::Flushed(bool ok){
+	if(ok){
+		for(size_t i = 0; i < m_Pending.size(); i++){
+			//One sync after the last covers them all
+			Write(m_Pending[i], i + 1 == m_Pending.size());
+		}
+	}
+	m_Pending.clear();
+}
+
+long long SyncJournal::GetOffset(const wxString &dest, const FileState &source) const{
+	std::map<wxString, Partial>::const_iterator iter = m_Partials.find(dest);
+	if(iter == m_Partials.end() || iter->second.source != source){
+		return 0;
+	}
+	return iter->second.offset;
+}
+
+void SyncJournal::Checkpoint(const wxString &dest, const FileState &source, long long offset){
+	Partial partial;
+	partial.source = source;
+	partial.offset = offset;
+	m_Partials[dest] = partial;
+	Write("part\t" + Escape(dest) + "\t" + StateToString(source) + wxString::Format("\t%lld", offset));
+}
+
+void SyncJournal::Copied(const wxString &dest){
+	if(m_Partials.erase(dest) > 0){
+		Write("copied\t" + Escape(dest));
+	}
+}
+
+void SyncJournal::Finish(){
+	m_File.Close();
+	if(wxFileExists(m_Path)){
+		wxRemoveFile(m_Path);
+	}
+}
+
+wxString SyncJournal::GetPartialPath(const wxString &dest){
+	return dest + partialextension;
+}
+
+bool SyncJournal::IsPartial(const wxString &path){
+	return path.EndsWith(partialextension);
+}
+
+SyncBaseline::SyncBaseline(const wxString &path, const wxFileName &source, const wxFileName &dest, bool full, 
+                           const CancelToken *cancel) : m_Path(path), m_Full(full), m_Cancel(cancel){
+	m_Source = source.GetPathWithSep();
+	m_Dest = dest.GetPathWithSep();
+	m_Job = "Job\t" + Escape(m_Source) + "\t" + Escape(m_Dest);
+	if(wxFileExists(m_Path) && !Load()){
+		m_Entries.clear();
+	}
+}
+
+bool SyncBaseline::Load(){
+	wxFileInputStream file(m_Path);
+	if(!file.IsOk()){
+		return false;
+	}
+	wxTextInputStream stream(file, "\t", wxConvUTF8);
+
+	wxString line = stream.ReadLine();
+	long fileversion;
+	if(line.BeforeFirst('\t') != baselineheader || !line.AfterFirst('\t').ToLong(&fileversion) 
+	|| fileversion != baselineversion || stream.ReadLine() != m_Job){
+		return false;
+	}
+	while(!file.Eof()){
+		line = stream.ReadLine();
+		if(line.IsEmpty()){
+			continue;
+		}
+		wxArrayString fields = wxStringTokenize(line, "\t", wxTOKEN_RET_EMPTY_ALL);
+		Entry entry;
+		wxULongLong_t hash = 0;
+		if(fields.Count() != 4 || !StringToState(fields.Item(1), entry.source) || !StringToState(fields.Item(2), entry.dest)
+		|| (fields.Item(3) != "-" && !fields.Item(3).ToULongLong(&hash, 16))){
+			return false;
+		}
+		entry.hashed = fields.Item(3) != "-";
+		entry.hash = hash;
+		m_Entries[Unescape(fields.Item(0))] = entry;
+	}
+	return true;
+}
+
+bool SyncBaseline::Save(bool finished){
+	if(!finished){
+		//What we saw this time wins over what we had
+		for(std::map<wxString, Entry>::const_iterator iter = m_Seen.begin(); iter != m_Seen.end(); ++iter){
+			m_Entries[iter->first] = iter->second;
+		}
+	}
+	const std::map<wxString, Entry> &entries = finished ? m_Seen : m_Entries;
+	//Written alongside and renamed over so a crash never leaves half a baseline
+	wxString temp = m_Path + ".tmp";
+	{
+		wxFileOutputStream file(temp);
+		if(!file.IsOk()){
+			return false;
+		}
+		wxTextOutputStream stream(file, wxEOL_UNIX, wxConvUTF8);
+		stream << baselineheader << "\t" << baselineversion << "\n";
+		stream << m_Job << "\n";
+		for(std::map<wxString, Entry>::const_iterator iter = entries.begin(); iter != entries.end(); ++iter){
+			stream << Escape(iter->first) << "\t" << StateToString(iter->second.source) << "\t" 
+			       << StateToString(iter->second.dest) << "\t" 
+			       << (iter->second.hashed ? wxString::Format("%llx", iter->second.hash) : wxString("-")) << "\n";
+		}
+		if(!file.Close()){
+			return false;
+		}
+	}
+	return wxRenameFile(temp, m_Path, true);
+}
+
+wxString SyncBaseline::GetKey(const wxFileName &path, bool &issource) const{
+	wxString fullpath = path.GetFullPath();
+	issource = fullpath.StartsWith(m_Source);
+	return fullpath.Mid(issource ? m_Source.length() : m_Dest.length());
+}
+
+bool SyncBaseline::IsSame(const wxFileName &path, const FileState &state, const FileState &base, const Entry &entry) const{
+	if(state == base){
+		return true;
+	}
+	//Only the time has moved, which a copy between machines or a touch 
+	//does, so the contents have the final say
+	if(!m_Full || !entry.hashed || !state.exists || state.size != base.size){
+		return false;
+	}
+	unsigned long long hash;
+	return Hash(path, hash) && hash == entry.hash;
+}
+
+bool SyncBaseline::Hash(const wxFileName &path, unsigned long long &hash) const{
+	if(HashCache::Recall(path, hash)){
+		return true;
+	}
+	FileIdentity identity = FileIdentity::Get(path);
+	if(!ContentHash::File(path.GetFullPath(), hash, false, m_Cancel)){
+		return false;
+	}
+	HashCache::Remember(path, identity, hash);
+	return true;
+}
+
+bool SyncBaseline::ShouldCopy(const wxFileName &from, const wxFileName &to, const FileState &fromstate, const FileState &tostate) const{
+	if(!m_Full || !tostate.exists || fromstate.size != tostate.size){
+		return true;
+	}
+	unsigned long long fromhash, tohash;
+	return !Hash(from, fromhash) || !Hash(to, tohash) || fromhash != tohash;
+}
+
+SyncBaseline::Changes SyncBaseline::GetChanges(const wxFileName &source, const FileState &sourcestate, const FileState &deststate) const{
+	bool issource;
+	wxString key = GetKey(source, issource);
+	std::map<wxString, Entry>::const_iterator iter = m_Entries.find(key);
+	if(!issource || iter == m_Entries.end()){
+		return BothChanged;
+	}
+	int changes = Unchanged;
+	if(!IsSame(source, sourcestate, iter->second.source, iter->second)){
+		changes |= SourceChanged;
+	}
+	if(!IsSame(wxFileName(m_Dest + key), deststate, iter->second.dest, iter->second)){
+		changes |= DestChanged;
+	}
+	return static_cast<Changes>(changes);
+}
+
+void SyncBaseline::Keep(const wxFileName &source, const FileState &sourcestate, const FileState &deststate){
+	bool issource;
+	wxString key = GetKey(source, issource);
+	std::map<wxString, Entry>::const_iterator iter = m_Entries.find(key);
+	if(iter == m_Entries.end()){
+		return;
+	}
+	Entry entry = iter->second;
+	entry.source = sourcestate;
+	entry.dest = deststate;
+	m_Seen[key] = entry;
+}
+
+void SyncBaseline::Synced(const wxFileName &first, const wxFileName &second){
+	bool issource;
+	wxString key = GetKey(first, issource);
+	const wxFileName &source = issource ? first : second;
+	const wxFileName &dest = issource ? second : first;
+	Entry entry;
+	entry.source = FileState::Get(source);
+	entry.dest = FileState::Get(dest);
+	entry.hashed = HashCache::Recall(source, entry.hash);
+	if(entry.source.exists && entry.dest.exists){
+		m_Seen[key] = entry;
+	}
+}
+
+namespace{
+	struct Decision{
+		int checks;
+		bool copy;
+		FileIdentity source;
+		FileIdentity dest;
+	};
+
+	//More than anyone looks through in a preview
+	const size_t maxdecisions = 1000000;
+
+	//The preview runs on a pool of threads
+	wxCriticalSection decisionsection;
+	std::map<wxString, Decision> decisions;
+
+	wxString DecisionKey(const wxFileName &source, const wxFileName &dest){
+		return source.GetFullPath() + '\n' + dest.GetFullPath();
+	}
+}
+
+void SyncDecisions::Remember(const wxFileName &source, const wxFileName &dest, int checks, bool copy){
+	Decision decision;
+	decision.checks = checks;
+	decision.copy = copy;
+	decision.source = FileIdentity::Get(source);
+	decision.dest = FileIdentity::Get(dest);
+	wxCriticalSectionLocker lock(decisionsection);
+	if(decisions.size() >= maxdecisions){
+		return;
+	}
+	decisions[DecisionKey(source, dest)] = decision;
+}
+
+bool SyncDecisions::Recall(const wxFileName &source, const wxFileName &dest, int checks, bool &copy){
+	Decision decision;
+	{
+		wxCriticalSectionLocker lock(decisionsection);
+		std::map<wxString, Decision>::iterator iter = decisions.find(DecisionKey(source, dest));
+		if(iter == decisions.end()){
+			return false;
+		}
+		decision = iter->second;
+	}
+	if(decision.checks != checks || FileIdentity::Get(source) != decision.source || FileIdentity::Get(dest) != decision.dest){
+		return false;
+	}
+	copy = decision.copy;
+	return true;
+}
+
+void SyncDecisions::Clear(){
+	wxCriticalSectionLocker lock(decisionsection);
+	decisions.clear();
+}
+
+namespace{
+	struct Hashed{
+		FileIdentity identity;
+		unsigned long long hash;
+	};
+
+	//Enough for a good sized job without growing forever
+	const size_t maxhashes = 1000000;
+
+	wxCriticalSection hashsection;
+	std::map<wxString, Hashed> hashes;
+}
+
+void HashCache::Remember(const wxFileName &path, unsigned long long hash){
+	Remember(path, FileIdentity::Get(path), hash);
+}
+
+void HashCache::Remember(const wxFileName &path, const FileIdentity &identity, unsigned long long hash){
+	if(!identity.state.exists){
+		return;
+	}
+	Hashed hashed;
+	hashed.identity = identity;
+	hashed.hash = hash;
+	wxCriticalSectionLocker lock(hashsection);
+	if(hashes.size() >= maxhashes){
+		hashes.clear();
+	}
+	hashes[path.GetFullPath()] = hashed;
+}
+
+bool HashCache::Recall(const wxFileName &path, unsigned long long &hash){
+	Hashed hashed;
+	{
+		wxCriticalSectionLocker lock(hashsection);
+		std::map<wxString, Hashed>::iterator iter = hashes.find(path.GetFullPath());
+		if(iter == hashes.end()){
+			return false;
+		}
+		hashed = iter->second;
+	}
+	if(FileIdentity::Get(path) != hashed.identity){
+		return false;
+	}
+	hash = hashed.hash;
+	return true;
+}
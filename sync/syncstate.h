@@ -0,0 +1,206 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2010 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_SYNCSTATE
+#define H_SYNCSTATE
+
+class SyncData;
+class CancelToken;
+
+#include "patharena.h"
+#include <set>
+#include <map>
+#include <vector>
+#include <wx/string.h>
+#include <wx/filename.h>
+#include <wx/ffile.h>
+
+//Enough about a file to cheaply tell if it has changed since we looked at it
+struct FileState{
+	bool exists;
+	unsigned long long size;
+	long long modified;
+
+	FileState() : exists(false), size(0), modified(0)
+	{}
+
+	static FileState Get(const wxFileName &path);
+	//The same but straight from a path in the filesystem's own encoding
+	static FileState Get(const PathArena::NativeString &path);
+	bool operator==(const FileState &other) const;
+	bool operator!=(const FileState &other) const {return !(*this == other);}
+};
+
+//Stricter than a FileState, for what we only keep in memory and so can trust
+//without reading the file again. A file replaced by another of the same size
+//in the same second is told apart where the system gives finer times and 
+//file ids, which Windows doesn't through stat
+struct FileIdentity{
+	FileState state;
+	long modifiednano;
+	long long changed;
+	long changednano;
+	unsigned long long device;
+	unsigned long long inode;
+
+	FileIdentity() : modifiednano(0), changed(0), changednano(0), device(0), inode(0)
+	{}
+
+	static FileIdentity Get(const wxFileName &path);
+	bool operator==(const FileIdentity &other) const;
+	bool operator!=(const FileIdentity &other) const {return !(*this == other);}
+};
+
+//The files we keep between runs are tab separated text
+namespace SyncText{
+	//Tabs and newlines are legal in filenames so they need escaping
+	wxString Escape(const wxString &value);
+	wxString Unescape(const wxString &value);
+	wxString StateToString(const FileState &state);
+	bool StringToState(const wxString &value, FileState &state);
+}
+
+//A record of how far a sync got, added to as it goes so that a job which is
+//stopped can carry on where it left off. It is only picked up again by a run
+//with the same folders, function, rules and checks that isn't too old, and
+//is removed once a run finishes
+class SyncJournal{
+
+public:
+	SyncJournal(SyncData *data);
+	//A journal kept at the given path, only picked up again with the same job.
+	//If durable is set folders done are held back until Flushed says what
+	//was written to them is on disk
+	SyncJournal(const wxString &path, const wxString &job, bool durable = false);
+
+	//True if an earlier run of the job left the journal behind
+	bool IsResumed() const {return m_Resumed;}
+
+	//Folders whose whole contents have been synced, a folder stops counting
+	//as done if either side has changed since
+	bool IsDone(const wxString &dest) const;
+	void Done(const wxString &source, const wxString &dest);
+	//Writes the folders held back since the last call, or forgets them if 
+	//what was written couldn't be flushed
+	void Flushed(bool ok);
+
+	//How much of a large copy is already safely written, as long as the 
+	//source hasn't changed since
+	long long GetOffset(const wxString &dest, const FileState &source) const;
+	void Checkpoint(const wxString &dest, const FileState &source, long long offset);
+	void Copied(const wxString &dest);
+
+	//Call once the job has run to the end
+	void Finish();
+
+	//Where a large file is copied to until it is finished
+	static wxString GetPartialPath(const wxString &dest);
+	static bool IsPartial(const wxString &path);
+
+private:
+	struct Partial{
+		FileState source;
+		long long offset;
+	};
+
+	bool Load(const wxString &job);
+	//If sync is set the line is on disk before we return
+	void Write(const wxString &line, bool sync = false);
+
+	wxString m_Path;
+	wxFFile m_File;
+	bool m_Durable;
+	bool m_Resumed;
+	std::set<wxString> m_Done;
+	std::vector<wxString> m_Pending;
+	std::map<wxString, Partial> m_Partials;
+};
+
+//What both sides of an equalise looked like the last time they were the same,
+//so a file only counts as changed on a side that differs from it rather than
+//by comparing times across machines whose clocks may not agree. It is kept in
+//the baselines folder of the settings and only used by a run with the same
+//folders
+class SyncBaseline{
+
+public:
+	enum Changes{
+		Unchanged = 0,
+		SourceChanged = 1,
+		DestChanged = 2,
+		//Changed on both sides, or never seen the same
+		BothChanged = SourceChanged | DestChanged
+	};
+
+	//Full is set when a file whose time alone has changed should be hashed
+	//to see if it really has
+	SyncBaseline(SyncData *data, bool full);
+	//A baseline kept at the given path, hashing can be stopped by the token
+	SyncBaseline(const wxString &path, const wxFileName &source, const wxFileName &dest, bool full, 
+	             const CancelToken *cancel = NULL);
+
+	Changes GetChanges(const wxFileName &source, const FileState &sourcestate, const FileState &deststate) const;
+	//Whether a file GetChanges found changed on one side has to be copied
+	//over the other. The times can't decide as the clocks may not agree, so
+	//unless the contents are being compared it always is
+	bool ShouldCopy(const wxFileName &from, const wxFileName &to, const FileState &fromstate, const FileState &tostate) const;
+	//Call once both sides hold the same file, in either order
+	void Synced(const wxFileName &first, const wxFileName &second);
+	//Call for a file that GetChanges found unchanged, with its states now
+	void Keep(const wxFileName &source, const FileState &sourcestate, const FileState &deststate);
+
+	//Files that weren't seen are dropped when the run finished, otherwise 
+	//they are kept for next time
+	bool Save(bool finished);
+
+private:
+	struct Entry{
+		FileState source;
+		FileState dest;
+		bool hashed;
+		unsigned long long hash;
+	};
+
+	bool Load();
+	//Where the file is relative to the root it is under
+	wxString GetKey(const wxFileName &path, bool &issource) const;
+	//True if the file is the one in the entry, even though its time may not be
+	bool IsSame(const wxFileName &path, const FileState &state, const FileState &base, const Entry &entry) const;
+	//The hash of a file, from the cache if it hasn't changed since
+	bool Hash(const wxFileName &path, unsigned long long &hash) const;
+
+	wxString m_Path;
+	wxString m_Job;
+	wxString m_Source;
+	wxString m_Dest;
+	bool m_Full;
+	const CancelToken *m_Cancel;
+	std::map<wxString, Entry> m_Entries;
+	std::map<wxString, Entry> m_Seen;
+};
+
+//Copy decisions made while previewing, so that running the job straight 
+//afterwards doesn't have to compare all of the files again. Only a preview
+//remembers them and they are cleared once the run after it is over
+namespace SyncDecisions{
+	void Remember(const wxFileName &source, const wxFileName &dest, int checks, bool copy);
+	//Only succeeds if the checks are the same and neither file has changed
+	bool Recall(const wxFileName &source, const wxFileName &dest, int checks, bool &copy);
+	void Clear();
+}
+
+//The content hashes of files we have read in full, so later comparisons of
+//the same unchanged files don't have to read them again
+namespace HashCache{
+	void Remember(const wxFileName &path, unsigned long long hash);
+	//With the identity the file had before it was read, so a change while it
+	//was being read isn't missed
+	void Remember(const wxFileName &path, const FileIdentity &identity, unsigned long long hash);
+	//Only succeeds if the file hasn't changed since it was hashed
+	bool Recall(const wxFileName &path, unsigned long long &hash);
+}
+
+#endif
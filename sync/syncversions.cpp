@@ -0,0 +1,168 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "syncversions.h"
+#include "../fileops.h"
+#include "../cancel.h"
+#include <vector>
+#include <memory>
+#include <wx/dir.h>
+#include <wx/datetime.h>
+#include <wx/thread.h>
+
+const wxString SyncVersions::FolderName = wxT(".toucan-versions");
+
+namespace{
+	//Days are removed by a few threads at once as most of the time goes on
+	//waiting for the filesystem
+	const size_t prunethreads = 4;
+
+	bool IsCancelled(const CancelToken *cancel){
+		return cancel && cancel->IsCancelled();
+	}
+
+	bool RemoveTree(const wxString &folder, const CancelToken *cancel){
+		wxArrayString files, folders;
+		{
+			wxDir dir(folder);
+			if(!dir.IsOpened()){
+				return false;
+			}
+			wxString name;
+			for(bool found = dir.GetFirst(&name, wxEmptyString, wxDIR_FILES | wxDIR_HIDDEN); found; found = dir.GetNext(&name)){
+				files.Add(name);
+			}
+			for(bool found = dir.GetFirst(&name, wxEmptyString, wxDIR_DIRS | wxDIR_HIDDEN); found; found = dir.GetNext(&name)){
+				folders.Add(name);
+			}
+		}
+		bool ok = true;
+		for(size_t i = 0; i < files.GetCount(); i++){
+			if(IsCancelled(cancel)){
+				return false;
+			}
+			ok = wxRemoveFile(folder + wxFILE_SEP_PATH + files[i]) && ok;
+		}
+		for(size_t i = 0; i < folders.GetCount(); i++){
+			ok = RemoveTree(folder + wxFILE_SEP_PATH + folders[i], cancel) && ok;
+		}
+		return ok && wxRmdir(folder);
+	}
+
+	//Takes days off the shared list until there are none left
+	class Pruner : public wxThread{
+	public:
+		Pruner(wxMutex &listmutex, wxArrayString &listdays, size_t &listremoved, const CancelToken *prunecancel)
+		    : wxThread(wxTHREAD_JOINABLE), mutex(listmutex), days(listdays), removed(listremoved), cancel(prunecancel)
+		{}
+
+		void Prune(){
+			for(;;){
+				wxString day;
+				{
+					wxMutexLocker lock(mutex);
+					if(days.IsEmpty() || IsCancelled(cancel)){
+						return;
+					}
+					day = days.Last();
+					days.RemoveAt(days.GetCount() - 1);
+				}
+				if(RemoveTree(day, cancel)){
+					wxMutexLocker lock(mutex);
+					removed++;
+				}
+			}
+		}
+
+	protected:
+		virtual void* Entry(){
+			Prune();
+			return NULL;
+		}
+
+	private:
+		wxMutex &mutex;
+		wxArrayString &days;
+		size_t &removed;
+		const CancelToken *cancel;
+	};
+}
+
+SyncVersions::SyncVersions(const wxFileName &destroot){
+	m_Root = destroot.GetPathWithSep();
+	//Taken once so a job running past midnight keeps to one day
+	m_Today = m_Root + FolderName + wxFILE_SEP_PATH + wxDateTime::Now().FormatISODate() + wxFILE_SEP_PATH;
+}
+
+bool SyncVersions::Contains(const wxFileName &path) const{
+	wxString fullpath = path.GetFullPath();
+	return fullpath.length() > m_Root.length() &&
+	       (wxFileName::IsCaseSensitive() ? fullpath.StartsWith(m_Root) : fullpath.Lower().StartsWith(m_Root.Lower()));
+}
+
+bool SyncVersions::GetVersionPath(const wxFileName &path, FolderCache &folders, wxFileName &version) const{
+	version = wxFileName(m_Today + path.GetFullPath().Mid(m_Root.length()));
+	//A file changed more than once in a day keeps each of its versions
+	wxString name = version.GetName();
+	for(int i = 2; version.FileExists(); i++){
+		version.SetName(name + wxString::Format(wxT(" (%d)"), i));
+	}
+	return folders.Create(wxFileName::DirName(version.GetPath()));
+}
+
+bool SyncVersions::Keep(const wxFileName &path, FolderCache &folders) const{
+	wxFileName version;
+	return GetVersionPath(path, folders, version) && folders.Rename(path, version);
+}
+
+bool SyncVersions::KeepLinked(const wxFileName &path, FolderCache &folders, wxFileName &version) const{
+	if(!GetVersionPath(path, folders, version)){
+		return false;
+	}
+	//Renaming the new copy over the file then leaves the link as the only
+	//name for the old contents. Not every filesystem has links, so there it
+	//costs a copy
+	return File::Link(path, version) || File::Copy(path, version, false, NULL, File::KeepTimes);
+}
+
+size_t SyncVersions::Prune(const wxFileName &destroot, long days, const CancelToken *cancel){
+	wxString folder = destroot.GetPathWithSep() + FolderName;
+	wxDir dir(folder);
+	if(days <= 0 || !dir.IsOpened()){
+		return 0;
+	}
+	wxDateTime cutoff = wxDateTime::Today() - wxDateSpan::Days(days);
+	wxArrayString old;
+	wxString name;
+	for(bool found = dir.GetFirst(&name, wxEmptyString, wxDIR_DIRS | wxDIR_HIDDEN); found; found = dir.GetNext(&name)){
+		//Anything that isn't one of our days is left alone
+		wxDateTime day;
+		if(day.ParseISODate(name) && day < cutoff){
+			old.Add(folder + wxFILE_SEP_PATH + name);
+		}
+	}
+
+	wxMutex mutex;
+	size_t removed = 0;
+	std::vector<std::unique_ptr<Pruner> > pruners;
+	for(size_t i = 0; i < prunethreads && i < old.GetCount(); i++){
+		pruners.push_back(std::unique_ptr<Pruner>(new Pruner(mutex, old, removed, cancel)));
+		if(pruners.back()->Create() != wxTHREAD_NO_ERROR || pruners.back()->Run() != wxTHREAD_NO_ERROR){
+			pruners.pop_back();
+			break;
+		}
+	}
+	//Whatever the threads don't get to, including if none could start
+	Pruner(mutex, old, removed, cancel).Prune();
+	for(size_t i = 0; i < pruners.size(); i++){
+		pruners[i]->Wait();
+	}
+	return removed;
+}
+
+bool SyncVersions::IsVersionsFolder(const wxString &name){
+	return wxFileName::IsCaseSensitive() ? name == FolderName : name.IsSameAs(FolderName, false);
+}
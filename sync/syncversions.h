@@ -0,0 +1,52 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_SYNCVERSIONS
+#define H_SYNCVERSIONS
+
+class FolderCache;
+class CancelToken;
+
+#include <wx/string.h>
+#include <wx/filename.h>
+
+//Keeps the old copies of files that a sync overwrites or removes. They are
+//renamed or linked rather than copied into a folder for the day at the top 
+//of the destination, keeping the rest of their path, so keeping them costs 
+//nothing
+class SyncVersions{
+
+public:
+	SyncVersions(const wxFileName &destroot);
+
+	//True if the path is under the destination these versions are kept for
+	bool Contains(const wxFileName &path) const;
+	//Moves the file into today's folder, alongside any earlier version from
+	//the same day
+	bool Keep(const wxFileName &path, FolderCache &folders) const;
+	//The same for a file that is about to be replaced, but the file stays 
+	//where it is until it is, so a failed replace loses nothing. version is
+	//set to where it was kept
+	bool KeepLinked(const wxFileName &path, FolderCache &folders, wxFileName &version) const;
+
+	//Removes the days that are older than the given number of days, several
+	//at a time, until the token is cancelled. Returns how many days were 
+	//removed
+	static size_t Prune(const wxFileName &destroot, long days, const CancelToken *cancel = NULL);
+
+	//The folder at the top of the destination, the sync never touches it
+	static bool IsVersionsFolder(const wxString &name);
+	static const wxString FolderName;
+
+private:
+	//Where the next version of the path goes, with the folders made for it
+	bool GetVersionPath(const wxFileName &path, FolderCache &folders, wxFileName &version) const;
+
+	wxString m_Root;
+	wxString m_Today;
+};
+
+#endif
@@ -0,0 +1,50 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <chrono>
+#include "../cancel.h"
+
+TEST(CancelToken, Callbacks){
+    CancelToken token;
+    int called = 0;
+    unsigned long id = token.Register([&called](){called++;});
+    {
+        CancelCallback scoped(token, [&called](){called += 10;});
+    }
+    EXPECT_FALSE(token.IsCancelled());
+    token.Cancel();
+    token.Cancel();
+    EXPECT_TRUE(token.IsCancelled());
+    //Only the one still registered, and only once
+    EXPECT_EQ(1, called);
+    token.Unregister(id);
+
+    //Too late to wait for it so it is run straight away
+    token.Register([&called](){called += 100;});
+    EXPECT_EQ(101, called);
+
+    token.Reset();
+    EXPECT_FALSE(token.IsCancelled());
+}
+
+TEST(CancelToken, Sleep){
+    CancelToken token;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(token.Sleep(50));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(45));
+
+    //A cancel from elsewhere wakes us well before the time is up
+    std::thread canceller([&token](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        token.Cancel();
+    });
+    start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(token.Sleep(10000));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(250));
+    canceller.join();
+}
@@ -0,0 +1,53 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include "../sync/concurrency.h"
+
+TEST(ConcurrencyController, Limits){
+    ConcurrencyController controller("Test", 2, 8, 100);
+    EXPECT_EQ(8u, controller.GetLimit());
+    ConcurrencyController low("Test", 0, 8, 0);
+    EXPECT_EQ(1u, low.GetLimit());
+}
+
+TEST(ConcurrencyController, RampsWhileFaster){
+    ConcurrencyController controller("Test", 1, 16, 2);
+    //Each batch of 1000 gets quicker as we add workers and latency holds
+    double elapsed = 1.0;
+    size_t limit = controller.Update(1000, elapsed, 0.002);
+    EXPECT_EQ(3u, limit);
+    for(int i = 0; i < 5; i++){
+        elapsed /= 1.5;
+        size_t next = controller.Update(1000, elapsed, 0.002);
+        EXPECT_EQ(limit + 1, next);
+        limit = next;
+    }
+    //Once it stops getting faster it holds
+    EXPECT_EQ(limit, controller.Update(1000, elapsed, 0.002));
+}
+
+TEST(ConcurrencyController, BacksOffOnLatency){
+    ConcurrencyController controller("Test", 1, 64, 8);
+    controller.Update(1000, 1.0, 0.001);
+    size_t limit = controller.GetLimit();
+    //Operations taking much longer means the device is queueing
+    EXPECT_EQ(limit / 2, controller.Update(1000, 1.0, 0.005));
+}
+
+TEST(ConcurrencyController, BacksOffWhenSlower){
+    ConcurrencyController controller("Test", 1, 64, 8);
+    controller.Update(1000, 1.0, 0.001);
+    size_t limit = controller.GetLimit();
+    EXPECT_EQ(limit / 2, controller.Update(1000, 2.0, 0.001));
+    //Never below the minimum
+    double elapsed = 2.0;
+    for(int i = 0; i < 10; i++){
+        elapsed *= 2;
+        controller.Update(1000, elapsed, 0.001);
+    }
+    EXPECT_EQ(1u, controller.GetLimit());
+}
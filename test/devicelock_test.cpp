@@ -0,0 +1,91 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include "../cancel.h"
+#include "../devicelock.h"
+#include "tempfolder.h"
+
+namespace{
+    class DeviceLockTest : public testing::Test{
+    protected:
+        virtual void SetUp(){
+            //Made by the first lock
+            lockdir = temp.GetPath() + "locks";
+        }
+
+        std::set<wxString> Disks(const wxString &first, const wxString &second = wxEmptyString){
+            std::set<wxString> ids;
+            ids.insert(first);
+            if(!second.IsEmpty()){
+                ids.insert(second);
+            }
+            return ids;
+        }
+
+        TempFolder temp;
+        wxString lockdir;
+        CancelToken cancel;
+    };
+}
+
+TEST_F(DeviceLockTest, SameDisk){
+    std::atomic<bool> waited(false);
+    std::atomic<bool> locked(false);
+    std::unique_ptr<DeviceLock> first(new DeviceLock(Disks("sda"), lockdir, cancel));
+    std::thread second([&](){
+        DeviceLock lock(Disks("sda"), lockdir, cancel, [&waited](const wxString&){waited = true;});
+        locked = true;
+    });
+    while(!waited){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    //Still waiting for a while after it started to
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(locked);
+    first.reset();
+    second.join();
+    EXPECT_TRUE(locked);
+}
+
+TEST_F(DeviceLockTest, OtherDisk){
+    bool waited = false;
+    DeviceLock first(Disks("sda"), lockdir, cancel);
+    DeviceLock second(Disks("sdb"), lockdir, cancel, [&waited](const wxString&){waited = true;});
+    EXPECT_FALSE(waited);
+}
+
+TEST_F(DeviceLockTest, SharedDisk){
+    //Only one of the disks is in use, that is enough to wait for
+    wxString waitedfor;
+    DeviceLock first(Disks("sda"), lockdir, cancel);
+    CancelToken stop;
+    std::thread canceller([&stop](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        stop.Cancel();
+    });
+    DeviceLock second(Disks("sda", "sdb"), lockdir, stop, [&waitedfor](const wxString &id){waitedfor = id;});
+    canceller.join();
+    EXPECT_EQ("sda", waitedfor);
+}
+
+TEST_F(DeviceLockTest, Cancelled){
+    {
+        DeviceLock first(Disks("sda"), lockdir, cancel);
+        CancelToken stop;
+        stop.Cancel();
+        //Gives up rather than waiting for ever
+        DeviceLock second(Disks("sda"), lockdir, stop);
+    }
+    //Nothing is left held by the lock that gave up
+    bool waited = false;
+    DeviceLock third(Disks("sda"), lockdir, cancel, [&waited](const wxString&){waited = true;});
+    EXPECT_FALSE(waited);
+}
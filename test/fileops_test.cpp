@@ -0,0 +1,97 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <wx/datetime.h>
+#include <wx/filename.h>
+#include "../cancel.h"
+#include "../fileops.h"
+#include "tempfolder.h"
+
+TEST(WriteBarrier, File){
+    TempFolder temp;
+    wxFileName file(temp.GetPath(), "file.txt");
+    TempFolder::Write(file.GetFullPath(), "contents");
+    WriteBarrier barrier(Durability::File);
+    EXPECT_TRUE(barrier.Written(file));
+    EXPECT_TRUE(barrier.Commit());
+    //Its folder can't be flushed if it isn't there
+    EXPECT_FALSE(barrier.Written(wxFileName(temp.GetPath() + "missing", "file.txt")));
+}
+
+TEST(WriteBarrier, Group){
+    TempFolder temp;
+    wxFileName file(temp.GetPath(), "file.txt");
+    TempFolder::Write(file.GetFullPath(), "contents");
+    WriteBarrier barrier(Durability::Group);
+    EXPECT_TRUE(barrier.IsFlushed());
+    EXPECT_TRUE(barrier.Written(file));
+    EXPECT_FALSE(barrier.IsFlushed());
+    EXPECT_TRUE(barrier.Commit());
+    EXPECT_TRUE(barrier.IsFlushed());
+    //Nothing left to flush
+    EXPECT_TRUE(barrier.Commit());
+}
+
+TEST(WriteBarrier, None){
+    TempFolder temp;
+    wxFileName file(temp.GetPath(), "file.txt");
+    TempFolder::Write(file.GetFullPath(), "contents");
+    WriteBarrier barrier(Durability::None);
+    EXPECT_TRUE(barrier.Written(file));
+    EXPECT_TRUE(barrier.Commit());
+}
+
+#ifndef __WXMSW__
+TEST(FolderCache, CopyTimes){
+    //More folders than are kept open, so each copy has to make room
+    TempFolder temp;
+    FolderCache folders;
+    wxDateTime older(static_cast<time_t>(1000)), newer(static_cast<time_t>(5000));
+    for(int i = 0; i < 200; i++){
+        wxFileName source(temp.GetPath() + wxString::Format("source%d", i), "file.txt");
+        wxFileName dest(temp.GetPath() + wxString::Format("dest%d", i), "file.txt");
+        ASSERT_TRUE(folders.Create(wxFileName::DirName(source.GetPath())));
+        ASSERT_TRUE(folders.Create(wxFileName::DirName(dest.GetPath())));
+        TempFolder::Write(source.GetFullPath(), "");
+        TempFolder::Write(dest.GetFullPath(), "");
+        source.SetTimes(&older, &older, NULL);
+        dest.SetTimes(&newer, &newer, NULL);
+        ASSERT_TRUE(folders.CopyTimes(source, dest));
+        wxDateTime modified;
+        ASSERT_TRUE(dest.GetTimes(NULL, &modified, NULL));
+        EXPECT_EQ(older, modified) << i;
+    }
+}
+#endif
+
+TEST(File, CopyErrors){
+    TempFolder temp;
+    wxFileName file(temp.GetPath(), "file.txt");
+    TempFolder::Write(file.GetFullPath(), "contents");
+    std::vector<wxFileName> dests;
+    dests.push_back(wxFileName(temp.GetPath(), "copy.txt"));
+    dests.push_back(wxFileName(temp.GetPath() + "missing", "copy.txt"));
+    std::vector<int> errors;
+    ASSERT_TRUE(File::Copy(file, dests, errors) != 0);
+    ASSERT_EQ(2u, errors.size());
+    EXPECT_EQ(0, errors[0]);
+    //Each destination says why it failed
+    EXPECT_GT(errors[1], 0);
+}
+
+TEST(File, CopyCancelled){
+    TempFolder temp;
+    wxFileName file(temp.GetPath(), "file.txt");
+    TempFolder::Write(file.GetFullPath(), "contents");
+    std::vector<wxFileName> dests(1, wxFileName(temp.GetPath(), "copy.txt"));
+    std::vector<int> errors;
+    CancelToken cancel;
+    cancel.Cancel();
+    EXPECT_FALSE(File::Copy(file, dests, errors, false, NULL, 0, &cancel) != 0);
+    ASSERT_EQ(1u, errors.size());
+    EXPECT_EQ(-1, errors[0]);
+}
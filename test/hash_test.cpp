@@ -0,0 +1,52 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+#include "../hash.h"
+
+namespace{
+    unsigned long long Hash(const std::string &data){
+        ContentHash hash;
+        hash.Update(data.data(), data.length());
+        return hash.GetValue();
+    }
+}
+
+TEST(ContentHash, KnownValues){
+    EXPECT_EQ(0xEF46DB3751D8E999ULL, Hash(""));
+    EXPECT_EQ(0xD24EC4F1A98C6E5BULL, Hash("a"));
+    EXPECT_EQ(0x44BC2CF5AD770999ULL, Hash("abc"));
+    EXPECT_EQ(0xFBCEA83C8A378BF1ULL, Hash("Nobody inspects the spammish repetition"));
+}
+
+TEST(ContentHash, Pieces){
+    //However the data is split up the hash must be the same
+    std::string data;
+    for(int i = 0; i < 1000; i++){
+        data += static_cast<char>(i * 7);
+    }
+    unsigned long long whole = Hash(data);
+    const size_t sizes[] = {1, 3, 31, 32, 33, 100};
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++){
+        ContentHash hash;
+        for(size_t pos = 0; pos < data.length(); pos += sizes[i]){
+            hash.Update(data.data() + pos, std::min(sizes[i], data.length() - pos));
+        }
+        EXPECT_EQ(whole, hash.GetValue()) << "Pieces of " << sizes[i];
+    }
+}
+
+TEST(ContentHash, Reset){
+    ContentHash hash;
+    hash.Update("abc", 3);
+    hash.Reset();
+    hash.Update("a", 1);
+    EXPECT_EQ(Hash("a"), hash.GetValue());
+    EXPECT_EQ(wxString("d24ec4f1a98c6e5b"), ContentHash::ToString(hash.GetValue()));
+}
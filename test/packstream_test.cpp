@@ -0,0 +1,137 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <vector>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include "../sync/packstream.h"
+#include "tempfolder.h"
+
+namespace{
+    //A source file bigger than a chunk and a pack of it along with a folder
+    //and a removal
+    class PackStreamTest : public testing::Test{
+    protected:
+        virtual void SetUp(){
+            source = temp.GetPath() + "source";
+            pack = temp.GetPath() + "pack";
+            contents = temp.GetPath() + "contents";
+            wxFile file(source, wxFile::write);
+            for(int i = 0; i < 200000; i++){
+                file.Write(wxString::Format("line %d\n", i));
+            }
+            file.Close();
+        }
+
+        void Write(bool finish = true){
+            wxFile out(pack, wxFile::write);
+            wxFile in(source, wxFile::read);
+            PackWriter writer(out.fd(), true);
+            ASSERT_TRUE(writer.WriteHeader());
+            writer.WriteFolder("folder/", 100);
+            PackRecord record;
+            record.type = PackFile;
+            record.path = "folder/file.txt";
+            record.size = in.Length();
+            record.modified = 200;
+            record.mode = 0644;
+            ASSERT_TRUE(writer.WriteFile(record, in));
+            writer.WriteRemove("old.txt");
+            if(finish){
+                ASSERT_TRUE(writer.Finish());
+            }
+        }
+
+        //Reads the whole pack, writing the file's contents out
+        bool Read(PackReader &reader, std::vector<PackRecord> &records){
+            wxFile out(contents, wxFile::write);
+            if(!reader.ReadHeader()){
+                return false;
+            }
+            PackRecord record;
+            while(reader.Next(record)){
+                records.push_back(record);
+                if(record.type == PackFile && !reader.ReadContents(&out)){
+                    return false;
+                }
+            }
+            return reader.IsFinished();
+        }
+
+        void Damage(wxFileOffset offset){
+            wxFile file(pack, wxFile::read_write);
+            char byte;
+            file.Seek(offset);
+            file.Read(&byte, 1);
+            byte ^= 0x55;
+            file.Seek(offset);
+            file.Write(&byte, 1);
+        }
+
+        TempFolder temp;
+        wxString source;
+        wxString pack;
+        wxString contents;
+    };
+}
+
+TEST_F(PackStreamTest, RoundTrip){
+    Write();
+    wxFile in(pack, wxFile::read);
+    PackReader reader(in.fd());
+    std::vector<PackRecord> records;
+    ASSERT_TRUE(Read(reader, records));
+    EXPECT_TRUE(reader.GetError().IsEmpty());
+    ASSERT_EQ(3u, records.size());
+    EXPECT_EQ(PackFolder, records[0].type);
+    EXPECT_EQ("folder/", records[0].path);
+    EXPECT_EQ(100, records[0].modified);
+    EXPECT_EQ(PackFile, records[1].type);
+    EXPECT_EQ("folder/file.txt", records[1].path);
+    EXPECT_EQ(200, records[1].modified);
+    EXPECT_EQ(0644u, records[1].mode);
+    EXPECT_EQ(PackRemove, records[2].type);
+    EXPECT_EQ("old.txt", records[2].path);
+
+    wxFile original(source, wxFile::read), copy(contents, wxFile::read);
+    ASSERT_EQ(original.Length(), copy.Length());
+    std::vector<char> first(original.Length()), second(copy.Length());
+    original.Read(&first[0], first.size());
+    copy.Read(&second[0], second.size());
+    EXPECT_TRUE(first == second);
+}
+
+TEST_F(PackStreamTest, Damaged){
+    Write();
+    //Somewhere in the middle of the file's contents
+    Damage(wxFile(pack).Length() / 2);
+    wxFile in(pack, wxFile::read);
+    PackReader reader(in.fd());
+    std::vector<PackRecord> records;
+    EXPECT_FALSE(Read(reader, records));
+    EXPECT_FALSE(reader.IsFinished());
+    EXPECT_FALSE(reader.GetError().IsEmpty());
+}
+
+TEST_F(PackStreamTest, Unfinished){
+    Write(false);
+    wxFile in(pack, wxFile::read);
+    PackReader reader(in.fd());
+    std::vector<PackRecord> records;
+    EXPECT_FALSE(Read(reader, records));
+    //The removal was still buffered when the writer went away
+    EXPECT_EQ(2u, records.size());
+    EXPECT_FALSE(reader.IsFinished());
+}
+
+TEST_F(PackStreamTest, NotAPack){
+    wxFile in(source, wxFile::read);
+    PackReader reader(in.fd());
+    EXPECT_FALSE(reader.ReadHeader());
+    EXPECT_FALSE(reader.GetError().IsEmpty());
+}
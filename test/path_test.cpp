@@ -5,6 +5,7 @@
 /////////////////////////////////////////////////////////////////////////////////
 
 #include <gtest/gtest.h>
+#include <wx/fileconf.h>
 #include "../path.h"
 
 TEST(PathNormalise, Date){
@@ -61,3 +62,34 @@ TEST(PathNormalise, Plain){
 TEST(PathNormalise, DoesntExist){
     EXPECT_EQ(Path::Normalise("C:\\thisisa@test@\\path.doc"), "C:\\thisisa@test@\\path.doc");
 }
+
+TEST(PathNormalise, Variables){
+    const wxString dir = wxFileName::GetTempDir() + wxFILE_SEP_PATH;
+    Locations::SetSettingsPath(dir);
+    {
+        wxFileConfig config("", "", dir + "variables.ini");
+        config.Write("testvar/" + _("Other"), "expanded");
+        config.Write("nested/" + _("Other"), "@testvar@-@YYYY@");
+    }
+    Path::InvalidateVariables();
+    EXPECT_EQ(Path::Normalise("@testvar@"), "expanded");
+    EXPECT_EQ(Path::Normalise("@nested@"), "expanded-" + wxDateTime::Now().Format("%Y"));
+
+    //Changes to the file must be picked up
+    {
+        wxFileConfig config("", "", dir + "variables.ini");
+        config.Write("testvar/" + _("Other"), "changed");
+    }
+    Path::InvalidateVariables();
+    EXPECT_EQ(Path::Normalise("@testvar@"), "changed");
+
+    wxRemoveFile(dir + "variables.ini");
+    Locations::SetSettingsPath(wxEmptyString);
+    Path::InvalidateVariables();
+}
+
+TEST(PathNormalise, Cached){
+    //The second call comes from the compiled cache and must give the same result
+    EXPECT_EQ(Path::Normalise("C:\\@YYYY@\\@@date@.zip"), Path::Normalise("C:\\@YYYY@\\@@date@.zip"));
+    EXPECT_EQ(Path::Normalise("C:\\@YYYY@\\@@date@.zip"), "C:\\" + wxDateTime::Now().Format("%Y") + "\\@" + wxDateTime::Now().FormatISODate() + ".zip");
+}
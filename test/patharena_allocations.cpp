@@ -0,0 +1,72 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "../sync/patharena.h"
+
+namespace{
+    //Counts the allocations made so we can see what adding a path to the 
+    //arena costs. This is its own binary as replacing operator new would
+    //change allocation for every other test
+    unsigned long allocations = 0;
+}
+
+void* operator new(std::size_t size){
+    allocations++;
+    void *ptr = std::malloc(size ? size : 1);
+    if(!ptr){
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept{
+    std::free(ptr);
+}
+
+TEST(PathArena, AllocationsPerFile){
+    const int count = 100000;
+    std::vector<wxString> names;
+    std::vector<PathArena::NativeString> nativenames;
+    for(int i = 0; i < count; i++){
+        names.push_back(wxString::Format("file%d.txt", i));
+        nativenames.push_back(PathArena::ToNative(names.back()));
+    }
+    PathArena arena;
+    PathArena::Node folder = arena.Add(PathArena::Root, "folder");
+    PathArena::NativeString path;
+    //Walk a tree of folders of 100 files each, as a sync would, building the
+    //full path of each file from the names as they came from the filesystem
+    unsigned long before = allocations;
+    for(int i = 0; i < count; i += 100){
+        PathArena::Node mark = arena.GetMark();
+        for(int j = i; j < i + 100; j++){
+            PathArena::Node node = arena.Add(folder, nativenames[j].data(), nativenames[j].length());
+            path.assign(nativenames[0]);
+            arena.AppendName(node, path);
+        }
+        arena.Release(mark);
+    }
+    double native = double(allocations - before) / count;
+    //The same but going through wxString as we used to
+    before = allocations;
+    for(int i = 0; i < count; i += 100){
+        PathArena::Node mark = arena.GetMark();
+        for(int j = i; j < i + 100; j++){
+            PathArena::Node node = arena.Add(folder, names[j]);
+            wxString full = names[0] + arena.GetName(node);
+        }
+        arena.Release(mark);
+    }
+    double converted = double(allocations - before) / count;
+    RecordProperty("NativeAllocationsPerFile", wxString::Format("%f", native).ToStdString());
+    RecordProperty("ConvertedAllocationsPerFile", wxString::Format("%f", converted).ToStdString());
+    EXPECT_LT(native, 0.01);
+    EXPECT_LT(native, converted);
+}
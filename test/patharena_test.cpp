@@ -0,0 +1,56 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <wx/filefn.h>
+#include "../sync/patharena.h"
+
+TEST(PathArena, Paths){
+    PathArena arena;
+    PathArena::Node folder = arena.Add(PathArena::Root, "folder");
+    PathArena::Node file = arena.Add(folder, "file.txt", 2);
+    EXPECT_EQ(arena.GetName(file), "file.txt");
+    EXPECT_EQ(arena.GetPath(file), wxString("folder") + wxFILE_SEP_PATH + "file.txt");
+    EXPECT_EQ(arena.GetParent(file), folder);
+    EXPECT_EQ(arena.GetTag(file), 2);
+    EXPECT_EQ(arena.GetPath(PathArena::Root), "");
+}
+
+TEST(PathArena, Compare){
+    PathArena arena;
+    PathArena::Node a = arena.Add(PathArena::Root, "abc");
+    PathArena::Node b = arena.Add(PathArena::Root, "ABC");
+    PathArena::Node c = arena.Add(PathArena::Root, "abcd");
+    EXPECT_NE(arena.Compare(a, b, true), 0);
+    EXPECT_EQ(arena.Compare(a, b, false), 0);
+    EXPECT_LT(arena.Compare(a, c, true), 0);
+    EXPECT_GT(arena.Compare(c, a, true), 0);
+}
+
+TEST(PathArena, Release){
+    PathArena arena;
+    PathArena::Node folder = arena.Add(PathArena::Root, "folder");
+    PathArena::Node mark = arena.GetMark();
+    arena.Add(folder, "one");
+    arena.Add(folder, "two");
+    EXPECT_EQ(arena.GetCount(), 3u);
+    arena.Release(mark);
+    EXPECT_EQ(arena.GetCount(), 1u);
+    //Space is reused after a release
+    PathArena::Node three = arena.Add(folder, "three");
+    EXPECT_EQ(three, mark);
+    EXPECT_EQ(arena.GetPath(three), wxString("folder") + wxFILE_SEP_PATH + "three");
+}
+
+TEST(PathArena, Native){
+    PathArena arena;
+    wxString name = "readme.txt";
+    PathArena::Node node = arena.Add(PathArena::Root, name);
+    EXPECT_EQ(arena.GetName(node), name);
+    PathArena::NativeString path;
+    arena.AppendName(node, path);
+    EXPECT_EQ(PathArena::ToString(path.data(), path.length()), name);
+}
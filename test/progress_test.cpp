@@ -0,0 +1,78 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include "../progress.h"
+
+TEST(Throughput, FirstSample){
+    ThroughputEstimator estimator;
+    estimator.Update(0, 0, 0, 0);
+    EXPECT_EQ(estimator.GetEta(0, 10, 0, 1000), -1);
+    estimator.Update(1, 2, 100, 100);
+    EXPECT_DOUBLE_EQ(estimator.GetFilesPerSecond(), 2);
+    EXPECT_DOUBLE_EQ(estimator.GetBytesPerSecond(), 100);
+}
+
+TEST(Throughput, Smoothing){
+    ThroughputEstimator estimator(5.0);
+    estimator.Update(0, 0, 0, 0);
+    estimator.Update(1, 0, 100, 100);
+    //A sudden jump is only partly taken into account
+    estimator.Update(2, 0, 1100, 1100);
+    EXPECT_GT(estimator.GetBytesPerSecond(), 100);
+    EXPECT_LT(estimator.GetBytesPerSecond(), 1000);
+}
+
+TEST(Throughput, Eta){
+    ThroughputEstimator estimator;
+    estimator.Update(0, 0, 0, 0);
+    estimator.Update(1, 1, 100, 100);
+    //Bytes win over files when we have them
+    EXPECT_EQ(estimator.GetEta(1, 2, 100, 10100), 100);
+    //Otherwise we fall back to counting files
+    EXPECT_EQ(estimator.GetEta(1, 101, 0, 0), 100);
+    EXPECT_EQ(estimator.GetEta(11, 11, 10100, 10100), 0);
+}
+
+TEST(Throughput, Reset){
+    ThroughputEstimator estimator;
+    estimator.Update(0, 0, 0, 0);
+    estimator.Update(1, 5, 500, 500);
+    estimator.Reset();
+    EXPECT_DOUBLE_EQ(estimator.GetFilesPerSecond(), 0);
+    EXPECT_EQ(estimator.GetEta(0, 10, 0, 1000), -1);
+}
+
+TEST(Progress, Fraction){
+    Progress::Status status = Progress::Status();
+    EXPECT_DOUBLE_EQ(status.GetFraction(), -1);
+    status.files = 5;
+    status.totalfiles = 10;
+    EXPECT_DOUBLE_EQ(status.GetFraction(), 0.5);
+    //One large file outweighs the count
+    status.processed = 900;
+    status.totalbytes = 1000;
+    EXPECT_DOUBLE_EQ(status.GetFraction(), 0.9);
+    //The count may lag behind the job
+    status.processed = 2000;
+    EXPECT_DOUBLE_EQ(status.GetFraction(), 1);
+}
+
+TEST(Progress, Totals){
+    Progress::Begin();
+    EXPECT_TRUE(Progress::IsRunning());
+    Progress::SetTotal(4, 400);
+    Progress::AddFiles(2);
+    Progress::AddBytes(100);
+    Progress::SkipBytes(100);
+    Progress::Status status = Progress::Sample();
+    EXPECT_EQ(status.files, 2u);
+    EXPECT_EQ(status.bytes, 100u);
+    EXPECT_EQ(status.processed, 200u);
+    EXPECT_DOUBLE_EQ(status.GetFraction(), 0.5);
+    Progress::End();
+    EXPECT_FALSE(Progress::IsRunning());
+}
@@ -0,0 +1,55 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <string>
+#include "../progressevent.h"
+
+TEST(ProgressEvent, RoundTrip){
+    ProgressEvent event;
+    event.operation = EventRemoveFolder;
+    event.error = 13;
+    event.bytes = 5000000000ULL;
+    event.duration = 1234;
+    event.path = wxString::FromUTF8("/home/user/caf\xc3\xa9/");
+    std::string encoded = event.Encode();
+
+    ProgressEvent decoded;
+    ASSERT_TRUE(ProgressEvent::Decode(encoded.data(), encoded.size(), decoded));
+    EXPECT_EQ(EventRemoveFolder, decoded.operation);
+    EXPECT_EQ(13, decoded.error);
+    EXPECT_EQ(5000000000ULL, decoded.bytes);
+    EXPECT_EQ(1234u, decoded.duration);
+    EXPECT_EQ(event.path, decoded.path);
+    EXPECT_TRUE(decoded.Failed());
+}
+
+TEST(ProgressEvent, NotAnEvent){
+    //Plain messages go through the same queue and must be left alone
+    std::string message = "Copied /home/user/file.txt";
+    ProgressEvent event;
+    EXPECT_FALSE(ProgressEvent::Decode(message.data(), message.size(), event));
+    EXPECT_FALSE(ProgressEvent::Decode("", 0, event));
+}
+
+TEST(ProgressEvent, Format){
+    ProgressEvent event;
+    event.operation = EventCopy;
+    event.path = "/home/user/file.txt";
+    EXPECT_EQ("Copied /home/user/file.txt", event.Format());
+    //No system error to describe
+    event.error = -1;
+    EXPECT_EQ("Failed to copy /home/user/file.txt", event.Format());
+}
+
+TEST(ProgressEvent, Json){
+    ProgressEvent event;
+    event.operation = EventSkip;
+    event.bytes = 42;
+    event.path = "C:\\a \"quoted\"\tname";
+    EXPECT_EQ("{\"operation\":\"skip\",\"path\":\"C:\\\\a \\\"quoted\\\"\\u0009name\",\"error\":0,\"bytes\":42,\"duration\":0}",
+              event.ToJson());
+}
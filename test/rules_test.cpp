@@ -22,3 +22,36 @@ TEST(Rules, GetName){
     RuleSet blankname("");
     EXPECT_EQ(blankname.GetName(), "");
 }
+
+TEST(Rules, FindDecidingRule){
+    RuleSet rules("test");
+    rules.Add(Rule("keep", FileInclude, Simple));
+    rules.Add(Rule(".tmp", FileExclude, Simple));
+
+    RuleResult result;
+    EXPECT_EQ(rules.FindDecidingRule(wxFileName::FileName("/data/keep.tmp"), result), 0);
+    EXPECT_EQ(result, Included);
+    EXPECT_EQ(rules.FindDecidingRule(wxFileName::FileName("/data/other.tmp"), result), 1);
+    EXPECT_EQ(result, Excluded);
+    EXPECT_EQ(rules.FindDecidingRule(wxFileName::FileName("/data/other.txt"), result), -1);
+    EXPECT_EQ(result, NoMatch);
+}
+
+TEST(Rules, Profiling){
+    RuleSet rules("test");
+    rules.Add(Rule("keep", FileInclude, Simple));
+    rules.Add(Rule(".tmp", FileExclude, Simple));
+    rules.SetProfiling(true);
+    EXPECT_TRUE(rules.IsProfiling());
+
+    rules.Matches(wxFileName::FileName("/data/keep.tmp"));
+    rules.Matches(wxFileName::FileName("/data/other.tmp"));
+    rules.Matches(wxFileName::FileName("/data/other.txt"));
+
+    EXPECT_EQ(rules.GetStats().at(0).hits, 1u);
+    EXPECT_EQ(rules.GetStats().at(0).misses, 2u);
+    EXPECT_EQ(rules.GetStats().at(1).hits, 1u);
+    EXPECT_EQ(rules.GetStats().at(1).misses, 1u);
+    //A header, a line per rule and the unmatched count
+    EXPECT_EQ(rules.GetProfile().Count(), 4u);
+}
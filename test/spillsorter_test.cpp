@@ -0,0 +1,73 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <vector>
+#include <algorithm>
+#include "../sync/spillsorter.h"
+
+namespace{
+    std::vector<wxString> ReadAll(SpillSorter &sorter){
+        std::vector<wxString> names;
+        wxString name;
+        while(sorter.Next(name)){
+            names.push_back(name);
+        }
+        return names;
+    }
+}
+
+TEST(SpillSorter, InMemory){
+    SpillSorter sorter(100, true);
+    sorter.Add("c");
+    sorter.Add("a");
+    sorter.Add("b");
+    sorter.Finish();
+    EXPECT_FALSE(sorter.IsSpilled());
+    std::vector<wxString> names = ReadAll(sorter);
+    ASSERT_EQ(names.size(), 3u);
+    EXPECT_EQ(names[0], "a");
+    EXPECT_EQ(names[2], "c");
+}
+
+TEST(SpillSorter, Spilled){
+    //Small enough that there are more runs than we read at once
+    SpillSorter sorter(3, true);
+    std::vector<wxString> expected;
+    for(int i = 0; i < 200; i++){
+        wxString name = wxString::Format("file%d", (i * 37) % 200);
+        sorter.Add(name);
+        expected.push_back(name);
+    }
+    sorter.Finish();
+    EXPECT_TRUE(sorter.IsSpilled());
+    EXPECT_FALSE(sorter.IsFailed());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(ReadAll(sorter), expected);
+}
+
+TEST(SpillSorter, CaseInsensitive){
+    SpillSorter sorter(1, false);
+    sorter.Add("B");
+    sorter.Add("a");
+    sorter.Add("C");
+    sorter.Finish();
+    std::vector<wxString> names = ReadAll(sorter);
+    ASSERT_EQ(names.size(), 3u);
+    EXPECT_EQ(names[0], "a");
+    EXPECT_EQ(names[1], "B");
+    EXPECT_EQ(names[2], "C");
+}
+
+TEST(SpillSorter, Unicode){
+    SpillSorter sorter(1, true);
+    sorter.Add(wxString::FromUTF8("\xc3\xa9t\xc3\xa9"));
+    sorter.Add("ete");
+    sorter.Finish();
+    std::vector<wxString> names = ReadAll(sorter);
+    ASSERT_EQ(names.size(), 2u);
+    EXPECT_EQ(names[1], wxString::FromUTF8("\xc3\xa9t\xc3\xa9"));
+}
@@ -0,0 +1,124 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WXMSW__
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <thread>
+#include <memory>
+#include <algorithm>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include "../sync/syncagent.h"
+#include "../hash.h"
+#include "tempfolder.h"
+
+namespace{
+    bool NameLess(const SyncAgent::Entry &first, const SyncAgent::Entry &second){
+        return first.name < second.name;
+    }
+
+    //An agent answering on the other end of a pair of pipes
+    class SyncAgentTest : public testing::Test{
+    protected:
+        virtual void SetUp(){
+            root = temp.GetPath();
+            wxMkdir(root + "folder");
+            wxFile file(root + "file.txt", wxFile::write);
+            for(int i = 0; i < 1000; i++){
+                file.Write(wxString::Format("line %d\n", i));
+            }
+            file.Close();
+
+            ASSERT_EQ(0, pipe(toagent));
+            ASSERT_EQ(0, pipe(fromagent));
+            server = std::thread([this](){
+                SyncAgent::Serve(toagent[0], fromagent[1]);
+                close(toagent[0]);
+                close(fromagent[1]);
+            });
+            agent.reset(new SyncAgent);
+            ASSERT_TRUE(agent->Attach(fromagent[0], toagent[1]));
+        }
+
+        virtual void TearDown(){
+            //Tells the agent to stop
+            agent.reset();
+            server.join();
+        }
+
+        TempFolder temp;
+        wxString root;
+        int toagent[2];
+        int fromagent[2];
+        std::thread server;
+        std::unique_ptr<SyncAgent> agent;
+    };
+}
+
+TEST_F(SyncAgentTest, List){
+    std::vector<SyncAgent::Entry> entries;
+    ASSERT_TRUE(agent->List(root, entries));
+    ASSERT_EQ(2u, entries.size());
+    std::sort(entries.begin(), entries.end(), NameLess);
+    EXPECT_EQ("file.txt", entries[0].name);
+    EXPECT_FALSE(entries[0].folder);
+    EXPECT_EQ(wxFileName::GetSize(root + "file.txt").GetValue(), entries[0].size);
+    EXPECT_EQ("folder", entries[1].name);
+    EXPECT_TRUE(entries[1].folder);
+
+    //A missing folder fails without losing the agent
+    EXPECT_FALSE(agent->List(root + "missing", entries));
+    EXPECT_TRUE(agent->IsOk());
+}
+
+TEST_F(SyncAgentTest, Stat){
+    SyncAgent::Entry entry;
+    ASSERT_TRUE(agent->Stat(root + "file.txt", entry));
+    EXPECT_EQ("file.txt", entry.name);
+    EXPECT_FALSE(entry.folder);
+    EXPECT_EQ(wxFileModificationTime(root + "file.txt"), entry.modified);
+    EXPECT_FALSE(agent->Stat(root + "missing", entry));
+    EXPECT_TRUE(agent->IsOk());
+}
+
+TEST_F(SyncAgentTest, Hash){
+    unsigned long long local, remote;
+    ASSERT_TRUE(ContentHash::File(root + "file.txt", local));
+    std::vector<unsigned long long> blocks;
+    ASSERT_TRUE(agent->Hash(root + "file.txt", 1024, remote, &blocks));
+    EXPECT_EQ(local, remote);
+    unsigned long long size = wxFileName::GetSize(root + "file.txt").GetValue();
+    EXPECT_EQ((size + 1023) / 1024, blocks.size());
+    EXPECT_FALSE(agent->Hash(root + "missing", 0, remote));
+}
+
+TEST(SyncAgent, NoHello){
+    //Something that never answers, like a shell waiting for a password
+    int toagent[2], fromagent[2];
+    ASSERT_EQ(0, pipe(toagent));
+    ASSERT_EQ(0, pipe(fromagent));
+    SyncAgent agent;
+    EXPECT_FALSE(agent.Attach(fromagent[0], toagent[1], 100));
+    EXPECT_FALSE(agent.IsOk());
+    close(toagent[0]);
+    close(fromagent[1]);
+}
+
+TEST(AgentChannel, Gone){
+    //Writing to an agent that has gone fails rather than killing us
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    close(fds[0]);
+    AgentChannel channel(-1, fds[1]);
+    channel.WriteByte(1);
+    EXPECT_FALSE(channel.Flush());
+    close(fds[1]);
+}
+
+#endif
@@ -0,0 +1,174 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <wx/datetime.h>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include "../hash.h"
+#include "../sync/syncstate.h"
+#include "tempfolder.h"
+
+namespace{
+    //A source and destination holding the same two files
+    class SyncBaselineTest : public testing::Test{
+    protected:
+        virtual void SetUp(){
+            root = temp.GetPath();
+            source = wxFileName::DirName(root + "source");
+            dest = wxFileName::DirName(root + "dest");
+            wxMkdir(source.GetFullPath());
+            wxMkdir(dest.GetFullPath());
+            path = root + "job.baseline";
+            for(int i = 0; i < 2; i++){
+                wxString name = wxString::Format("file%d.txt", i);
+                Write(Source(name), "contents");
+                Write(Dest(name), "contents");
+                SetTime(Source(name), 1000);
+                SetTime(Dest(name), 1000);
+            }
+        }
+
+        wxFileName Source(const wxString &name) {return wxFileName(source.GetPath(), name);}
+        wxFileName Dest(const wxString &name) {return wxFileName(dest.GetPath(), name);}
+
+        void Write(const wxFileName &file, const std::string &contents){
+            TempFolder::Write(file.GetFullPath(), contents);
+        }
+
+        void SetTime(const wxFileName &file, time_t time){
+            wxDateTime modified(time);
+            wxFileName(file).SetTimes(&modified, &modified, NULL);
+        }
+
+        SyncBaseline::Changes GetChanges(const SyncBaseline &baseline, const wxString &name){
+            return baseline.GetChanges(Source(name), FileState::Get(Source(name)), FileState::Get(Dest(name)));
+        }
+
+        //Records both files as synced and saves the baseline
+        void SyncAll(bool full = false){
+            SyncBaseline baseline(path, source, dest, full);
+            baseline.Synced(Source("file0.txt"), Dest("file0.txt"));
+            //Either order will do
+            baseline.Synced(Dest("file1.txt"), Source("file1.txt"));
+            ASSERT_TRUE(baseline.Save(true));
+        }
+
+        TempFolder temp;
+        wxString root;
+        wxFileName source;
+        wxFileName dest;
+        wxString path;
+    };
+}
+
+TEST_F(SyncBaselineTest, NotSeenBefore){
+    SyncBaseline baseline(path, source, dest, false);
+    EXPECT_EQ(SyncBaseline::BothChanged, GetChanges(baseline, "file0.txt"));
+}
+
+TEST_F(SyncBaselineTest, Unchanged){
+    SyncAll();
+    SyncBaseline baseline(path, source, dest, false);
+    EXPECT_EQ(SyncBaseline::Unchanged, GetChanges(baseline, "file0.txt"));
+    EXPECT_EQ(SyncBaseline::Unchanged, GetChanges(baseline, "file1.txt"));
+}
+
+TEST_F(SyncBaselineTest, OneSideChanged){
+    SyncAll();
+    Write(Source("file0.txt"), "changed contents");
+    Write(Dest("file1.txt"), "changed contents");
+    SyncBaseline baseline(path, source, dest, false);
+    EXPECT_EQ(SyncBaseline::SourceChanged, GetChanges(baseline, "file0.txt"));
+    EXPECT_EQ(SyncBaseline::DestChanged, GetChanges(baseline, "file1.txt"));
+}
+
+TEST_F(SyncBaselineTest, ChangedSideOlder){
+    SyncAll();
+    //The clock where the dest was changed is behind, so it looks older
+    Write(Dest("file0.txt"), "changed contents");
+    SetTime(Dest("file0.txt"), 500);
+    SyncBaseline baseline(path, source, dest, false);
+    ASSERT_EQ(SyncBaseline::DestChanged, GetChanges(baseline, "file0.txt"));
+    EXPECT_TRUE(baseline.ShouldCopy(Dest("file0.txt"), Source("file0.txt"), 
+                                    FileState::Get(Dest("file0.txt")), FileState::Get(Source("file0.txt"))));
+}
+
+TEST_F(SyncBaselineTest, ChangedSideSame){
+    SyncAll(true);
+    //Changed and changed back, only the contents show it is the same
+    Write(Dest("file0.txt"), "contents");
+    SetTime(Dest("file0.txt"), 500);
+    SyncBaseline baseline(path, source, dest, true);
+    ASSERT_EQ(SyncBaseline::DestChanged, GetChanges(baseline, "file0.txt"));
+    EXPECT_FALSE(baseline.ShouldCopy(Dest("file0.txt"), Source("file0.txt"), 
+                                     FileState::Get(Dest("file0.txt")), FileState::Get(Source("file0.txt"))));
+    //With nothing but the size to go on it is copied
+    SyncBaseline quick(path, source, dest, false);
+    EXPECT_TRUE(quick.ShouldCopy(Dest("file0.txt"), Source("file0.txt"), 
+                                 FileState::Get(Dest("file0.txt")), FileState::Get(Source("file0.txt"))));
+}
+
+TEST_F(SyncBaselineTest, BothChanged){
+    SyncAll();
+    Write(Source("file0.txt"), "changed contents");
+    Write(Dest("file0.txt"), "changed differently");
+    SyncBaseline baseline(path, source, dest, false);
+    EXPECT_EQ(SyncBaseline::BothChanged, GetChanges(baseline, "file0.txt"));
+}
+
+TEST_F(SyncBaselineTest, OtherFolders){
+    SyncAll();
+    //The same file but a baseline for a different job
+    SyncBaseline baseline(path, source, wxFileName::DirName(root), false);
+    EXPECT_EQ(SyncBaseline::BothChanged, GetChanges(baseline, "file0.txt"));
+}
+
+TEST_F(SyncBaselineTest, FinishedDropsUnseen){
+    SyncAll();
+    {
+        SyncBaseline baseline(path, source, dest, false);
+        baseline.Keep(Source("file0.txt"), FileState::Get(Source("file0.txt")), FileState::Get(Dest("file0.txt")));
+        ASSERT_TRUE(baseline.Save(true));
+    }
+    SyncBaseline baseline(path, source, dest, false);
+    EXPECT_EQ(SyncBaseline::Unchanged, GetChanges(baseline, "file0.txt"));
+    EXPECT_EQ(SyncBaseline::BothChanged, GetChanges(baseline, "file1.txt"));
+}
+
+TEST_F(SyncBaselineTest, UnfinishedKeepsUnseen){
+    SyncAll();
+    {
+        SyncBaseline baseline(path, source, dest, false);
+        ASSERT_TRUE(baseline.Save(false));
+    }
+    SyncBaseline baseline(path, source, dest, false);
+    EXPECT_EQ(SyncBaseline::Unchanged, GetChanges(baseline, "file1.txt"));
+}
+
+TEST_F(SyncBaselineTest, TimeOnlyChange){
+    unsigned long long hash;
+    ASSERT_TRUE(ContentHash::File(Source("file0.txt").GetFullPath(), hash));
+    HashCache::Remember(Source("file0.txt"), hash);
+    SyncAll(true);
+    SetTime(Source("file0.txt"), 5000);
+    //The contents are read to see it hasn't really changed
+    SyncBaseline full(path, source, dest, true);
+    EXPECT_EQ(SyncBaseline::Unchanged, GetChanges(full, "file0.txt"));
+    SyncBaseline quick(path, source, dest, false);
+    EXPECT_EQ(SyncBaseline::SourceChanged, GetChanges(quick, "file0.txt"));
+}
+
+TEST_F(SyncBaselineTest, Damaged){
+    SyncAll();
+    wxFile file(path, wxFile::write_append);
+    file.Write("not\ta\tbaseline\tline\n");
+    file.Close();
+    //Nothing from a damaged baseline is trusted
+    SyncBaseline baseline(path, source, dest, false);
+    EXPECT_EQ(SyncBaseline::BothChanged, GetChanges(baseline, "file0.txt"));
+}
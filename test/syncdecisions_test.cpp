@@ -0,0 +1,103 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <wx/datetime.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include "../sync/syncstate.h"
+#include "tempfolder.h"
+
+namespace{
+    //A source and destination file with the same time and size
+    class SyncDecisionsTest : public testing::Test{
+    protected:
+        virtual void SetUp(){
+            root = temp.GetPath();
+            source = wxFileName(root, "source.txt");
+            dest = wxFileName(root, "dest.txt");
+            Write(source, "contents");
+            Write(dest, "contents");
+            SyncDecisions::Clear();
+        }
+
+        virtual void TearDown(){
+            SyncDecisions::Clear();
+        }
+
+        void Write(const wxFileName &file, const std::string &contents){
+            TempFolder::Write(file.GetFullPath(), contents);
+            wxDateTime modified(static_cast<time_t>(1000));
+            wxFileName(file).SetTimes(&modified, &modified, NULL);
+        }
+
+        TempFolder temp;
+        wxString root;
+        wxFileName source;
+        wxFileName dest;
+    };
+}
+
+TEST_F(SyncDecisionsTest, Recall){
+    SyncDecisions::Remember(source, dest, 4, true);
+    bool copy = false;
+    ASSERT_TRUE(SyncDecisions::Recall(source, dest, 4, copy));
+    EXPECT_TRUE(copy);
+    //Other checks might have decided differently
+    EXPECT_FALSE(SyncDecisions::Recall(source, dest, 8, copy));
+    EXPECT_FALSE(SyncDecisions::Recall(dest, source, 4, copy));
+}
+
+TEST_F(SyncDecisionsTest, Clear){
+    SyncDecisions::Remember(source, dest, 4, false);
+    SyncDecisions::Clear();
+    bool copy;
+    EXPECT_FALSE(SyncDecisions::Recall(source, dest, 4, copy));
+}
+
+#ifndef __WXMSW__
+TEST_F(SyncDecisionsTest, Replaced){
+    SyncDecisions::Remember(source, dest, 4, false);
+    //A different file with the same size and time in seconds
+    wxFileName temp(root, "temp.txt");
+    Write(temp, "CONTENTS");
+    ASSERT_TRUE(wxRenameFile(temp.GetFullPath(), source.GetFullPath()));
+    EXPECT_TRUE(FileState::Get(dest) == FileState::Get(source));
+    bool copy;
+    EXPECT_FALSE(SyncDecisions::Recall(source, dest, 4, copy));
+}
+#endif
+
+TEST_F(SyncDecisionsTest, HashCache){
+    HashCache::Remember(source, 42);
+    unsigned long long hash = 0;
+    ASSERT_TRUE(HashCache::Recall(source, hash));
+    EXPECT_EQ(42u, hash);
+    EXPECT_FALSE(HashCache::Recall(dest, hash));
+}
+
+#ifndef __WXMSW__
+TEST_F(SyncDecisionsTest, HashCacheReplaced){
+    HashCache::Remember(source, 42);
+    //Only the contents differ, which nothing but the file's id gives away
+    wxFileName temp(root, "temp.txt");
+    Write(temp, "CONTENTS");
+    ASSERT_TRUE(wxRenameFile(temp.GetFullPath(), source.GetFullPath()));
+    unsigned long long hash;
+    EXPECT_FALSE(HashCache::Recall(source, hash));
+}
+#endif
+
+#ifndef __WXMSW__
+TEST_F(SyncDecisionsTest, HashCacheChangedWhileRead){
+    //The hash was of the file as it was before, whatever it is now
+    FileIdentity before = FileIdentity::Get(source);
+    Write(source, "CONTENTS");
+    HashCache::Remember(source, before, 42);
+    unsigned long long hash;
+    EXPECT_FALSE(HashCache::Recall(source, hash));
+}
+#endif
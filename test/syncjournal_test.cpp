@@ -0,0 +1,272 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <string>
+#include <wx/datetime.h>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include "../fileops.h"
+#include "../hash.h"
+#include "../sync/syncstate.h"
+#include "tempfolder.h"
+
+namespace{
+    const wxString job = "Job\t/source\t/dest\tCopy\tRules\t1";
+
+    //A source and destination with a folder in each
+    class SyncJournalTest : public testing::Test{
+    protected:
+        virtual void SetUp(){
+            root = temp.GetPath();
+            source = root + "source" + wxFILE_SEP_PATH;
+            dest = root + "dest" + wxFILE_SEP_PATH;
+            const wxString folders[] = {source, dest, Source("a"), Dest("a"), Source("b"), Dest("b")};
+            for(size_t i = 0; i < sizeof(folders) / sizeof(folders[0]); i++){
+                wxMkdir(folders[i]);
+                SetTime(folders[i], 1000);
+            }
+            path = root + "job.journal";
+        }
+
+        wxString Source(const wxString &name) {return source + name + wxFILE_SEP_PATH;}
+        wxString Dest(const wxString &name) {return dest + name + wxFILE_SEP_PATH;}
+
+        void SetTime(const wxString &folder, time_t time){
+            wxDateTime modified(time);
+            wxFileName::DirName(folder).SetTimes(&modified, &modified, NULL);
+        }
+
+        void Append(const wxString &text){
+            wxFile file(path, wxFile::write_append);
+            file.Write(text);
+        }
+
+        //Both folders and then the root as done, as a run would leave them
+        void DoneAll(){
+            SyncJournal journal(path, job);
+            journal.Done(Source("a"), Dest("a"));
+            journal.Done(Source("b"), Dest("b"));
+            journal.Done(source, dest);
+        }
+
+        TempFolder temp;
+        wxString root;
+        wxString source;
+        wxString dest;
+        wxString path;
+    };
+
+    FileState State(unsigned long long size, long long modified){
+        FileState state;
+        state.exists = true;
+        state.size = size;
+        state.modified = modified;
+        return state;
+    }
+}
+
+TEST_F(SyncJournalTest, Resumed){
+    {
+        SyncJournal journal(path, job);
+        EXPECT_FALSE(journal.IsResumed());
+    }
+    SyncJournal journal(path, job);
+    EXPECT_TRUE(journal.IsResumed());
+}
+
+TEST_F(SyncJournalTest, OtherJob){
+    {
+        SyncJournal journal(path, job);
+        journal.Done(Source("a"), Dest("a"));
+    }
+    //Different rules mean different files were looked at
+    SyncJournal journal(path, "Job\t/source\t/dest\tCopy\tOther rules\t1");
+    EXPECT_FALSE(journal.IsResumed());
+    EXPECT_FALSE(journal.IsDone(Dest("a")));
+}
+
+TEST_F(SyncJournalTest, TooOld){
+    TempFolder::Write(path, std::string("Toucan Journal\t2\n") + job.ToStdString() + "\nStarted\t1000\n");
+    SyncJournal journal(path, job);
+    EXPECT_FALSE(journal.IsResumed());
+}
+
+TEST_F(SyncJournalTest, Done){
+    DoneAll();
+    SyncJournal journal(path, job);
+    EXPECT_TRUE(journal.IsDone(Dest("a")));
+    EXPECT_TRUE(journal.IsDone(Dest("b")));
+    EXPECT_TRUE(journal.IsDone(dest));
+}
+
+TEST_F(SyncJournalTest, DoneChanged){
+    DoneAll();
+    //Something has happened in one of the folders since it was finished, so
+    //it and everything above it have to be looked at again
+    SetTime(Source("a"), 2000);
+    SyncJournal journal(path, job);
+    EXPECT_TRUE(journal.IsResumed());
+    EXPECT_FALSE(journal.IsDone(Dest("a")));
+    EXPECT_TRUE(journal.IsDone(Dest("b")));
+    EXPECT_FALSE(journal.IsDone(dest));
+}
+
+TEST_F(SyncJournalTest, DoneRemoved){
+    DoneAll();
+    wxRmdir(Dest("b"));
+    SyncJournal journal(path, job);
+    EXPECT_TRUE(journal.IsDone(Dest("a")));
+    EXPECT_FALSE(journal.IsDone(Dest("b")));
+}
+
+TEST_F(SyncJournalTest, DurableHeldBack){
+    {
+        SyncJournal journal(path, job, true);
+        journal.Done(Source("a"), Dest("a"));
+        //What was written to b never made it to disk
+        journal.Flushed(true);
+        journal.Done(Source("b"), Dest("b"));
+        journal.Flushed(false);
+        journal.Done(source, dest);
+    }
+    SyncJournal journal(path, job, true);
+    EXPECT_TRUE(journal.IsDone(Dest("a")));
+    EXPECT_FALSE(journal.IsDone(Dest("b")));
+    //Never flushed at all
+    EXPECT_FALSE(journal.IsDone(dest));
+}
+
+TEST_F(SyncJournalTest, Offset){
+    {
+        SyncJournal journal(path, job);
+        journal.Checkpoint("/dest/large", State(300, 1000), 100);
+        journal.Checkpoint("/dest/large", State(300, 1000), 200);
+        journal.Checkpoint("/dest/copied", State(300, 1000), 100);
+        journal.Copied("/dest/copied");
+    }
+    SyncJournal journal(path, job);
+    EXPECT_EQ(200, journal.GetOffset("/dest/large", State(300, 1000)));
+    EXPECT_EQ(0, journal.GetOffset("/dest/copied", State(300, 1000)));
+    EXPECT_EQ(0, journal.GetOffset("/dest/other", State(300, 1000)));
+}
+
+TEST_F(SyncJournalTest, SourceChanged){
+    {
+        SyncJournal journal(path, job);
+        journal.Checkpoint("/dest/large", State(300, 1000), 200);
+    }
+    //What was copied came from a different file so we start again
+    SyncJournal journal(path, job);
+    EXPECT_EQ(0, journal.GetOffset("/dest/large", State(300, 2000)));
+    EXPECT_EQ(0, journal.GetOffset("/dest/large", State(400, 1000)));
+}
+
+TEST_F(SyncJournalTest, TornLine){
+    {
+        SyncJournal journal(path, job);
+        journal.Checkpoint("/dest/large", State(300, 1000), 100);
+        journal.Done(Source("a"), Dest("a"));
+    }
+    //We were killed part way through writing the next checkpoint
+    Append("part\t/dest/large\t300:10");
+    SyncJournal journal(path, job);
+    EXPECT_TRUE(journal.IsResumed());
+    EXPECT_EQ(100, journal.GetOffset("/dest/large", State(300, 1000)));
+    EXPECT_TRUE(journal.IsDone(Dest("a")));
+}
+
+TEST_F(SyncJournalTest, Finish){
+    {
+        SyncJournal journal(path, job);
+        journal.Done(Source("a"), Dest("a"));
+        journal.Finish();
+    }
+    EXPECT_FALSE(wxFileExists(path));
+    SyncJournal journal(path, job);
+    EXPECT_FALSE(journal.IsResumed());
+}
+
+TEST(SyncJournal, Partial){
+    wxString partial = SyncJournal::GetPartialPath("/dest/large.iso");
+    EXPECT_NE("/dest/large.iso", partial);
+    EXPECT_TRUE(SyncJournal::IsPartial(partial));
+    EXPECT_FALSE(SyncJournal::IsPartial("/dest/large.iso"));
+}
+
+namespace{
+    //Big enough that the copy is checked a block back from where it carries on
+    class FileResumeTest : public testing::Test{
+    protected:
+        virtual void SetUp(){
+            root = temp.GetPath();
+            contents.resize(3 * block);
+            for(size_t i = 0; i < contents.length(); i++){
+                contents[i] = static_cast<char>(i * 7 + i / 251);
+            }
+            source = root + "source";
+            dest = root + "dest";
+            TempFolder::Write(source, contents);
+        }
+
+        static const size_t block = 1024 * 1024;
+        std::string contents;
+        TempFolder temp;
+        wxString root;
+        wxString source;
+        wxString dest;
+    };
+}
+
+TEST_F(FileResumeTest, FromStart){
+    ASSERT_TRUE(File::Resume(source, dest, 0, NULL) != 0);
+    EXPECT_TRUE(TempFolder::Read(dest) == contents);
+}
+
+#ifndef __WXMSW__
+TEST_F(FileResumeTest, FromOffset){
+    //Only the block before the offset is compared, so changing the one before
+    //that shows whether what we already had was kept
+    std::string partial = contents.substr(0, 2 * block);
+    partial[0] = ~partial[0];
+    TempFolder::Write(dest, partial);
+    unsigned long long hash;
+    ASSERT_TRUE(File::Resume(source, dest, 2 * block, NULL, false, &hash) != 0);
+    std::string expected = contents;
+    expected[0] = partial[0];
+    EXPECT_TRUE(TempFolder::Read(dest) == expected);
+    //The hash is of the source however much of it we read this time
+    ContentHash whole;
+    whole.Update(contents.data(), contents.length());
+    EXPECT_EQ(whole.GetValue(), hash);
+}
+
+TEST_F(FileResumeTest, Mismatch){
+    //The end of what we had doesn't match so it is copied again
+    std::string partial = contents.substr(0, 2 * block);
+    partial[2 * block - 1] = ~partial[2 * block - 1];
+    TempFolder::Write(dest, partial);
+    ASSERT_TRUE(File::Resume(source, dest, 2 * block, NULL) != 0);
+    EXPECT_TRUE(TempFolder::Read(dest) == contents);
+}
+
+TEST_F(FileResumeTest, Short){
+    //Less was written than the journal says
+    TempFolder::Write(dest, contents.substr(0, block));
+    ASSERT_TRUE(File::Resume(source, dest, 2 * block, NULL) != 0);
+    EXPECT_TRUE(TempFolder::Read(dest) == contents);
+}
+
+TEST_F(FileResumeTest, Cancelled){
+    CancelToken cancel;
+    cancel.Cancel();
+    TempFolder::Write(dest, contents.substr(0, 2 * block));
+    EXPECT_FALSE(File::Resume(source, dest, 2 * block, NULL, false, NULL, 0, &cancel) != 0);
+    //What was there is kept for next time
+    EXPECT_EQ(2 * block, TempFolder::Read(dest).length());
+}
+#endif
@@ -0,0 +1,113 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <wx/datetime.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include "../cancel.h"
+#include "../fileops.h"
+#include "../sync/syncversions.h"
+#include "tempfolder.h"
+
+namespace{
+    //A destination with a file in a folder
+    class SyncVersionsTest : public testing::Test{
+    protected:
+        virtual void SetUp(){
+            root = temp.GetPath();
+            wxMkdir(root + "folder");
+            file = wxFileName(root + "folder", "file.txt");
+            Write(file, "first");
+            today = root + SyncVersions::FolderName + wxFILE_SEP_PATH + wxDateTime::Now().FormatISODate()
+                  + wxFILE_SEP_PATH + "folder" + wxFILE_SEP_PATH;
+        }
+
+        void Write(const wxFileName &path, const std::string &contents){
+            TempFolder::Write(path.GetFullPath(), contents);
+        }
+
+        std::string Read(const wxString &path){
+            return TempFolder::Read(path);
+        }
+
+        //Makes an empty folder for a day in the versions folder
+        void MakeDay(const wxString &name){
+            wxFileName::Mkdir(root + SyncVersions::FolderName + wxFILE_SEP_PATH + name, 0777, wxPATH_MKDIR_FULL);
+        }
+
+        bool HasDay(const wxString &name){
+            return wxDirExists(root + SyncVersions::FolderName + wxFILE_SEP_PATH + name);
+        }
+
+        TempFolder temp;
+        wxString root;
+        wxFileName file;
+        wxString today;
+    };
+}
+
+TEST_F(SyncVersionsTest, Contains){
+    SyncVersions versions(wxFileName::DirName(root));
+    EXPECT_TRUE(versions.Contains(file));
+    EXPECT_FALSE(versions.Contains(wxFileName::DirName(root)));
+    EXPECT_FALSE(versions.Contains(wxFileName(wxFileName::GetTempDir(), "file.txt")));
+    EXPECT_TRUE(SyncVersions::IsVersionsFolder(SyncVersions::FolderName));
+    EXPECT_FALSE(SyncVersions::IsVersionsFolder("folder"));
+}
+
+TEST_F(SyncVersionsTest, Keep){
+    SyncVersions versions(wxFileName::DirName(root));
+    FolderCache folders;
+    ASSERT_TRUE(versions.Keep(file, folders));
+    EXPECT_FALSE(file.FileExists());
+    EXPECT_EQ("first", Read(today + "file.txt"));
+
+    //A second version the same day goes alongside the first
+    Write(file, "second");
+    ASSERT_TRUE(versions.Keep(file, folders));
+    EXPECT_EQ("first", Read(today + "file.txt"));
+    EXPECT_EQ("second", Read(today + "file (2).txt"));
+}
+
+TEST_F(SyncVersionsTest, KeepLinked){
+    SyncVersions versions(wxFileName::DirName(root));
+    FolderCache folders;
+    wxFileName version;
+    ASSERT_TRUE(versions.KeepLinked(file, folders, version));
+    EXPECT_EQ(today + "file.txt", version.GetFullPath());
+    //Nothing has gone until the new copy replaces it
+    EXPECT_EQ("first", Read(file.GetFullPath()));
+
+    wxFileName temp(root + "folder", "file.txt.tmp");
+    Write(temp, "second");
+    ASSERT_TRUE(folders.Rename(temp, file));
+    EXPECT_EQ("second", Read(file.GetFullPath()));
+    EXPECT_EQ("first", Read(version.GetFullPath()));
+}
+
+TEST_F(SyncVersionsTest, Prune){
+    MakeDay("2000-01-01");
+    MakeDay("2000-01-02");
+    MakeDay(wxDateTime::Now().FormatISODate());
+    MakeDay("not a day");
+    Write(wxFileName(root + SyncVersions::FolderName + wxFILE_SEP_PATH + "2000-01-01", "file.txt"), "old");
+    EXPECT_EQ(2u, SyncVersions::Prune(wxFileName::DirName(root), 7));
+    EXPECT_FALSE(HasDay("2000-01-01"));
+    EXPECT_FALSE(HasDay("2000-01-02"));
+    EXPECT_TRUE(HasDay(wxDateTime::Now().FormatISODate()));
+    EXPECT_TRUE(HasDay("not a day"));
+}
+
+TEST_F(SyncVersionsTest, PruneNothing){
+    MakeDay("2000-01-01");
+    //Keeping for ever
+    EXPECT_EQ(0u, SyncVersions::Prune(wxFileName::DirName(root), 0));
+    CancelToken cancel;
+    cancel.Cancel();
+    EXPECT_EQ(0u, SyncVersions::Prune(wxFileName::DirName(root), 7, &cancel));
+    EXPECT_TRUE(HasDay("2000-01-01"));
+}
@@ -0,0 +1,36 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "tempfolder.h"
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+TempFolder::TempFolder(){
+    //A unique name from a file we replace with the folder
+    m_Path = wxFileName::CreateTempFileName("toucantest");
+    wxRemoveFile(m_Path);
+    wxMkdir(m_Path);
+    m_Path += wxFILE_SEP_PATH;
+}
+
+TempFolder::~TempFolder(){
+    wxFileName::Rmdir(m_Path, wxPATH_RMDIR_RECURSIVE);
+}
+
+void TempFolder::Write(const wxString &path, const std::string &contents){
+    wxFile file(path, wxFile::write);
+    file.Write(contents.data(), contents.length());
+}
+
+std::string TempFolder::Read(const wxString &path){
+    wxFile file(path);
+    std::string contents(static_cast<size_t>(file.Length()), '\0');
+    if(!contents.empty()){
+        file.Read(&contents[0], contents.length());
+    }
+    return contents;
+}
@@ -0,0 +1,32 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_TEMPFOLDER
+#define H_TEMPFOLDER
+
+#include <string>
+#include <wx/string.h>
+
+//A new empty folder for a test to work in, removed along with everything in 
+//it when it goes
+class TempFolder{
+
+public:
+    TempFolder();
+    ~TempFolder();
+
+    //Ends with a separator so names can be added straight on
+    const wxString& GetPath() const {return m_Path;}
+
+    //Replaces whatever the file held
+    static void Write(const wxString &path, const std::string &contents);
+    static std::string Read(const wxString &path);
+
+private:
+    wxString m_Path;
+};
+
+#endif
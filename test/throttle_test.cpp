@@ -0,0 +1,44 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include "../cancel.h"
+#include "../throttle.h"
+
+TEST(Throttle, ParseDiskStats){
+    Throttle::DiskSample sample;
+    ASSERT_TRUE(Throttle::ParseDiskStats("   8       1 sda1 1000 5 2048 300 400 6 4096 500 0 1200 800 0 0 0 0", sample));
+    EXPECT_EQ(8u, sample.major);
+    EXPECT_EQ(1u, sample.minor);
+    EXPECT_EQ(2048u + 4096u, sample.sectors);
+    EXPECT_EQ(1200u, sample.iotime);
+    EXPECT_FALSE(Throttle::ParseDiskStats("not a disk", sample));
+}
+
+TEST(Throttle, OthersUtilisation){
+    //Nobody else was using it
+    EXPECT_DOUBLE_EQ(0.0, Throttle::OthersUtilisation(1.0, 1000, 1000));
+    EXPECT_DOUBLE_EQ(0.0, Throttle::OthersUtilisation(1.0, 1000, 5000));
+    //Half of what went through the disk was ours
+    EXPECT_DOUBLE_EQ(0.5, Throttle::OthersUtilisation(1.0, 1000, 500));
+    //We did nothing, or the disk only seeked
+    EXPECT_DOUBLE_EQ(0.8, Throttle::OthersUtilisation(0.8, 1000, 0));
+    EXPECT_DOUBLE_EQ(0.8, Throttle::OthersUtilisation(0.8, 0, 1000));
+}
+
+TEST(Throttle, Cancelled){
+    Throttle::Limits limits;
+    limits.bytespersec = 1000;
+    CancelToken cancel;
+    cancel.Cancel();
+    Throttle::Begin(limits, &cancel);
+    //Ten seconds worth, but we have been stopped
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Throttle::Account(11000);
+    Throttle::End();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
@@ -0,0 +1,295 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "throttle.h"
+#include "cancel.h"
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <utility>
+#include <algorithm>
+#include <wx/thread.h>
+#include <wx/utils.h>
+#include <wx/log.h>
+#include <wx/filename.h>
+
+#ifdef __WXMSW__
+	#include <windows.h>
+	#include <wx/msw/winundef.h>
+#else
+	#include <stdlib.h>
+	#include <stdio.h>
+	#include <unistd.h>
+	#include <sys/resource.h>
+#endif
+
+#ifdef __LINUX__
+	#include <sys/syscall.h>
+	#include <sys/stat.h>
+	#include <sys/sysmacros.h>
+#endif
+
+namespace{
+	//A bucket that fills at the limit and holds a second's worth, so short
+	//bursts are fine but the average is kept to
+	class TokenBucket{
+	public:
+		TokenBucket() : rate(0), tokens(0)
+		{}
+
+		void Reset(double limit, double now){
+			rate = limit;
+			tokens = limit;
+			last = now;
+		}
+
+		//Seconds to wait before the amount is paid for
+		double Take(double amount, double now){
+			if(rate <= 0){
+				return 0;
+			}
+			tokens = std::min(rate, tokens + (now - last) * rate);
+			last = now;
+			tokens -= amount;
+			return tokens < 0 ? -tokens / rate : 0;
+		}
+
+	private:
+		double rate;
+		double tokens;
+		double last;
+	};
+
+	//Above these the machine is busy with something more important than us
+	const double diskbusy = 0.9;
+	//How often we look at the load and how long we pause for when it is high
+	const double loadinterval = 1.0;
+	const long busypause = 500;
+
+	wxMutex throttlemutex;
+	Throttle::Limits current;
+	CancelToken *cancel = NULL;
+	bool active = false;
+	TokenBucket bytebucket, opbucket;
+	double lastcheck = 0;
+	bool busy = false;
+	typedef std::pair<unsigned int, unsigned int> DiskId;
+	//The disks the job is using, empty to watch them all
+	std::set<DiskId> watched;
+	//What each disk had done when we last looked, from /proc/diskstats
+	std::map<DiskId, Throttle::DiskSample> disksamples;
+	double lastdisktime = 0;
+	//The bytes we have read and written since we last looked
+	unsigned long long ownbytes = 0;
+
+	double Now(){
+		static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//The highest fraction of the last interval any of the disks we watch 
+	//was busy with something other than us
+	double DiskUtilisation(double now){
+		double highest = 0;
+	#ifdef __LINUX__
+		FILE *stats = fopen("/proc/diskstats", "r");
+		if(!stats){
+			return 0;
+		}
+		char line[512];
+		double elapsed = (now - lastdisktime) * 1000;
+		//What we did is shared between the disks we use, a copy reads as 
+		//much from one as it writes to each of the others
+		unsigned long long owned = watched.empty() ? 0 : ownbytes / watched.size();
+		while(fgets(line, sizeof(line), stats)){
+			Throttle::DiskSample sample;
+			if(!Throttle::ParseDiskStats(line, sample)){
+				continue;
+			}
+			DiskId id(sample.major, sample.minor);
+			if(!watched.empty() && watched.find(id) == watched.end()){
+				continue;
+			}
+			std::map<DiskId, Throttle::DiskSample>::iterator iter = disksamples.find(id);
+			if(iter != disksamples.end() && elapsed > 0){
+				double utilisation = (sample.iotime - iter->second.iotime) / elapsed;
+				unsigned long long bytes = (sample.sectors - iter->second.sectors) * 512;
+				highest = std::max(highest, Throttle::OthersUtilisation(utilisation, bytes, owned));
+			}
+			disksamples[id] = sample;
+		}
+		fclose(stats);
+		lastdisktime = now;
+	#else
+		wxUnusedVar(now);
+	#endif
+		ownbytes = 0;
+		return highest;
+	}
+
+	bool AreListed(const std::set<DiskId> &disks){
+	#ifdef __LINUX__
+		FILE *stats = fopen("/proc/diskstats", "r");
+		if(!stats){
+			return false;
+		}
+		std::set<DiskId> listed;
+		char line[512];
+		while(fgets(line, sizeof(line), stats)){
+			Throttle::DiskSample sample;
+			if(Throttle::ParseDiskStats(line, sample)){
+				listed.insert(DiskId(sample.major, sample.minor));
+			}
+		}
+		fclose(stats);
+		for(std::set<DiskId>::const_iterator iter = disks.begin(); iter != disks.end(); ++iter){
+			if(listed.find(*iter) == listed.end()){
+				return false;
+			}
+		}
+		return true;
+	#else
+		wxUnusedVar(disks);
+		return false;
+	#endif
+	}
+
+	bool IsBusy(double now){
+		if(now - lastcheck < loadinterval){
+			return busy;
+		}
+		lastcheck = now;
+		busy = DiskUtilisation(now) > diskbusy;
+	#ifndef __WXMSW__
+		double load;
+		if(getloadavg(&load, 1) == 1 && load > wxThread::GetCPUCount()){
+			busy = true;
+		}
+	#endif
+		return busy;
+	}
+}
+
+void Throttle::Begin(const Limits &limits, CancelToken *token, const wxArrayString &paths){
+	wxMutexLocker lock(throttlemutex);
+	current = limits;
+	cancel = token;
+	watched.clear();
+#ifdef __LINUX__
+	for(size_t i = 0; i < paths.GetCount(); i++){
+		//A destination may not have been made yet, so go up until something
+		//exists
+		wxFileName folder = wxFileName::DirName(paths[i]);
+		struct stat st;
+		bool found;
+		while(!(found = stat(folder.GetFullPath().fn_str(), &st) == 0) && folder.GetDirCount() > 0){
+			folder.RemoveLastDir();
+		}
+		if(found){
+			watched.insert(DiskId(major(st.st_dev), minor(st.st_dev)));
+		}
+	}
+	//Some filesystems, such as btrfs or those over the network, aren't on a
+	//device listed in diskstats, then we can only watch everything
+	if(!AreListed(watched)){
+		watched.clear();
+	}
+#else
+	wxUnusedVar(paths);
+#endif
+	double now = Now();
+	bytebucket.Reset(static_cast<double>(limits.bytespersec), now);
+	opbucket.Reset(static_cast<double>(limits.opspersec), now);
+	disksamples.clear();
+	ownbytes = 0;
+	lastdisktime = lastcheck = now;
+	busy = false;
+	active = limits.background || limits.bytespersec > 0 || limits.opspersec > 0;
+}
+
+void Throttle::End(){
+	wxMutexLocker lock(throttlemutex);
+	active = false;
+}
+
+void Throttle::Account(unsigned long long bytes, unsigned long operations){
+	double wait;
+	bool background;
+	CancelToken *token;
+	{
+		wxMutexLocker lock(throttlemutex);
+		if(!active){
+			return;
+		}
+		double now = Now();
+		ownbytes += bytes;
+		wait = std::max(bytebucket.Take(static_cast<double>(bytes), now), opbucket.Take(operations, now));
+		background = current.background;
+		token = cancel;
+	}
+	//A long wait at a low limit mustn't hold up stopping the job
+	if(wait > 0 && token->Sleep(static_cast<unsigned long>(wait * 1000))){
+		return;
+	}
+	//Step aside while something else needs the machine, looking again now
+	//and then in case we are stopped
+	while(background && !token->IsCancelled()){
+		{
+			wxMutexLocker lock(throttlemutex);
+			if(!IsBusy(Now())){
+				break;
+			}
+		}
+		token->Sleep(busypause);
+	}
+}
+
+void Throttle::LowerPriority(){
+#if defined(__WXMSW__)
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif defined(__LINUX__)
+	//Both are per thread on Linux and inherited by the threads we start
+	pid_t thread = static_cast<pid_t>(syscall(SYS_gettid));
+	setpriority(PRIO_PROCESS, thread, 10);
+	#ifdef SYS_ioprio_set
+		//IOPRIO_WHO_PROCESS with the idle class, only used when the disk 
+		//would otherwise be idle
+		const int who = 1, idleclass = 3, classshift = 13;
+		syscall(SYS_ioprio_set, who, thread, idleclass << classshift);
+	#endif
+#elif defined(__WXMAC__)
+	//Lowers both for just this thread
+	setpriority(PRIO_DARWIN_THREAD, 0, PRIO_DARWIN_BG);
+#endif
+}
+
+bool Throttle::ParseDiskStats(const char *line, DiskSample &sample){
+	char name[64];
+	unsigned long long fields[10];
+	//Sectors read and written are the third and seventh numbers after the 
+	//name and the tenth is the milliseconds spent doing io
+	if(sscanf(line, "%u %u %63s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu", &sample.major, &sample.minor, name,
+	          &fields[0], &fields[1], &fields[2], &fields[3], &fields[4], &fields[5], &fields[6], 
+	          &fields[7], &fields[8], &fields[9]) != 13){
+		return false;
+	}
+	sample.sectors = fields[2] + fields[6];
+	sample.iotime = fields[9];
+	return true;
+}
+
+double Throttle::OthersUtilisation(double utilisation, unsigned long long diskbytes, unsigned long long ownbytes){
+	//Time spent seeking isn't counted in bytes, so the share of the time that
+	//was ours is taken to be our share of the bytes
+	if(diskbytes == 0 || ownbytes == 0){
+		return utilisation;
+	}
+	if(ownbytes >= diskbytes){
+		return 0;
+	}
+	return utilisation * (diskbytes - ownbytes) / diskbytes;
+}
@@ -0,0 +1,57 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Author:      Steven Lamerton
+// Copyright:   Copyright (C) 2011 Steven Lamerton
+// License:     GNU GPL 2 http://www.gnu.org/licenses/gpl-2.0.html
+/////////////////////////////////////////////////////////////////////////////////
+
+#ifndef H_THROTTLE
+#define H_THROTTLE
+
+class CancelToken;
+
+#include <wx/arrstr.h>
+
+//Keeps the running job to a number of bytes and operations a second and, when
+//it is running in the background, out of the way while the machine is busy
+namespace Throttle{
+	struct Limits{
+		bool background;
+		//Zero for no limit
+		unsigned long long bytespersec;
+		unsigned long opspersec;
+
+		Limits() : background(false), bytespersec(0), opspersec(0)
+		{}
+	};
+
+	//Waits are cut short once the token is cancelled. Only the disks the 
+	//paths are on count when deciding if the machine is busy, or every disk
+	//if there are none
+	void Begin(const Limits &limits, CancelToken *cancel, const wxArrayString &paths = wxArrayString());
+	void End();
+
+	//Called after each read or write, waits until the job may carry on
+	void Account(unsigned long long bytes, unsigned long operations = 1);
+
+	//Lowers the cpu and disk priority of the calling thread, along with any 
+	//threads it starts afterwards
+	void LowerPriority();
+
+	//What /proc/diskstats says about a disk
+	struct DiskSample{
+		unsigned int major;
+		unsigned int minor;
+		//Sectors of 512 bytes read and written
+		unsigned long long sectors;
+		//Milliseconds spent doing io
+		unsigned long long iotime;
+	};
+
+	bool ParseDiskStats(const char *line, DiskSample &sample);
+
+	//How much of an interval a disk was kept busy by others, given how much
+	//of it the disk was busy for, the bytes it moved and the bytes we moved
+	double OthersUtilisation(double utilisation, unsigned long long diskbytes, unsigned long long ownbytes);
+}
+
+#endif
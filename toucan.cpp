@@ -13,6 +13,7 @@
 #include <wx/log.h>
 #include <wx/gauge.h>
 #include <wx/cmdline.h>
+#include <wx/file.h>
 #include <wx/image.h> 
 #include <wx/snglinst.h>
 
@@ -34,6 +35,7 @@ using namespace boost::interprocess;
 #include "log.h"
 #include "path.h"
 #include "fileops.h"
+#include "progress.h"
 #include "toucan.h"
 #include "settings.h"
 #include "luamanager.h"
@@ -44,6 +46,7 @@ using namespace boost::interprocess;
 #include "secure/secureprocess.h"
 #include "forms/frmprogress.h"
 #include "forms/frmpassword.h"
+#include "sync/syncagent.h"
 
 IMPLEMENT_APP_NO_MAIN(Toucan)
 
@@ -54,7 +57,6 @@ BEGIN_EVENT_TABLE(Toucan, wxApp)
 	EVT_COMMAND(ID_BACKUPPROCESS, wxEVT_COMMAND_BUTTON_CLICKED, Toucan::OnBackupProcess)
 	EVT_COMMAND(ID_SECUREPROCESS, wxEVT_COMMAND_BUTTON_CLICKED, Toucan::OnSecureProcess)
 	EVT_COMMAND(ID_GETPASSWORD, wxEVT_COMMAND_BUTTON_CLICKED, Toucan::OnGetPassword)
-	EVT_COMMAND(ID_PROGRESSSETUP, wxEVT_COMMAND_BUTTON_CLICKED, Toucan::OnProgressSetup)
     EVT_TIMER(wxID_ANY, Toucan::OnTimer)
 END_EVENT_TABLE()
 
@@ -71,13 +73,15 @@ Toucan::Toucan()
 	m_Scripts_Config = NULL;
     m_LogChain = NULL;
 	m_LogFile = NULL;
+	m_EventFile = NULL;
 	m_Locale = NULL;
     m_Timer = NULL;
+    m_LastStatus = 0;
     m_Checker = NULL;
 	m_IsGui = true;
 	m_IsReadOnly = false;
 	m_Finished = false;
-	m_Abort = false;
+	m_ProfileRules = false;
 }
 
 //Toucan startup
@@ -88,8 +92,19 @@ bool Toucan::OnInit(){
 		{wxCMD_LINE_OPTION, "d", "data", "Location of the Data folder", wxCMD_LINE_VAL_STRING},
 		{wxCMD_LINE_OPTION, "s", "script", "Script to run", wxCMD_LINE_VAL_STRING},
 		{wxCMD_LINE_OPTION, "l", "log", "Path to save log", wxCMD_LINE_VAL_STRING},
+		{wxCMD_LINE_OPTION, "e", "events", "Path to save per file events as JSON", wxCMD_LINE_VAL_STRING},
 		{wxCMD_LINE_OPTION, "j", "job", "Job to run", wxCMD_LINE_VAL_STRING},
+		{wxCMD_LINE_OPTION, "x", "plan", "Saved sync plan to run", wxCMD_LINE_VAL_STRING},
+		{wxCMD_LINE_OPTION, "k", "pack", "Sync job to pack", wxCMD_LINE_VAL_STRING},
+		{wxCMD_LINE_OPTION, "u", "unpack", "Folder to unpack into", wxCMD_LINE_VAL_STRING},
+		{wxCMD_LINE_OPTION, "f", "file", "Pack to write or read, standard output or input if not given", wxCMD_LINE_VAL_STRING},
+        {wxCMD_LINE_SWITCH, "z", "compress", "Compress the pack"},
         {wxCMD_LINE_OPTION, "p", "password", "Password for jobs and scripts", wxCMD_LINE_VAL_STRING},
+        {wxCMD_LINE_SWITCH, "r", "profile-rules", "Report rule statistics at the end of each job"},
+        {wxCMD_LINE_SWITCH, "a", "agent", "Answer sync agent requests on stdin and stdout"},
+        {wxCMD_LINE_SWITCH, "b", "background", "Run sync jobs at low priority, pausing while the machine is busy"},
+        {wxCMD_LINE_OPTION, "w", "bwlimit", "Limit sync jobs to this many KB a second", wxCMD_LINE_VAL_NUMBER},
+        {wxCMD_LINE_OPTION, "o", "iopslimit", "Limit sync jobs to this many reads and writes a second", wxCMD_LINE_VAL_NUMBER},
 		{wxCMD_LINE_NONE}
 	};
 	wxCmdLineParser parser(desc, argc, argv);
@@ -100,8 +115,15 @@ bool Toucan::OnInit(){
 	}
 	delete wxMessageOutput::Set(old);
 
+	//The agent needs nothing else set up and stdout is its own
+	if(parser.Found("agent")){
+		SyncAgent::Serve(0, 1);
+		return false;
+	}
+
 	//If no script is found then we are in gui mode
-	if(!parser.Found("script") && !parser.Found("job")){
+	if(!parser.Found("script") && !parser.Found("job") && !parser.Found("plan")
+	&& !parser.Found("pack") && !parser.Found("unpack")){
 		#ifdef __WXMSW__
 			ShowWindow(GetConsoleWindow(), SW_HIDE);
 		#endif
@@ -170,17 +192,42 @@ bool Toucan::OnInit(){
     else{
         delete wxLog::SetActiveTarget(new LogBlank);
     }
+	if(parser.Found("events")){
+		wxString path;
+		parser.Found("events", &path);
+		m_EventFile = new wxFile(path, wxFile::write);
+		if(!m_EventFile->IsOpened()){
+			delete m_EventFile;
+			m_EventFile = NULL;
+		}
+	}
+
+    m_ProfileRules = parser.Found("profile-rules");
+
+    m_Throttle.background = parser.Found("background");
+    long limit;
+    if(parser.Found("bwlimit", &limit) && limit > 0){
+        m_Throttle.bytespersec = static_cast<unsigned long long>(limit) * 1024;
+    }
+    if(parser.Found("iopslimit", &limit) && limit > 0){
+        m_Throttle.opspersec = limit;
+    }
+
+    //A pack written to standard output must not have messages mixed into it
+    wxString packfile = "-";
+    parser.Found("file", &packfile);
+    std::ostream *out = (parser.Found("pack") && packfile == "-") ? &std::cerr : &std::cout;
 
     //Only output to a message box if we are not verbose
     if(parser.Found("verbose")){
         wxLog::SetVerbose();
         wxLog::SetLogLevel(wxLOG_Info);
-        m_LogChain = new wxLogChain(new wxLogStream(&std::cout));
+        m_LogChain = new wxLogChain(new wxLogStream(out));
     }
     //...and if we are not in GUI mode
     else if(!m_IsGui){
         //This will send the messages to the screen in addition to logfile
-		m_LogChain = new wxLogChain(new wxLogStream(&std::cout));
+		m_LogChain = new wxLogChain(new wxLogStream(out));
     }
     else{
         m_LogChain = new wxLogChain(new wxLogGui);
@@ -264,6 +311,22 @@ bool Toucan::OnInit(){
                 OutputProgress(_("The job does not exist"), FinishingLine);
 			}
 		}
+		else if(parser.Found("plan")){
+			wxString plan;
+			parser.Found("plan", &plan);
+			m_LuaManager->Run("runplan([[" + plan + "]])");
+		}
+		else if(parser.Found("pack")){
+			wxString name;
+			parser.Found("pack", &name);
+			wxString compress = parser.Found("compress") ? "true" : "false";
+			m_LuaManager->Run("pack([[" + name + "]], [[" + packfile + "]], " + compress + ")");
+		}
+		else if(parser.Found("unpack")){
+			wxString folder;
+			parser.Found("unpack", &folder);
+			m_LuaManager->Run("applypack([[" + packfile + "]], [[" + folder + "]])");
+		}
 	}
 	return true;
 }
@@ -307,6 +370,7 @@ int Toucan::OnExit(){
         m_LogFile->Write();
         delete m_LogFile;
     }
+    delete m_EventFile;
 	delete m_Locale;
 	delete m_Settings;
     delete m_Checker;
@@ -425,13 +489,6 @@ void Toucan::OnGetPassword(wxCommandEvent &event){
 	m_StatusMap[event.GetInt()] = true;
 }
 
-void Toucan::OnProgressSetup(wxCommandEvent &event){
-	frmProgress *window = m_LuaManager->GetProgressWindow();
-	if(window && window->m_Gauge){
-		window->m_Gauge->SetRange(event.GetInt());
-	}
-}
-
 void Toucan::OnTimer(wxTimerEvent &WXUNUSED(event)){
     try{
         message_queue mq(open_or_create, "progress", 1000, 10000);
@@ -443,14 +500,28 @@ void Toucan::OnTimer(wxTimerEvent &WXUNUSED(event)){
 
         if(mq.try_receive(&message[0], message.size(), size, priority)){
             message.resize(size);
-            wxString wxmessage(message.c_str(), wxConvUTF8);
-			wxLogMessage(wxmessage);
+            ProgressEvent event;
+            if(ProgressEvent::Decode(message.c_str(), size, event)){
+                wxLogMessage("%s", event.Format());
+                if(m_EventFile){
+                    m_EventFile->Write(event.ToJson() + "\n", wxConvUTF8);
+                }
+            }
+            else{
+                wxString wxmessage(message.c_str(), wxConvUTF8);
+                wxLogMessage(wxmessage);
+            }
 
             if(priority == FinishingLine){
                 OnExit();
                 exit(EXIT_SUCCESS);
             }
         }
+        //Every so often let the user know how the job is getting on
+        if(Progress::IsRunning() && wxGetLocalTime() - m_LastStatus >= 10){
+            m_LastStatus = wxGetLocalTime();
+            wxLogMessage("%s", Progress::Describe(Progress::Sample()));
+        }
     }
     catch(std::exception &ex){
         wxLogError("%s", ex.what());
@@ -10,6 +10,8 @@
 #include <wx/app.h>
 #include <wx/timer.h>
 #include <map>
+#include "throttle.h"
+#include "cancel.h"
 
 class frmMain;
 class frmProgress;
@@ -17,6 +19,7 @@ class Settings;
 class ScriptManager;
 class LuaManager;
 class wxTextFile;
+class wxFile;
 class wxFileConfig;
 class wxTimerEvent;
 class wxSingleInstanceChecker;
@@ -29,8 +32,7 @@ enum{
 	ID_BACKUPPROCESS,
 	ID_SECUREPROCESS,
 	ID_GETPASSWORD,
-	ID_PROGRESS,
-	ID_PROGRESSSETUP
+	ID_PROGRESS
 };
 
 class Toucan: public wxApp{    
@@ -45,9 +47,15 @@ public:
 
 	void SetLanguage(const wxString &lang);
 	void RebuildForm();
-	void SetAbort(const bool& Abort) {this->m_Abort = Abort;}
-
-	const bool& GetAbort() const {return m_Abort;}
+	void SetAbort(const bool& Abort) {Abort ? m_Cancel.Cancel() : m_Cancel.Reset();}
+	void SetProfileRules(const bool& ProfileRules) {this->m_ProfileRules = ProfileRules;}
+
+	bool GetAbort() const {return m_Cancel.IsCancelled();}
+	//For anything that needs to know as soon as the job is stopped
+	CancelToken& GetCancel() {return m_Cancel;}
+	const bool& GetProfileRules() const {return m_ProfileRules;}
+	//Limits given on the command line for every sync job
+	const Throttle::Limits& GetThrottle() const {return m_Throttle;}
 	const wxString& GetSettingsPath() const {return m_SettingsPath;}
 	const bool& IsGui() const {return m_IsGui;}
 	const bool& IsReadOnly() const {return m_IsReadOnly;}
@@ -68,6 +76,8 @@ public:
 	wxString m_Password;
     wxLogChain* m_LogChain;
 	wxTextFile* m_LogFile;
+	//Per file events as JSON lines, for other programs to read
+	wxFile* m_EventFile;
 
 private:
 	//Clean up the temporary files that might be in the data folder
@@ -81,15 +91,17 @@ private:
 	void OnBackupProcess(wxCommandEvent &event);
 	void OnSecureProcess(wxCommandEvent &event);
 	void OnGetPassword(wxCommandEvent &event);
-	void OnProgressSetup(wxCommandEvent &event);
 
-	bool m_Abort;
+	CancelToken m_Cancel;
+	bool m_ProfileRules;
+	Throttle::Limits m_Throttle;
 	wxString m_SettingsPath;
 	bool m_IsGui;
 	bool m_IsReadOnly;
 	bool m_Finished;
 	wxLocale* m_Locale;
     wxTimer *m_Timer;
+    long m_LastStatus;
     wxSingleInstanceChecker *m_Checker;
 
     DECLARE_CLASS(Toucan)
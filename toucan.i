@@ -9,33 +9,90 @@
 	#include "path.h"
 	#include "fileops.h"
 	#include "filecounter.h"
+	#include "progress.h"
 	#include "basicfunctions.h"
 	#include "data/syncdata.h"
 	#include "data/backupdata.h"
 	#include "data/securedata.h"
 	#include "sync/syncjob.h"
+	#include "sync/syncplan.h"
+	#include "sync/syncpack.h"
 	#include "backup/backupjob.h"
 	#include "secure/securejob.h"
+	#include "devicelock.h"
 
-	void Sync(SyncData *data){
+	//Resets the progress to an unknown total and starts counting the files in
+	//the background, the job itself does not wait for the count
+	void StartProgressCount(FileCounter &counter){
+		Progress::Begin();
+		if(counter.Create() == wxTHREAD_NO_ERROR){
+			counter.Run();
+		}
+	}
+
+	void FinishProgressCount(FileCounter &counter){
+		counter.Delete();
+		Progress::End();
+	}
+
+	//Prepares a jobs rules for profiling if it has been requested
+	void StartRuleProfile(RuleSet *rules){
+		if(rules){
+			rules->SetProfiling(wxGetApp().GetProfileRules());
+		}
+	}
+
+	//Writes the collected rule statistics to the progress output and so the log
+	void OutputRuleProfile(RuleSet *rules){
+		if(!rules || !rules->IsProfiling()){
+			return;
+		}
+		wxArrayString lines = rules->GetProfile();
+		for(unsigned int i = 0; i < lines.Count(); i++){
+			OutputProgress(lines.Item(i), FinishingInfo);
+		}
+	}
+
+	//Where every copy of Toucan locks the disks its jobs use
+	wxString GetLockFolder(){
+		return wxGetApp().GetSettingsPath() + "locks";
+	}
+
+	void OutputDeviceWait(const wxString &id){
+		OutputProgress(_("Waiting for another job using ") + id, Message);
+	}
+
+	//Jobs wait here for any spinning disk they use to be free before starting
+	wxArrayString GetSyncPaths(SyncData *data){
+		wxArrayString paths;
+		paths.Add(data->GetSource().GetFullPath());
+		paths.Add(data->GetDest().GetFullPath());
+		return paths;
+	}
+
+	void ValidateSync(SyncData *data){
 		if(data->GetSource().GetFullPath() == wxEmptyString || !data->GetSource().IsDir()){
 			throw std::invalid_argument("The source path is invalid");
 		}
 		if(data->GetDest().GetFullPath() == wxEmptyString || !data->GetDest().IsDir()){
 			throw std::invalid_argument("The destination path is invalid");
 		}
-		if(data->GetFunction() == wxEmptyString){
+		if(data->GetFunctionType() == SyncUnknown){
 			throw std::invalid_argument("A valid function must be selected");
 		}
 		if(!wxDirExists(Path::Normalise(data->GetSource().GetFullPath()))){
 			throw std::invalid_argument("The source must exist");
 		}
+	}
+
+	void Sync(SyncData *data){
+		ValidateSync(data);
 		FileCounter counter;
 
-		if(data->GetFunction() == _("Mirror")){
+		if(data->GetFunctionType() == SyncMirror){
 			counter.AddPath(data->GetDest().GetFullPath());		
 		}
-		else if(data->GetFunction() == _("Equalise")){
+		else if(data->GetFunctionType() == SyncEqualise){
 			counter.AddPath(data->GetSource().GetFullPath());
 			counter.AddPath(data->GetDest().GetFullPath());
 		}
@@ -43,15 +100,17 @@
 			counter.AddPath(data->GetSource().GetFullPath());	
 		}
 
-		counter.Count();
-		int count = counter.GetCount();
-		wxCommandEvent *event = new wxCommandEvent(wxEVT_COMMAND_BUTTON_CLICKED, ID_PROGRESSSETUP);
-		event->SetInt(count);
-		wxGetApp().QueueEvent(event);
+		StartProgressCount(counter);
+		StartRuleProfile(data->GetRules());
+		DeviceLock devices(GetSyncPaths(data), GetLockFolder(), wxGetApp().GetCancel(), OutputDeviceWait);
 		SyncJob *job = new SyncJob(data);
 		job->Create();
 		job->Run();
 		job->Wait();
+		FinishProgressCount(counter);
+		OutputRuleProfile(data->GetRules());
+		//Anything remembered from a preview has now been used
+		SyncDecisions::Clear();
 	}
 
 	void Sync(const wxString &source, const wxString &dest, const wxString &function, 
@@ -72,6 +131,15 @@
 		data->SetRecycle(options.Recycle);
 		data->SetPreviewChanges(options.PreviewChanges);
 		data->SetNoSkipped(options.NoSkipped);
+		data->SetVerify(options.Verify);
+		data->SetDurability(options.Durability);
+		data->SetBackground(options.Background);
+		data->SetBandwidthLimit(options.BandwidthLimit);
+		data->SetIopsLimit(options.IopsLimit);
+		data->SetVersions(options.Versions);
+		data->SetKeepVersions(options.KeepVersions);
+		data->SetAgent(options.Agent);
+		data->SetAgentRoot(options.AgentRoot);
         RuleSet *ruleset = new RuleSet(rules);
         ruleset->TransferFromFile();
 		data->SetRules(ruleset);
@@ -94,6 +162,196 @@
 		}
 	}
 	
+	//Syncs the same source to several destinations, reading each changed file
+	//only once
+	void SyncMany(SyncData *data, const wxArrayString &dests){
+		ValidateSync(data);
+		if(dests.Count() == 0){
+			throw std::invalid_argument("You must give at least one destination");
+		}
+		SyncFunction function = data->GetFunctionType();
+		if(function != SyncCopy && function != SyncMirror && function != SyncClean){
+			throw std::invalid_argument("Only Copy, Mirror and Clean can sync to more than one destination");
+		}
+		//The agent and its root belong to the job's own destination
+		if(!data->GetAgent().IsEmpty() || !data->GetAgentRoot().IsEmpty()){
+			throw std::invalid_argument("A job with an agent can only sync to its own destination");
+		}
+		wxString rules = data->GetRules() ? data->GetRules()->GetName() : wxString();
+		std::vector<SyncData*> datas;
+		for(unsigned int i = 0; i < dests.Count(); i++){
+			if(dests.Item(i) == wxEmptyString){
+				throw std::invalid_argument("The destination path is invalid");
+			}
+		}
+		for(unsigned int i = 0; i < dests.Count(); i++){
+			//Each destination gets its own rules so they can be planned at 
+			//the same time, SetRules doesn't free the ones we copied
+			SyncData *copy = new SyncData(*data);
+			copy->SetDest(wxFileName::DirName(dests.Item(i)));
+			RuleSet *ruleset = new RuleSet(rules);
+			ruleset->TransferFromFile();
+			copy->SetRules(ruleset);
+			datas.push_back(copy);
+		}
+		delete data;
+
+		//The job counts up the plans itself
+		Progress::Begin();
+		StartRuleProfile(datas.front()->GetRules());
+		wxArrayString paths = GetSyncPaths(datas.front());
+		for(size_t i = 1; i < datas.size(); i++){
+			paths.Add(datas[i]->GetDest().GetFullPath());
+		}
+		DeviceLock devices(paths, GetLockFolder(), wxGetApp().GetCancel(), OutputDeviceWait);
+		SyncFanOutJob *job = new SyncFanOutJob(datas);
+		job->Create();
+		job->Run();
+		job->Wait();
+		Progress::End();
+		OutputRuleProfile(datas.front()->GetRules());
+		SyncDecisions::Clear();
+		delete job;
+	}
+
+	void SyncMany(const wxString &source, const wxArrayString &dests, const wxString &function, 
+			      SyncChecks checks = SyncChecks(), SyncOptions options = SyncOptions(), 
+			      const wxString &rules = wxEmptyString)
+	{
+		SyncData *data = new SyncData(wxT("LastSyncJob"));
+		data->SetSource(wxFileName::DirName(source));
+		data->SetDest(wxFileName::DirName(dests.Count() > 0 ? dests.Item(0) : wxString()));
+		data->SetFunction(function);
+		data->SetCheckSize(checks.Size);
+		data->SetCheckTime(checks.Time);
+		data->SetCheckShort(checks.Short);
+		data->SetCheckFull(checks.Full);
+		data->SetIgnoreRO(options.IgnoreRO);
+		data->SetAttributes(options.Attributes);
+		data->SetTimeStamps(options.TimeStamps);
+		data->SetRecycle(options.Recycle);
+		data->SetPreviewChanges(options.PreviewChanges);
+		data->SetNoSkipped(options.NoSkipped);
+		data->SetVerify(options.Verify);
+		data->SetDurability(options.Durability);
+		data->SetBackground(options.Background);
+		data->SetBandwidthLimit(options.BandwidthLimit);
+		data->SetIopsLimit(options.IopsLimit);
+		data->SetVersions(options.Versions);
+		data->SetKeepVersions(options.KeepVersions);
+		data->SetAgent(options.Agent);
+		data->SetAgentRoot(options.AgentRoot);
+        RuleSet *ruleset = new RuleSet(rules);
+        ruleset->TransferFromFile();
+		data->SetRules(ruleset);
+		try{
+			SyncMany(data, dests);
+		}
+		catch(std::exception &arg){
+			OutputProgress(arg.what(), Error);
+		}
+	}
+
+	//Runs a sync job to the given destinations rather than its own
+	void SyncMany(const wxString &jobname, const wxArrayString &dests){
+		SyncData *data = new SyncData(jobname);
+		try{
+			data->TransferFromFile();
+			SyncMany(data, dests);
+		}
+		catch(std::exception &arg){
+			OutputProgress(arg.what(), Error);
+		}
+	}
+
+	//Works out what a sync job would do and saves it to be run later
+	void SavePlan(const wxString &jobname, const wxString &path){
+		SyncData *data = new SyncData(jobname);
+		try{
+			data->TransferFromFile();
+			ValidateSync(data);
+			SyncPlan plan;
+			std::unique_ptr<SyncBaseline> baseline;
+			if(data->GetFunctionType() == SyncEqualise){
+				baseline.reset(new SyncBaseline(data, data->GetCheckFull()));
+			}
+			SyncFiles sync(data->GetSource(), data->GetDest(), data, NULL, &plan, NULL, baseline.get());
+			sync.Start();
+			if(!plan.Save(path, data)){
+				throw std::invalid_argument("The plan could not be saved");
+			}
+			OutputProgress(wxString::Format(_("Saved %d operations to %s"), (int)plan.GetOperations().size(), path), Message);
+		}
+		catch(std::exception &arg){
+			OutputProgress(arg.what(), Error);
+		}
+		delete data;
+	}
+
+	//Runs a saved plan, anything that has changed since it was saved is 
+	//checked again rather than blindly copied or removed
+	void RunPlan(const wxString &path){
+		SyncData *data = new SyncData(wxT("LastSyncJob"));
+		SyncPlan plan;
+		try{
+			if(!plan.Load(path, data)){
+				throw std::invalid_argument("The plan could not be loaded");
+			}
+		}
+		catch(std::exception &arg){
+			OutputProgress(arg.what(), Error);
+			delete data;
+			return;
+		}
+		//The plan already knows how much there is to do so we don't need to count
+		Progress::Begin();
+		unsigned long long files = 0, bytes = 0;
+		const std::vector<SyncOperation> &operations = plan.GetOperations();
+		for(std::vector<SyncOperation>::const_iterator iter = operations.begin(); iter != operations.end(); ++iter){
+			if(iter->type == SyncCopyFile || iter->type == SyncSkipFile || iter->type == SyncRemoveFile){
+				files++;
+			}
+			if((iter->type == SyncCopyFile || iter->type == SyncSkipFile) && iter->sourcestate.exists){
+				bytes += iter->sourcestate.size;
+			}
+		}
+		Progress::SetTotal(files, bytes);
+		StartRuleProfile(data->GetRules());
+		DeviceLock devices(GetSyncPaths(data), GetLockFolder(), wxGetApp().GetCancel(), OutputDeviceWait);
+		SyncJob *job = new SyncJob(data, &plan);
+		job->Create();
+		job->Run();
+		job->Wait();
+		Progress::End();
+		OutputRuleProfile(data->GetRules());
+	}
+
+	//Writes what has changed in a job's source since it was last packed, the
+	//destination of the job isn't needed
+	void Pack(const wxString &jobname, const wxString &path, bool compress = false){
+		SyncData *data = new SyncData(jobname);
+		try{
+			data->TransferFromFile();
+			if(data->GetSource().GetFullPath() == wxEmptyString || !wxDirExists(Path::Normalise(data->GetSource().GetFullPath()))){
+				throw std::invalid_argument("The source must exist");
+			}
+			SyncPack::Pack(data, path, compress);
+		}
+		catch(std::exception &arg){
+			OutputProgress(arg.what(), Error);
+		}
+		delete data;
+	}
+
+	void ApplyPack(const wxString &path, const wxString &dest){
+		wxString normalised = Path::Normalise(dest);
+		if(normalised == wxEmptyString || !wxDirExists(normalised)){
+			OutputProgress(_("The destination path is invalid"), Error);
+			return;
+		}
+		SyncPack::Unpack(path, wxFileName::DirName(normalised));
+	}
+	
 	void Backup(BackupData *data){
 		if(data->GetLocations().Count() == 0){
 			throw std::invalid_argument("You must select some paths to backup");
@@ -114,14 +372,9 @@
 		}
 		FileCounter counter;
 		counter.AddPaths(data->GetLocations());
-		counter.Count();
-		int count = counter.GetCount();
 		if(data->GetTest()){
-			count = count * 2;
+			counter.SetMultiplier(2);
 		}
-		wxCommandEvent *event = new wxCommandEvent(wxEVT_COMMAND_BUTTON_CLICKED, ID_PROGRESSSETUP);
-		event->SetInt(count);
-		wxGetApp().QueueEvent(event);
 		if(data->GetUsesPassword()){
 			if(wxGetApp().m_Password == wxEmptyString){
 				wxCommandEvent *event = new wxCommandEvent(wxEVT_COMMAND_BUTTON_CLICKED, ID_GETPASSWORD);
@@ -134,10 +387,17 @@
 			}
 			data->SetPassword(wxGetApp().m_Password);
 		}
+		StartProgressCount(counter);
+		StartRuleProfile(data->GetRules());
+		wxArrayString paths = data->GetLocations();
+		paths.Add(data->GetFileLocation());
+		DeviceLock devices(paths, GetLockFolder(), wxGetApp().GetCancel(), OutputDeviceWait);
 		BackupJob *job = new BackupJob(data);
 		job->Create();
 		job->Run();
 		job->Wait();
+		FinishProgressCount(counter);
+		OutputRuleProfile(data->GetRules());
 	}
 	
 	void Backup(const wxString &jobname){
@@ -183,11 +443,6 @@
 		}
 		FileCounter counter;
 		counter.AddPaths(data->GetLocations());
-		counter.Count();
-		int count = counter.GetCount();
-		wxCommandEvent *event = new wxCommandEvent(wxEVT_COMMAND_BUTTON_CLICKED, ID_PROGRESSSETUP);
-		event->SetInt(count);
-		wxGetApp().QueueEvent(event);
 		if(wxGetApp().m_Password == wxEmptyString){
 			wxCommandEvent *event = new wxCommandEvent(wxEVT_COMMAND_BUTTON_CLICKED, ID_GETPASSWORD);
 			int id = wxDateTime::Now().GetTicks();
@@ -198,10 +453,15 @@
 			}
 			data->SetPassword(wxGetApp().m_Password);
 		}
+		StartProgressCount(counter);
+		StartRuleProfile(data->GetRules());
+		DeviceLock devices(data->GetLocations(), GetLockFolder(), wxGetApp().GetCancel(), OutputDeviceWait);
 		SecureJob *job = new SecureJob(data);
 		job->Create();
 		job->Run();
 		job->Wait();
+		FinishProgressCount(counter);
+		OutputRuleProfile(data->GetRules());
 	}
 	
 	void Secure(const wxString &jobname){
@@ -235,6 +495,18 @@
 		return Path::Normalise(variable);
 	}
 
+	wxString Explain(const wxString &path, const wxString &rules){
+		RuleSet ruleset(rules);
+		if(!ruleset.TransferFromFile()){
+			return wxEmptyString;
+		}
+		return ruleset.Explain(Path::Normalise(path));
+	}
+
+	void ProfileRules(bool profile){
+		wxGetApp().SetProfileRules(profile);
+	}
+
 	bool Delete(const wxString &path){
 		wxString normpath = Path::Normalise(path);
 		if(File::Delete(normpath, false, false)){
@@ -250,7 +522,7 @@
 	bool Copy(const wxString &source, const wxString &dest){
 		wxString normsource = Path::Normalise(source);
 		wxString normdest = Path::Normalise(dest);
-		if(File::Copy(normsource, normdest)){
+		if(File::Copy(normsource, normdest, false, NULL, 0, &wxGetApp().GetCancel())){
 			OutputProgress(_("Copied ") + normsource, Message);	
 		}
 		else{
@@ -330,6 +602,14 @@ void Sync(const wxString &jobname);
 void Sync(const wxString &source, const wxString &dest, const wxString &function, 
 		  SyncChecks checks = SyncChecks(), SyncOptions options = SyncOptions(), 
 		  const wxString &rules = wxEmptyString);
+void SyncMany(const wxString &jobname, const wxArrayString &dests);
+void SyncMany(const wxString &source, const wxArrayString &dests, const wxString &function, 
+		      SyncChecks checks = SyncChecks(), SyncOptions options = SyncOptions(), 
+		      const wxString &rules = wxEmptyString);
+void SavePlan(const wxString &jobname, const wxString &path);
+void RunPlan(const wxString &path);
+void Pack(const wxString &jobname, const wxString &path, bool compress = false);
+void ApplyPack(const wxString &path, const wxString &dest);
 
 void Backup(const wxString &jobname);
 void Backup(const wxArrayString &paths, const wxString &backuplocation, const wxString &function, 
@@ -341,6 +621,8 @@ void Secure(const wxArrayString &paths, const wxString &function, const wxString
 
 wxString ExpandVariable(const wxString &variable);
 wxString GetScriptPath(const wxString &name);
+wxString Explain(const wxString &path, const wxString &rules);
+void ProfileRules(bool profile);
 bool Delete(const wxString &path);
 bool Copy(const wxString &source, const wxString &dest);
 bool Move(const wxString &source, const wxString &dest);
@@ -21,6 +21,32 @@
 		lua_pop(L, 1);
 		return ret;
 	}
+
+	//As above but for numbers
+	long getfield(lua_State *L, int index, const char *key, long ldefault){
+		long ret = ldefault;
+		lua_getfield(L, index, key);
+		if(!lua_isnumber(L, -1)){
+			lua_pop(L, 1);
+			return ret;
+		}
+		ret = static_cast<long>(lua_tonumber(L, -1));
+		lua_pop(L, 1);
+		return ret;
+	}
+
+	//As above but for strings
+	wxString getfield(lua_State *L, int index, const char *key, const wxString &strdefault){
+		wxString ret = strdefault;
+		lua_getfield(L, index, key);
+		if(!lua_isstring(L, -1)){
+			lua_pop(L, 1);
+			return ret;
+		}
+		ret = wxString(lua_tostring(L, -1), *wxConvCurrent);
+		lua_pop(L, 1);
+		return ret;
+	}
 %}
 
 %naturalvar wxString;
@@ -78,6 +104,15 @@
 	$1.Recycle = getfield(L, $input,"recycle", $1.Recycle);
 	$1.PreviewChanges = getfield(L, $input,"previewchanges", $1.PreviewChanges);
 	$1.NoSkipped = getfield(L, $input,"noskipped", $1.NoSkipped);
+	$1.Verify = getfield(L, $input,"verify", $1.Verify);
+	$1.Durability = Durability::FromString(getfield(L, $input, "durability", Durability::ToString($1.Durability)));
+	$1.Background = getfield(L, $input, "background", $1.Background);
+	$1.BandwidthLimit = getfield(L, $input, "bandwidthlimit", $1.BandwidthLimit);
+	$1.IopsLimit = getfield(L, $input, "iopslimit", $1.IopsLimit);
+	$1.Versions = getfield(L, $input, "versions", $1.Versions);
+	$1.KeepVersions = getfield(L, $input, "keepversions", $1.KeepVersions);
+	$1.Agent = getfield(L, $input, "agent", $1.Agent);
+	$1.AgentRoot = getfield(L, $input, "agentroot", $1.AgentRoot);
 %}
 
 %typemap(in,checkfn="lua_istable") BackupOptions()